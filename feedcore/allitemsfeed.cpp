@@ -52,6 +52,21 @@ Future<ArticleRef> *AllItemsFeed::getArticles(bool unreadFilter)
     return m_context->getArticles(unreadFilter);
 }
 
+Future<ArticleRef> *AllItemsFeed::getArticlePage(bool unreadFilter, const ArticleRef &after, int limit)
+{
+    return m_context->getArticlePage(unreadFilter, after, limit);
+}
+
+Future<ArticleRows> *AllItemsFeed::getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit)
+{
+    return m_context->getArticleRows(unreadFilter, after, limit);
+}
+
+Future<qint64> *AllItemsFeed::markAllRead(const QDateTime &upTo)
+{
+    return m_context->markAllRead(upTo);
+}
+
 Feed::Updater *AllItemsFeed::updater()
 {
     return m_updater;
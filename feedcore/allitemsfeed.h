@@ -21,6 +21,9 @@ class AllItemsFeed : public Feed
 public:
     AllItemsFeed(Context *context, const QString &name, QObject *parent = nullptr);
     Future<ArticleRef> *getArticles(bool unreadFilter) final;
+    Future<ArticleRef> *getArticlePage(bool unreadFilter, const ArticleRef &after, int limit) final;
+    Future<ArticleRows> *getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit) final;
+    Future<qint64> *markAllRead(const QDateTime &upTo) final;
     Updater *updater() final;
 
 private:
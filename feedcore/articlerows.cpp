@@ -0,0 +1,195 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "articlerows.h"
+#include "article.h"
+using namespace FeedCore;
+
+ArticleRows::ArticleRows(const std::shared_ptr<Source> &source)
+    : m_source{source}
+{
+}
+
+Future<ArticleRows> *ArticleRows::describe(Future<ArticleRef> *articles)
+{
+    auto *op = new Future<ArticleRows>;
+    QObject::connect(articles, &BaseFuture::finished, [op, articles] {
+        ArticleRows rows;
+        for (const auto &article : articles->result()) {
+            rows.insert(rows.size(), article);
+        }
+        op->setResult(rows);
+        emit op->finished();
+        delete op;
+    });
+    return op;
+}
+
+int ArticleRows::size() const
+{
+    return m_ids.size();
+}
+
+bool ArticleRows::isEmpty() const
+{
+    return m_ids.isEmpty();
+}
+
+void ArticleRows::clear()
+{
+    *this = ArticleRows(m_source);
+}
+
+int ArticleRows::intern(const QString &string)
+{
+    const auto &existing = m_stringIds.constFind(string);
+    if (existing != m_stringIds.constEnd()) {
+        return *existing;
+    }
+    const int id = m_strings.size();
+    m_strings.append(string);
+    m_stringIds.insert(string, id);
+    return id;
+}
+
+void ArticleRows::append(const ArticleRows &rows)
+{
+    if (!m_source) {
+        m_source = rows.m_source;
+    }
+    for (int i = 0; i < rows.size(); ++i) {
+        // articles that came with their rows get new ids here, so that they cannot collide
+        const auto &article = rows.m_articles.value(rows.id(i));
+        if (article.isNull()) {
+            append(rows.row(i));
+        } else {
+            insert(size(), article);
+        }
+    }
+}
+
+void ArticleRows::append(const Row &row)
+{
+    insert(size(), row);
+}
+
+void ArticleRows::insert(int index, const Row &row)
+{
+    m_ids.insert(index, row.id);
+    m_feeds.insert(index, row.feed);
+    m_dates.insert(index, row.date);
+    m_flags.insert(index, quint8((row.isRead ? ReadFlag : 0) | (row.isStarred ? StarredFlag : 0)));
+    m_titles.insert(index, intern(row.title));
+    m_authors.insert(index, intern(row.author));
+    m_urls.insert(index, row.url);
+}
+
+qint64 ArticleRows::insert(int index, const ArticleRef &article)
+{
+    Row row;
+    row.id = --m_lastLocalId;
+    row.date = article->date().toSecsSinceEpoch();
+    row.isRead = article->isRead();
+    row.isStarred = article->isStarred();
+    row.title = article->title();
+    row.author = article->author();
+    row.url = article->url();
+    insert(index, row);
+    m_articles.insert(row.id, article);
+    return row.id;
+}
+
+void ArticleRows::remove(int index, int count)
+{
+    if (!m_articles.isEmpty()) {
+        for (int i = index; i < index + count; ++i) {
+            m_articles.remove(m_ids[i]);
+        }
+    }
+    m_ids.remove(index, count);
+    m_feeds.remove(index, count);
+    m_dates.remove(index, count);
+    m_flags.remove(index, count);
+    m_titles.remove(index, count);
+    m_authors.remove(index, count);
+    m_urls.remove(index, count);
+}
+
+ArticleRows::Row ArticleRows::row(int index) const
+{
+    return {id(index), m_feeds[index], date(index), isRead(index), isStarred(index), title(index), author(index), url(index)};
+}
+
+qint64 ArticleRows::id(int index) const
+{
+    return m_ids[index];
+}
+
+qint64 ArticleRows::date(int index) const
+{
+    return m_dates[index];
+}
+
+bool ArticleRows::isRead(int index) const
+{
+    return (m_flags[index] & ReadFlag) != 0;
+}
+
+bool ArticleRows::isStarred(int index) const
+{
+    return (m_flags[index] & StarredFlag) != 0;
+}
+
+const QString &ArticleRows::title(int index) const
+{
+    return m_strings[m_titles[index]];
+}
+
+const QString &ArticleRows::author(int index) const
+{
+    return m_strings[m_authors[index]];
+}
+
+const QUrl &ArticleRows::url(int index) const
+{
+    return m_urls[index];
+}
+
+void ArticleRows::setFlag(int index, Flags flag, bool value)
+{
+    if (value) {
+        m_flags[index] |= flag;
+    } else {
+        m_flags[index] &= ~flag;
+    }
+}
+
+void ArticleRows::setRead(int index, bool isRead)
+{
+    setFlag(index, ReadFlag, isRead);
+}
+
+void ArticleRows::setStarred(int index, bool isStarred)
+{
+    setFlag(index, StarredFlag, isStarred);
+}
+
+ArticleRef ArticleRows::article(int index) const
+{
+    const auto &existing = m_articles.constFind(m_ids[index]);
+    if (existing != m_articles.constEnd()) {
+        return *existing;
+    }
+    return m_source ? m_source->article(row(index)) : ArticleRef();
+}
+
+ArticleRef ArticleRows::find(int index) const
+{
+    const auto &existing = m_articles.constFind(m_ids[index]);
+    if (existing != m_articles.constEnd()) {
+        return *existing;
+    }
+    return m_source ? m_source->find(row(index)) : ArticleRef();
+}
@@ -0,0 +1,130 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef FEEDCORE_ARTICLEROWS_H
+#define FEEDCORE_ARTICLEROWS_H
+#include "articleref.h"
+#include "future.h"
+#include <QHash>
+#include <QUrl>
+#include <QVector>
+#include <memory>
+
+namespace FeedCore
+{
+/**
+ * A compact list of articles, for views that list many articles but open few of them.
+ *
+ * Each field is kept in its own array, and titles and authors are interned, so a row costs
+ * a few dozen bytes where an Article costs a QObject.  The Article for a row is only created
+ * when article() is called.
+ */
+class ArticleRows
+{
+public:
+    /**
+     * The fields of one row.
+     */
+    struct Row {
+        qint64 id{0}; /** < assigned by the storage; zero for an empty cursor */
+        qint64 feed{0};
+        qint64 date{0}; /** < seconds since the epoch */
+        bool isRead{false};
+        bool isStarred{false};
+        QString title;
+        QString author;
+        QUrl url;
+    };
+
+    /**
+     * Looks up the articles that rows describe.  Storage that returns rows provides one.
+     */
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+
+        /**
+         * The article for /row/, which is created if it does not exist yet.
+         */
+        virtual ArticleRef article(const Row &row) = 0;
+
+        /**
+         * The article for /row/ if it already exists, or null.
+         */
+        virtual ArticleRef find(const Row &row) = 0;
+    };
+
+    ArticleRows() = default;
+    explicit ArticleRows(const std::shared_ptr<Source> &source);
+
+    /**
+     * Rows for the articles that /articles/ returns, for lists that only provide articles.
+     */
+    static Future<ArticleRows> *describe(Future<ArticleRef> *articles);
+
+    int size() const;
+    bool isEmpty() const;
+    void clear();
+
+    /**
+     * Rows from another list keep their source, which is adopted by this list if it has none.
+     */
+    void append(const ArticleRows &rows);
+    void append(const Row &row);
+    void insert(int index, const Row &row);
+
+    /**
+     * Add a row for an article that already exists, and return the row's id.  The row keeps
+     * a reference to the article.
+     */
+    qint64 insert(int index, const ArticleRef &article);
+    void remove(int index, int count = 1);
+
+    Row row(int index) const;
+    qint64 id(int index) const;
+    qint64 date(int index) const;
+    bool isRead(int index) const;
+    bool isStarred(int index) const;
+    const QString &title(int index) const;
+    const QString &author(int index) const;
+    const QUrl &url(int index) const;
+    void setRead(int index, bool isRead);
+    void setStarred(int index, bool isStarred);
+
+    /**
+     * The article for the row at /index/, which is created if necessary.
+     */
+    ArticleRef article(int index) const;
+
+    /**
+     * The article for the row at /index/ if it already exists, or null.
+     */
+    ArticleRef find(int index) const;
+
+private:
+    enum Flags : quint8 {
+        ReadFlag = 1,
+        StarredFlag = 2,
+    };
+
+    QVector<qint64> m_ids;
+    QVector<qint64> m_feeds;
+    QVector<qint64> m_dates;
+    QVector<quint8> m_flags;
+    QVector<int> m_titles;
+    QVector<int> m_authors;
+    QVector<QUrl> m_urls;
+    QVector<QString> m_strings;
+    QHash<QString, int> m_stringIds;
+    QHash<qint64, ArticleRef> m_articles; /** < articles that existed before their rows, by id */
+    qint64 m_lastLocalId{0}; /** < ids for those articles count down from zero */
+    std::shared_ptr<Source> m_source;
+
+    int intern(const QString &string);
+    void setFlag(int index, Flags flag, bool value);
+};
+}
+#endif // FEEDCORE_ARTICLEROWS_H
@@ -9,13 +9,21 @@
 #include "provisionalfeed.h"
 #include "scheduler.h"
 #include "storage.h"
+#include "updatequeue.h"
 #include <QDebug>
 #include <QFile>
 #include <QNetworkConfigurationManager>
 #include <QSet>
+#include <QTimer>
+#include <algorithm>
 
 namespace FeedCore
 {
+// storage maintenance runs shortly after startup, then every few hours
+static constexpr int maintenanceStartDelay{5 * 60 * 1000};
+static constexpr int maintenanceRetryDelay{60 * 1000};
+static constexpr int maintenanceInterval{6 * 60 * 60 * 1000};
+
 struct Context::PrivData {
     Context *parent;
     Storage *storage;
@@ -25,10 +33,12 @@ struct Context::PrivData {
     qint64 expireAge{0};
     Scheduler *updateScheduler;
     QNetworkConfigurationManager ncm;
+    QTimer maintenanceTimer;
 
     PrivData(Storage *storage, Context *parent);
     void configureUpdates(Feed *feed, const QDateTime &timestamp = QDateTime::currentDateTime()) const;
     void configureExpiration(Feed *feed) const;
+    void runMaintenance();
 };
 
 Context::Context(Storage *storage, QObject *parent)
@@ -43,6 +53,12 @@ Context::Context(Storage *storage, QObject *parent)
         populateFeeds(getFeeds->result());
     });
     d->updateScheduler->start();
+
+    d->maintenanceTimer.setSingleShot(true);
+    QObject::connect(&d->maintenanceTimer, &QTimer::timeout, this, [this] {
+        d->runMaintenance();
+    });
+    d->maintenanceTimer.start(maintenanceStartDelay);
 }
 
 Context::~Context() = default;
@@ -62,6 +78,10 @@ void Context::PrivData::configureUpdates(Feed *feed, const QDateTime &timestamp)
     if (updateMode == Feed::InheritUpdateMode) {
         feed->setUpdateInterval(updateInterval);
         shouldSchedule = defaultUpdate;
+    } else if (updateMode == Feed::AdaptiveUpdateMode) {
+        // the default interval is used until storage has estimated how often the feed posts
+        feed->setUpdateInterval(updateInterval);
+        shouldSchedule = true;
     } else {
         shouldSchedule = (updateMode != Feed::DisableUpdateMode);
     }
@@ -81,6 +101,22 @@ void Context::PrivData::configureExpiration(Feed *feed) const
     }
 }
 
+void Context::PrivData::runMaintenance()
+{
+    // maintenance and updates compete for the database, so wait until the updates are done
+    const bool updating{std::any_of(feeds.cbegin(), feeds.cend(), [](Feed *feed) {
+        return feed->status() == Feed::Updating;
+    })};
+    if (updating) {
+        maintenanceTimer.start(maintenanceRetryDelay);
+        return;
+    }
+    Future<qint64> *op{storage->runMaintenance(expireAge)};
+    QObject::connect(op, &BaseFuture::finished, parent, [this] {
+        maintenanceTimer.start(maintenanceInterval);
+    });
+}
+
 const QSet<Feed *> &Context::getFeeds()
 {
     return d->feeds;
@@ -116,23 +152,85 @@ Future<ArticleRef> *Context::getStarred()
     return d->storage->getStarred();
 }
 
+Future<ArticleRef> *Context::getArticlePage(bool unreadFilter, const ArticleRef &after, int limit)
+{
+    if (unreadFilter) {
+        return d->storage->getUnreadPage(after, limit);
+    }
+    return d->storage->getAllPage(after, limit);
+}
+
+Future<ArticleRef> *Context::getStarredPage(const ArticleRef &after, int limit)
+{
+    return d->storage->getStarredPage(after, limit);
+}
+
+Future<ArticleRef> *Context::search(const QString &query, const ArticleRef &after, int limit)
+{
+    return d->storage->search(query, after, limit);
+}
+
+Future<ArticleRows> *Context::getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit)
+{
+    if (unreadFilter) {
+        return d->storage->getUnreadRows(after, limit);
+    }
+    return d->storage->getAllRows(after, limit);
+}
+
+Future<ArticleRows> *Context::getStarredRows(const ArticleRows::Row &after, int limit)
+{
+    return d->storage->getStarredRows(after, limit);
+}
+
+Future<ArticleRows> *Context::searchRows(const QString &query, const ArticleRows::Row &after, int limit)
+{
+    return d->storage->searchRows(query, after, limit);
+}
+
+Future<qint64> *Context::markAllRead(const QDateTime &upTo)
+{
+    return d->storage->markAllRead(upTo);
+}
+
 void Context::requestUpdate()
 {
     const auto &timestamp = QDateTime::currentDateTime();
     const auto &feeds = d->feeds;
     for (Feed *const entry : feeds) {
-        entry->updater()->start(timestamp);
+        updateQueue()->enqueue(entry, timestamp, UpdateQueue::Requested);
     }
 }
 
 void Context::abortUpdates()
 {
+    updateQueue()->clear();
     const auto &feeds = d->feeds;
     for (Feed *const entry : feeds) {
         entry->updater()->abort();
     }
 }
 
+UpdateQueue *Context::updateQueue() const
+{
+    return d->updateScheduler->updateQueue();
+}
+
+Scheduler *Context::updateScheduler() const
+{
+    return d->updateScheduler;
+}
+
+AdaptiveUpdateStats Context::adaptiveUpdateStats() const
+{
+    return d->updateScheduler->adaptiveStats();
+}
+
+void Context::flush()
+{
+    d->storage->flush();
+}
+
 qint64 Context::defaultUpdateInterval()
 {
     return d->updateInterval;
@@ -145,7 +243,7 @@ void Context::setDefaultUpdateInterval(qint64 defaultUpdateInterval)
     }
     d->updateInterval = defaultUpdateInterval;
     for (Feed *feed : qAsConst(d->feeds)) {
-        if (feed->updateMode() == Feed::InheritUpdateMode) {
+        if (feed->updateMode() == Feed::InheritUpdateMode || feed->updateMode() == Feed::AdaptiveUpdateMode) {
             feed->setUpdateInterval(defaultUpdateInterval);
         }
     }
@@ -171,6 +269,34 @@ void Context::setExpireAge(qint64 expireAge)
     emit expireAgeChanged();
 }
 
+qint64 Context::minAdaptiveInterval() const
+{
+    return d->updateScheduler->minAdaptiveInterval();
+}
+
+void Context::setMinAdaptiveInterval(qint64 minAdaptiveInterval)
+{
+    if (minAdaptiveInterval == d->updateScheduler->minAdaptiveInterval()) {
+        return;
+    }
+    d->updateScheduler->setAdaptiveIntervalLimits(minAdaptiveInterval, d->updateScheduler->maxAdaptiveInterval());
+    emit adaptiveIntervalLimitsChanged();
+}
+
+qint64 Context::maxAdaptiveInterval() const
+{
+    return d->updateScheduler->maxAdaptiveInterval();
+}
+
+void Context::setMaxAdaptiveInterval(qint64 maxAdaptiveInterval)
+{
+    if (maxAdaptiveInterval == d->updateScheduler->maxAdaptiveInterval()) {
+        return;
+    }
+    d->updateScheduler->setAdaptiveIntervalLimits(d->updateScheduler->minAdaptiveInterval(), maxAdaptiveInterval);
+    emit adaptiveIntervalLimitsChanged();
+}
+
 static QString urlToPath(const QUrl &url)
 {
     QString path(url.toLocalFile());
@@ -5,7 +5,10 @@
 
 #ifndef FEEDCORE_CONTEXT_H
 #define FEEDCORE_CONTEXT_H
+#include "articlerows.h"
 #include "future.h"
+#include "scheduler.h"
+#include <QDateTime>
 #include <QObject>
 #include <QUrl>
 #include <Syndication/Feed>
@@ -16,6 +19,7 @@ namespace FeedCore
 class Storage;
 class Feed;
 class ProvisionalFeed;
+class UpdateQueue;
 
 /**
  * A Context object represents an entire collection of feeds.
@@ -46,6 +50,14 @@ class Context : public QObject
      * disables item expiration.  The default is 0.
      */
     Q_PROPERTY(qint64 expireAge READ expireAge WRITE setExpireAge NOTIFY expireAgeChanged)
+
+    /**
+     * The shortest and longest update intervals (in seconds) for feeds in AdaptiveUpdateMode.
+     *
+     * The defaults are 15 minutes and 1 day.
+     */
+    Q_PROPERTY(qint64 minAdaptiveInterval READ minAdaptiveInterval WRITE setMinAdaptiveInterval NOTIFY adaptiveIntervalLimitsChanged)
+    Q_PROPERTY(qint64 maxAdaptiveInterval READ maxAdaptiveInterval WRITE setMaxAdaptiveInterval NOTIFY adaptiveIntervalLimitsChanged)
 public:
     /**
      *  Create a context from a storage backend.
@@ -103,6 +115,38 @@ public:
      */
     Future<ArticleRef> *getStarred();
 
+    /**
+     * Paged variants of getArticles and getStarred.
+     *
+     * Returns at most /limit/ articles that sort after /after/, newest first.  Pass a null
+     * ArticleRef to request the first page.
+     */
+    Future<ArticleRef> *getArticlePage(bool unreadFilter, const ArticleRef &after, int limit);
+    Future<ArticleRef> *getStarredPage(const ArticleRef &after, int limit);
+
+    /**
+     * Search the articles stored in this context.
+     *
+     * Returns at most /limit/ articles that match /query/ and rank after /after/, best match
+     * first.  Pass a null ArticleRef to request the first page.
+     */
+    Future<ArticleRef> *search(const QString &query, const ArticleRef &after, int limit);
+
+    /**
+     * Row variants of getArticlePage, getStarredPage and search.  See Feed::getArticleRows.
+     */
+    Future<ArticleRows> *getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit);
+    Future<ArticleRows> *getStarredRows(const ArticleRows::Row &after, int limit);
+    Future<ArticleRows> *searchRows(const QString &query, const ArticleRows::Row &after, int limit);
+
+    /**
+     * Mark every article in this context dated at or before /upTo/ as read, in a single
+     * storage operation.  Pass an invalid QDateTime to mark every article.
+     *
+     * @return A future whose result is the number of articles that changed.
+     */
+    Future<qint64> *markAllRead(const QDateTime &upTo = {});
+
     /**
      * Trigger an update on every feed in this context.
      *
@@ -121,6 +165,29 @@ public:
      */
     void abortUpdates();
 
+    /**
+     * The queue that limits how many feeds update at once.  Its stats show how long updates
+     * wait to start, and its limits can be adjusted.
+     */
+    UpdateQueue *updateQueue() const;
+
+    /**
+     * The scheduler for automatic updates.  Its adaptive limits can be adjusted, and its
+     * adaptiveStats show how many updates AdaptiveUpdateMode saves.
+     */
+    Scheduler *updateScheduler() const;
+
+    /**
+     * How many updates AdaptiveUpdateMode saves, as of now.  See Scheduler::adaptiveStats.
+     */
+    Q_INVOKABLE FeedCore::AdaptiveUpdateStats adaptiveUpdateStats() const;
+
+    /**
+     * Save every change that storage is still holding back.  This blocks until
+     * the changes are written, so it is meant for shutdown.
+     */
+    void flush();
+
     /**
      * Write an OPML document with the feeds stored in this context
      * to the provided url.  The URL must point to a writable local file.
@@ -140,11 +207,16 @@ public:
     void setDefaultUpdateInterval(qint64 defaultUpdateInterval);
     qint64 expireAge();
     void setExpireAge(qint64 expireAge);
+    qint64 minAdaptiveInterval() const;
+    void setMinAdaptiveInterval(qint64 minAdaptiveInterval);
+    qint64 maxAdaptiveInterval() const;
+    void setMaxAdaptiveInterval(qint64 maxAdaptiveInterval);
 
 signals:
     void defaultUpdateEnabledChanged();
     void defaultUpdateIntervalChanged();
     void expireAgeChanged();
+    void adaptiveIntervalLimitsChanged();
 
     /**
      * Emitted when a feed is added to the context.  This may be a newly-created
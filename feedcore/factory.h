@@ -7,10 +7,32 @@
 #define FEEDCORE_UNIQUEFACTORY_H
 #include <QHash>
 #include <QPointer>
+#include <QVector>
 #include <QWeakPointer>
+#include <algorithm>
 
 namespace FeedCore
 {
+/**
+ * Counters describing a factory's cache, for diagnostics.
+ */
+struct FactoryStats {
+    int live{0}; /** < entries whose instance still exists */
+    int dead{0}; /** < entries whose instance has been destroyed, waiting to be purged */
+    int retained{0}; /** < instances kept alive by the recently used list */
+    quint64 hits{0}; /** < getInstance calls that returned an existing instance */
+    quint64 misses{0}; /** < getInstance calls that created a new instance */
+};
+
+/**
+ * Ensures that there is at most one instance for each key.
+ *
+ * Entries for destroyed instances are purged whenever the table has doubled in size
+ * since the last purge, so the table stays proportional to the number of live instances.
+ *
+ * The factory can also hold strong references to the most recently used instances, so
+ * that they outlive the views that requested them.  This is off by default.
+ */
 template<typename KeyType, typename ValueType, typename StorageType, typename PointerType>
 class Factory
 {
@@ -20,15 +42,103 @@ public:
     {
         auto &instance = m_instances[key];
         if (instance.isNull()) {
+            ++m_misses;
             auto newArticle = PointerType(new ValueType(key, std::forward<Args>(args)...));
             instance = newArticle;
+            retain(newArticle);
+            if (m_instances.size() >= m_purgeThreshold) {
+                purge();
+            }
             return newArticle;
         }
-        return instance;
+        ++m_hits;
+        PointerType existing{instance};
+        retain(existing);
+        return existing;
+    }
+
+    /**
+     * Returns the existing instance for /key/, or null if there is none.
+     */
+    PointerType find(KeyType key) const
+    {
+        return m_instances.value(key);
+    }
+
+    /**
+     * Keep strong references to the /count/ most recently used instances.
+     *
+     * This is only useful with SharedFactory; ObjectFactory instances are owned elsewhere.
+     */
+    void setRetainLimit(int count)
+    {
+        m_retainLimit = std::max(count, 0);
+        if (m_recent.size() > m_retainLimit) {
+            m_recent.resize(m_retainLimit);
+        }
+    }
+
+    /**
+     * Forget the entries for instances that have been destroyed.
+     */
+    void purge()
+    {
+        for (auto it = m_instances.begin(); it != m_instances.end();) {
+            if (it->isNull()) {
+                it = m_instances.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_purgeThreshold = std::max(minPurgeThreshold, m_instances.size() * 2);
+    }
+
+    /**
+     * Scans every entry, so this is meant for diagnostics rather than regular use.
+     */
+    FactoryStats stats() const
+    {
+        FactoryStats stats;
+        for (const auto &instance : m_instances) {
+            if (instance.isNull()) {
+                ++stats.dead;
+            } else {
+                ++stats.live;
+            }
+        }
+        stats.retained = m_recent.size();
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        return stats;
     }
 
 private:
+    // below this size, purging would cost more than the dead entries
+    static constexpr int minPurgeThreshold{256};
+
     QHash<KeyType, StorageType> m_instances;
+    QVector<PointerType> m_recent; /** < most recently used first */
+    int m_retainLimit{0};
+    int m_purgeThreshold{minPurgeThreshold};
+    quint64 m_hits{0};
+    quint64 m_misses{0};
+
+    void retain(const PointerType &instance)
+    {
+        if (m_retainLimit == 0) {
+            return;
+        }
+        // the list is short, so a linear search is cheaper than maintaining an index
+        const int index = m_recent.indexOf(instance);
+        if (index >= 0) {
+            m_recent.move(index, 0);
+            return;
+        }
+        if (m_recent.size() >= m_retainLimit) {
+            m_recent.removeLast();
+        }
+        m_recent.prepend(instance);
+    }
 };
 
 template<typename KeyType, typename ValueType>
@@ -4,6 +4,7 @@
  */
 
 #include "feed.h"
+#include "article.h"
 using namespace FeedCore;
 
 struct Feed::PrivData {
@@ -17,9 +18,13 @@ struct Feed::PrivData {
     LoadStatus status{LoadStatus::Idle};
     UpdateMode updateMode{InheritUpdateMode};
     time_t updateInterval{0};
+    qint64 postingInterval{0};
+    int failureCount{0};
     UpdateMode expireMode{InheritUpdateMode};
     qint64 expireAge{0};
     QDateTime lastUpdate;
+    QDateTime lastFailure;
+    HttpCache httpCache;
 };
 
 Feed::Feed(QObject *parent)
@@ -84,6 +89,8 @@ void Feed::setUrl(const QUrl &url)
     if (d->url != url) {
         d->url = url;
         emit urlChanged();
+        // the headers describe the old source
+        setHttpCache({});
     }
 }
 
@@ -134,6 +141,19 @@ void Feed::setStatus(LoadStatus status)
     }
 }
 
+const Feed::HttpCache &Feed::httpCache() const
+{
+    return d->httpCache;
+}
+
+void Feed::setHttpCache(const HttpCache &httpCache)
+{
+    if (d->httpCache != httpCache) {
+        d->httpCache = httpCache;
+        emit httpCacheChanged();
+    }
+}
+
 const QDateTime &Feed::lastUpdate()
 {
     return d->lastUpdate;
@@ -173,6 +193,45 @@ void Feed::setUpdateInterval(qint64 updateInterval)
     }
 }
 
+qint64 Feed::postingInterval() const
+{
+    return d->postingInterval;
+}
+
+void Feed::setPostingInterval(qint64 postingInterval)
+{
+    if (postingInterval != d->postingInterval) {
+        d->postingInterval = postingInterval;
+        emit postingIntervalChanged();
+    }
+}
+
+int Feed::failureCount() const
+{
+    return d->failureCount;
+}
+
+void Feed::setFailureCount(int failureCount)
+{
+    if (failureCount != d->failureCount) {
+        d->failureCount = failureCount;
+        emit failureCountChanged();
+    }
+}
+
+const QDateTime &Feed::lastFailure() const
+{
+    return d->lastFailure;
+}
+
+void Feed::setLastFailure(const QDateTime &lastFailure)
+{
+    if (lastFailure != d->lastFailure) {
+        d->lastFailure = lastFailure;
+        emit lastFailureChanged();
+    }
+}
+
 Feed::UpdateMode Feed::expireMode()
 {
     return d->expireMode;
@@ -213,6 +272,41 @@ void Feed::updateParams(Feed *other)
     setExpireMode(other->expireMode());
 }
 
+Future<ArticleRef> *Feed::getArticlePage(bool unreadFilter, const ArticleRef &after, int /*limit*/)
+{
+    if (after.isNull()) {
+        return getArticles(unreadFilter);
+    }
+    return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+}
+
+Future<ArticleRows> *Feed::getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int /*limit*/)
+{
+    if (after.id == 0) {
+        return ArticleRows::describe(getArticles(unreadFilter));
+    }
+    return Future<ArticleRows>::yield(this, [](auto /*unused*/) {});
+}
+
+Future<qint64> *Feed::markAllRead(const QDateTime &upTo)
+{
+    auto *op = new Future<qint64>;
+    auto *articles = getArticles(true);
+    QObject::connect(articles, &BaseFuture::finished, this, [op, articles, upTo] {
+        qint64 changed{0};
+        for (const auto &article : articles->result()) {
+            if (!upTo.isValid() || article->date() <= upTo) {
+                article->setRead(true);
+                ++changed;
+            }
+        }
+        op->setResult(changed);
+        emit op->finished();
+        delete op;
+    });
+    return op;
+}
+
 bool Feed::editable()
 {
     return false;
@@ -280,12 +374,16 @@ const QDateTime &Feed::Updater::updateStartTime()
 void Feed::Updater::finish()
 {
     d->feed->setLastUpdate(d->updateStartTime);
+    d->feed->setFailureCount(0);
     d->feed->setStatus(LoadStatus::Idle);
 }
 
 void Feed::Updater::setError(const QString &errorMsg)
 {
     d->errorMsg = errorMsg;
+    // counted before the status changes, so that the scheduler sees it when it reschedules
+    d->feed->setLastFailure(d->updateStartTime);
+    d->feed->setFailureCount(d->feed->failureCount() + 1);
     d->feed->setStatus(LoadStatus::Error);
 }
 
@@ -5,6 +5,7 @@
 
 #ifndef FEEDCORE_FEED_H
 #define FEEDCORE_FEED_H
+#include "articlerows.h"
 #include "future.h"
 #include <QDateTime>
 #include <QObject>
@@ -73,6 +74,26 @@ class Feed : public QObject
      */
     Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged)
 
+    /**
+     * The typical time between the feed's articles, in seconds, as estimated by storage from
+     * the stored articles.  The scheduler uses it for feeds in AdaptiveUpdateMode.
+     *
+     * This is 0 if there is no estimate.
+     */
+    Q_PROPERTY(qint64 postingInterval READ postingInterval NOTIFY postingIntervalChanged)
+
+    /**
+     * How many updates in a row have failed.  The scheduler waits longer before retrying
+     * feeds that keep failing.
+     */
+    Q_PROPERTY(int failureCount READ failureCount NOTIFY failureCountChanged)
+
+    /**
+     * When the most recent failed update started.  Failing feeds are retried some time after
+     * this, so it is stored with the failureCount.
+     */
+    Q_PROPERTY(QDateTime lastFailure READ lastFailure NOTIFY lastFailureChanged)
+
     /**
      * Mode for determining when to delete old items.
      */
@@ -101,6 +122,25 @@ class Feed : public QObject
 public:
     class Updater;
 
+    /**
+     * Caching headers from the last response of the feed's source, which let updates
+     * skip downloads that would not change anything.
+     */
+    struct HttpCache {
+        QString etag;
+        QString lastModified; /** < kept as the server sent it, to be sent back verbatim */
+        QDateTime expires; /** < the source is not fetched again before this time */
+
+        bool operator==(const HttpCache &other) const
+        {
+            return etag == other.etag && lastModified == other.lastModified && expires == other.expires;
+        }
+        bool operator!=(const HttpCache &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
     enum LoadStatus {
         Idle, /** < no active updates */
         Loading, /** < feed is being loaded from the storage backend */
@@ -113,6 +153,7 @@ public:
         InheritUpdateMode, /** < Use update parameters provided by the context */
         OverrideUpdateMode, /** < Use update parameters specified by the feed */
         DisableUpdateMode, /** < Disable automatic updates */
+        AdaptiveUpdateMode, /** < Update about as often as the feed publishes articles */
     };
     Q_ENUM(UpdateMode)
 
@@ -125,6 +166,34 @@ public:
      */
     virtual Future<ArticleRef> *getArticles(bool unreadFilter) = 0;
 
+    /**
+     * Returns a future representing one page of this feed's articles, newest first.
+     *
+     * The page holds at most /limit/ articles that sort after /after/; pass a null ArticleRef
+     * to request the first page.  The default implementation returns every article from
+     * getArticles() as the first page, and an empty page after that.
+     */
+    virtual Future<ArticleRef> *getArticlePage(bool unreadFilter, const ArticleRef &after, int limit);
+
+    /**
+     * Like getArticlePage, but the page is returned as rows, so that only the articles that
+     * are opened need to be created.
+     *
+     * /after/ is the last row of the previous page; pass an empty row to request the first
+     * page.  The default implementation describes every article from getArticles() as the
+     * first page, and returns an empty page after that.
+     */
+    virtual Future<ArticleRows> *getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit);
+
+    /**
+     * Mark every article in this feed dated at or before /upTo/ as read.  Pass an invalid
+     * QDateTime to mark every article.
+     *
+     * The future's result is the number of articles that changed.  The default implementation
+     * loads the unread articles and marks them one at a time; storage-backed feeds do it in bulk.
+     */
+    virtual Future<qint64> *markAllRead(const QDateTime &upTo = {});
+
     virtual Updater *updater() = 0;
 
     virtual bool editable();
@@ -161,11 +230,23 @@ public:
     void setUpdateMode(UpdateMode updateMode);
     qint64 updateInterval();
     void setUpdateInterval(qint64 updateInterval);
+    qint64 postingInterval() const;
+    void setPostingInterval(qint64 postingInterval);
+    int failureCount() const;
+    void setFailureCount(int failureCount);
+    const QDateTime &lastFailure() const;
+    void setLastFailure(const QDateTime &lastFailure);
     UpdateMode expireMode();
     void setExpireMode(UpdateMode expireMode);
     void setExpireAge(qint64 expireAge);
     qint64 expireAge();
 
+    /**
+     * The caching headers are reset whenever the url changes.
+     */
+    const HttpCache &httpCache() const;
+    void setHttpCache(const HttpCache &httpCache);
+
 signals:
     /**
      * Emitted when an article has been added to the feed.
@@ -197,8 +278,12 @@ signals:
     void lastUpdateChanged();
     void updateModeChanged();
     void updateIntervalChanged();
+    void postingIntervalChanged();
+    void failureCountChanged();
+    void lastFailureChanged();
     void expireModeChanged();
     void expireAgeChanged();
+    void httpCacheChanged();
 
 protected:
     explicit Feed(QObject *parent = nullptr);
@@ -259,14 +344,16 @@ public:
 
 protected:
     /**
-     * Called by implemetations when an update completes successfuly.
+     * Called by implemetations when an update completes successfuly.  This resets the
+     * feed's failureCount.
      *
      * This should *not* be called when an error has occurred.
      */
     void finish();
 
     /**
-     * Called by implementations when an update fails with an error
+     * Called by implementations when an update fails with an error.  This increments the
+     * feed's failureCount and sets its lastFailure to the start of this update.
      */
     void setError(const QString &errorMsg);
 
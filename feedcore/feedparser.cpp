@@ -0,0 +1,161 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "feedparser.h"
+#include "xmlfeedparser.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QThreadPool>
+#include <Syndication/DocumentSource>
+#include <Syndication/Feed>
+#include <Syndication/Global>
+#include <Syndication/Image>
+#include <Syndication/Item>
+#include <Syndication/Person>
+
+namespace FeedCore
+{
+// Syndication's parser collection is a lazily created singleton that records the last error
+// in a member, so only one thread may use it at a time
+static QMutex syndicationMutex;
+
+/**
+ * Find a feed that an HTML page links to, as Syndication::Loader does when a download is
+ * not a feed.
+ */
+static QUrl discoverFeedUrl(const QByteArray &data, const QUrl &url)
+{
+    static const QRegularExpression linkTag{"<link\\b[^>]*>", QRegularExpression::CaseInsensitiveOption};
+    static const QRegularExpression feedType{"\\btype\\s*=\\s*[\"']?application/(rss|atom|rdf)\\+xml", QRegularExpression::CaseInsensitiveOption};
+    static const QRegularExpression alternate{"\\brel\\s*=\\s*[\"']?[^\"'>]*\\balternate\\b", QRegularExpression::CaseInsensitiveOption};
+    static const QRegularExpression href{"\\bhref\\s*=\\s*(?:\"([^\"]*)\"|'([^']*)'|([^\\s>]+))", QRegularExpression::CaseInsensitiveOption};
+    const QString &document{QString::fromUtf8(data)};
+    auto tags = linkTag.globalMatch(document);
+    while (tags.hasNext()) {
+        const QString &tag{tags.next().captured()};
+        if (!tag.contains(feedType) || !tag.contains(alternate)) {
+            continue;
+        }
+        const auto &link = href.match(tag);
+        if (link.hasMatch()) {
+            const QString &target{link.captured(1) + link.captured(2) + link.captured(3)};
+            return url.resolved(QUrl(target.trimmed()));
+        }
+    }
+    return {};
+}
+
+/**
+ * Copy what storage needs out of a document read by Syndication.  The Syndication objects share
+ * unsynchronised reference counts, so they must not outlive the worker thread.
+ */
+static void fromSyndication(const Syndication::FeedPtr &feed, ParsedFeed &result)
+{
+    result.isFeed = true;
+    result.title = feed->title();
+    result.link = QUrl(feed->link());
+    if (feed->icon()) {
+        result.icon = QUrl(feed->icon()->url());
+    }
+    const auto &items = feed->items();
+    result.items.reserve(items.size());
+    for (const auto &item : items) {
+        ParsedItem parsed;
+        parsed.id = item->id();
+        parsed.title = item->title();
+        const auto &authors = item->authors();
+        if (!authors.isEmpty()) {
+            parsed.author = authors[0]->name();
+        }
+        parsed.url = QUrl(item->link());
+        parsed.date = item->dateUpdated();
+        parsed.content = item->content();
+        if (parsed.content.isEmpty()) {
+            parsed.content = item->description();
+        }
+        result.items.append(parsed);
+    }
+}
+
+ParsedFeed parseDocument(const QByteArray &data, const QUrl &url)
+{
+    ParsedFeed result;
+    QElapsedTimer timer;
+    timer.start();
+
+    XmlFeedParser parser(data);
+    if (parser.parse([&result](ParsedItem &&item) {
+            result.items.append(std::move(item));
+        })) {
+        result.isFeed = true;
+        result.streamed = true;
+        result.title = parser.title();
+        result.link = parser.link();
+        result.icon = parser.icon();
+    } else {
+        result.items.clear();
+        QMutexLocker lock(&syndicationMutex);
+        const auto &feed = Syndication::parse(Syndication::DocumentSource(data, url.toString()));
+        if (feed) {
+            fromSyndication(feed, result);
+        }
+    }
+    if (!result.isFeed) {
+        result.discoveredUrl = discoverFeedUrl(data, url);
+    }
+    result.parseTime = timer.elapsed();
+    return result;
+}
+
+namespace
+{
+class ParseTask : public QRunnable
+{
+public:
+    ParseTask(const QByteArray &data, const QUrl &url, Future<ParsedFeed> *op)
+        : m_data{data}
+        , m_url{url}
+        , m_op{op}
+    {
+    }
+
+    void run() override
+    {
+        const auto &result = parseDocument(m_data, m_url);
+
+        // the future lives on the caller's thread, and is only deleted from there
+        auto *op = m_op;
+        QMetaObject::invokeMethod(
+            op,
+            [op, result] {
+                op->setResult(result);
+                emit op->finished();
+                op->deleteLater();
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    QByteArray m_data;
+    QUrl m_url;
+    Future<ParsedFeed> *m_op;
+};
+}
+
+Future<ParsedFeed> *parseFeed(const QByteArray &data, const QUrl &url)
+{
+    auto *op = new Future<ParsedFeed>;
+    parserThreadPool()->start(new ParseTask(data, url, op));
+    return op;
+}
+
+QThreadPool *parserThreadPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+}
@@ -0,0 +1,61 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef FEEDCORE_FEEDPARSER_H
+#define FEEDCORE_FEEDPARSER_H
+#include "future.h"
+#include <QByteArray>
+#include <QUrl>
+#include <QVector>
+
+class QThreadPool;
+
+namespace FeedCore
+{
+/**
+ * The fields of one item in a downloaded feed, as storage needs them.
+ */
+struct ParsedItem {
+    QString id; /** < unique within the feed */
+    QString title; /** < HTML */
+    QString author;
+    QUrl url;
+    time_t date{0}; /** < 0 if the source does not provide a date */
+    QString content; /** < HTML; the item's description if it has no content */
+};
+
+/**
+ * The result of parsing a downloaded feed document.
+ */
+struct ParsedFeed {
+    bool isFeed{false}; /** < false if the document is not a feed */
+    QString title;
+    QUrl link;
+    QUrl icon;
+    QVector<ParsedItem> items; /** < in document order */
+    QUrl discoveredUrl; /** < if the document is a web page, the feed that it links to */
+    bool streamed{false}; /** < whether XmlFeedParser read the document, rather than Syndication */
+    qint64 parseTime{0}; /** < msecs spent parsing */
+};
+
+/**
+ * Parse /data/, downloaded from /url/, on the calling thread.
+ *
+ * RSS and Atom documents are read with XmlFeedParser; anything it does not handle is passed to
+ * the Syndication library.
+ */
+ParsedFeed parseDocument(const QByteArray &data, const QUrl &url);
+
+/**
+ * Run parseDocument on the parser thread pool.  The future finishes on the calling thread.
+ */
+Future<ParsedFeed> *parseFeed(const QByteArray &data, const QUrl &url);
+
+/**
+ * The thread pool that parseFeed runs on.
+ */
+QThreadPool *parserThreadPool();
+}
+#endif // FEEDCORE_FEEDPARSER_H
@@ -5,27 +5,25 @@
 
 #include "provisionalfeed.h"
 #include "article.h"
-#include <Syndication/Image>
-#include <Syndication/Item>
-#include <Syndication/Person>
 using namespace FeedCore;
 
 class ProvisionalFeed::ArticleImpl : public Article
 {
 public:
-    explicit ArticleImpl(const Syndication::ItemPtr &item, Feed *feed, QObject *parent = nullptr);
+    ArticleImpl(int index, const ParsedItem &item, Feed *feed, QObject *parent = nullptr);
     void requestContent() final;
     void setRead(bool isRead) final{};
     void setStarred(bool isStarred) final{};
 
 private:
-    Syndication::ItemPtr m_item;
+    QString m_content;
 };
 
 void ProvisionalFeed::onUrlChanged()
 {
     updater()->abort();
-    m_feed = nullptr;
+    m_items.clear();
+    m_articles = {};
     emit reset();
 }
 
@@ -41,26 +39,33 @@ ProvisionalFeed::ProvisionalFeed(QObject *parent)
 Future<ArticleRef> *ProvisionalFeed::getArticles(bool /* unreadFilter */)
 {
     return Future<ArticleRef>::yield(this, [this](auto *op) {
-        if (m_feed == nullptr) {
-            return;
-        }
-        const auto &items = m_feed->items();
-        for (const auto &item : items) {
-            op->appendResult(m_articles.getInstance(item, this));
+        for (int i = 0; i < m_items.size(); ++i) {
+            op->appendResult(m_articles.getInstance(i, m_items[i], this));
         }
     });
 }
 
-void ProvisionalFeed::updateFromSource(const Syndication::FeedPtr &feed)
+Future<StoredArticles> *ProvisionalFeed::updateFromSource(const ParsedFeed &feed)
 {
     if (name().isEmpty()) {
-        setName(feed->title());
+        setName(feed.title);
     }
-    setLink(feed->link());
-    setIcon(feed->icon()->url());
-    setUnreadCount(feed->items().size());
-    m_feed = feed;
+    setLink(feed.link);
+    setIcon(feed.icon);
+    return updateSourceArticles(feed.items);
+}
+
+Future<StoredArticles> *ProvisionalFeed::updateSourceArticles(const QVector<ParsedItem> &items)
+{
+    setUnreadCount(items.size());
+    m_items = items;
+    // the indexes now refer to different items
+    m_articles = {};
     emit reset();
+    // the items are only kept in memory, which can't fail
+    return Future<StoredArticles>::yield(this, [](auto *op) {
+        op->setResult(StoredArticles{true, {}});
+    });
 }
 
 Feed *ProvisionalFeed::targetFeed() const
@@ -88,17 +93,15 @@ void ProvisionalFeed::save()
 
 void ProvisionalFeed::ArticleImpl::requestContent()
 {
-    QString content{m_item->content()};
-    emit gotContent(content.isEmpty() ? m_item->description() : content);
+    emit gotContent(m_content);
 }
 
-ProvisionalFeed::ArticleImpl::ArticleImpl(const Syndication::ItemPtr &item, Feed *feed, QObject *parent)
+ProvisionalFeed::ArticleImpl::ArticleImpl(int /* index */, const ParsedItem &item, Feed *feed, QObject *parent)
     : Article(feed, parent)
-    , m_item(item)
+    , m_content(item.content)
 {
-    setTitle(item->title());
-    setUrl(item->link());
-    setDate(QDateTime::fromTime_t(item->dateUpdated()));
-    auto authors = item->authors();
-    setAuthor(authors.isEmpty() ? "" : authors[0]->name());
+    setTitle(item.title);
+    setUrl(item.url);
+    setDate(QDateTime::fromTime_t(item.date));
+    setAuthor(item.author);
 }
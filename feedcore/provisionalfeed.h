@@ -8,13 +8,12 @@
 #include "factory.h"
 #include "future.h"
 #include "updatablefeed.h"
-#include <Syndication/Feed>
 namespace FeedCore
 {
 /**
  * A minimal implementation of Feed, used for configuring and previewing feeds before commiting them to storage.
  *
- * This implementation provides preview content backed directly by a Syndication::Feed instance.
+ * This implementation provides preview content backed directly by the parsed source document.
  * Preview content is not downloaded automatically; call updater()->start() to fetch it from the remote source.
  *
  * The preview implementation does not do any state tracking -- marking a preview article as read, etc. is a no-op
@@ -53,13 +52,12 @@ signals:
 
 private:
     Feed *m_targetFeed{nullptr};
-    Syndication::FeedPtr m_feed;
+    QVector<ParsedItem> m_items;
     class ArticleImpl;
-    SharedFactory<Syndication::ItemPtr, ArticleImpl> m_articles;
+    SharedFactory<int, ArticleImpl> m_articles; /** < keyed by index in m_items */
     void onUrlChanged();
-    void updateFromSource(const Syndication::FeedPtr &feed) final;
-    void updateSourceArticle(const Syndication::ItemPtr &) final{};
-    void expire(const QDateTime &) final{};
+    Future<StoredArticles> *updateFromSource(const ParsedFeed &feed) final;
+    Future<StoredArticles> *updateSourceArticles(const QVector<ParsedItem> &items) final;
 };
 }
 #endif // FEEDCORE_PROVISIONALFEED_H
@@ -5,49 +5,245 @@
 
 #include "scheduler.h"
 #include "feed.h"
+#include "updatequeue.h"
+#include <QElapsedTimer>
+#include <QHash>
 #include <QNetworkConfigurationManager>
+#include <QRandomGenerator>
 #include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <limits>
 
 namespace FeedCore
 {
+// QTimer intervals are ints, and a long sleep could miss a change to the wall clock, so the
+// timer never sleeps longer than this and checks again when it wakes
+static constexpr qint64 maxSleep{60 * 60 * 1000};
+
+// an adaptive feed is checked this many times per article that it publishes
+static constexpr qint64 adaptiveChecksPerPost{2};
+static constexpr qint64 secsPerDay{24 * 60 * 60};
+
+// failing feeds wait twice as long after each failure, up to this or their update interval if that is longer
+static constexpr qint64 maxRetryInterval{secsPerDay};
+static constexpr int maxDoublings{62};
+
+// when the network changes, feeds with errors are retried this far apart on average, within the window
+static constexpr qint64 recoverySpacing{250};
+static constexpr qint64 maxRecoveryWindow{60 * 1000};
+
+/**
+ * Feeds ordered by the time that they become stale, in msecs since the epoch.
+ *
+ * This is a binary min-heap with an index of each feed's position, so that feeds can be
+ * moved or removed in O(log n) when their schedule changes.
+ */
 struct Scheduler::PrivData {
-    QList<Feed *> schedule;
+    struct Entry {
+        qint64 deadline;
+        Feed *feed;
+    };
+    QVector<Entry> heap;
+    QHash<Feed *, int> positions;
+    QSet<Feed *> feeds; /** < every scheduled feed, including those that are updating */
+    qint64 minAdaptiveInterval{15 * 60};
+    qint64 maxAdaptiveInterval{secsPerDay};
     QTimer timer;
+    qint64 armedDeadline{std::numeric_limits<qint64>::max()};
+    int resolution{0};
+    QElapsedTimer lastCheck;
+    UpdateQueue *queue;
+
+    qint64 interval(Feed *feed) const;
+    QDateTime nextUpdate(Feed *feed) const;
+    qint64 deadline(Feed *feed) const;
+    void insert(Feed *feed, qint64 deadline);
+    void remove(Feed *feed);
+    void place(int index, const Entry &entry);
+    void siftUp(int index);
+    void siftDown(int index);
+    void arm();
 };
 
-Scheduler::Scheduler(QObject *parent)
-    : QObject(parent)
-    , d(std::make_unique<PrivData>())
+qint64 Scheduler::PrivData::interval(Feed *feed) const
 {
+    const qint64 postingInterval{feed->postingInterval()};
+    if (feed->updateMode() != Feed::AdaptiveUpdateMode || postingInterval <= 0) {
+        return feed->updateInterval();
+    }
+    return std::clamp(postingInterval / adaptiveChecksPerPost, minAdaptiveInterval, std::max(minAdaptiveInterval, maxAdaptiveInterval));
 }
 
-Scheduler::~Scheduler() = default;
-
-static QDateTime nextUpdate(Feed *feed)
+QDateTime Scheduler::PrivData::nextUpdate(Feed *feed) const
 {
     const QDateTime &updateStartTime = feed->updater()->updateStartTime();
     QDateTime lastUpdate{updateStartTime.isValid() ? updateStartTime : feed->lastUpdate()};
-    return lastUpdate.addSecs(feed->updateInterval());
+    return lastUpdate.addSecs(interval(feed));
 }
 
-static bool needsUpdate(Feed *feed, const QDateTime &timestamp)
+/**
+ * How long to wait after the /failures/th failure in a row, in msecs.
+ *
+ * The backoff doubles from twice the interval up to a day, or the interval if that is longer.
+ * The delay is picked at random from the upper half of the backoff, so that feeds which failed
+ * together don't retry together, but never sooner than the interval.
+ */
+static qint64 retryDelay(qint64 interval, int failures)
 {
-    return nextUpdate(feed) < timestamp;
+    const qint64 first{interval * 1000};
+    const qint64 cap{std::max(first, maxRetryInterval * 1000)};
+    // compare before shifting, since the shifted interval can overflow long before the doublings run out
+    const int doublings{std::clamp(failures, 0, maxDoublings)};
+    const qint64 backoff{(cap >> doublings) < first ? cap : first << doublings};
+    const qint64 shortest{std::max(first, backoff / 2)};
+    return shortest + static_cast<qint64>(QRandomGenerator::global()->generateDouble() * (backoff - shortest));
 }
 
-void insertIntoSchedule(QList<Feed *> &schedule, Feed *feed)
+qint64 Scheduler::PrivData::deadline(Feed *feed) const
 {
-    if (feed->updateMode() == Feed::DisableUpdateMode || feed->updateInterval() <= 0) {
+    // failing feeds are retried relative to their last attempt, which is kept across restarts
+    const int failures{feed->failureCount()};
+    const QDateTime &lastFailure{feed->lastFailure()};
+    if (failures > 0 && lastFailure.isValid()) {
+        return lastFailure.toMSecsSinceEpoch() + retryDelay(interval(feed), failures);
+    }
+    // feeds that have never been updated are due immediately
+    const QDateTime &next{nextUpdate(feed)};
+    if (!next.isValid()) {
+        return std::numeric_limits<qint64>::min();
+    }
+    return next.toMSecsSinceEpoch();
+}
+
+void Scheduler::PrivData::insert(Feed *feed, qint64 deadline)
+{
+    const auto &existing = positions.constFind(feed);
+    if (existing != positions.constEnd()) {
+        const int index{*existing};
+        const qint64 previous{heap[index].deadline};
+        heap[index].deadline = deadline;
+        if (deadline < previous) {
+            siftUp(index);
+        } else {
+            siftDown(index);
+        }
+    } else {
+        heap.append({deadline, feed});
+        positions.insert(feed, heap.size() - 1);
+        siftUp(heap.size() - 1);
+    }
+    arm();
+}
+
+void Scheduler::PrivData::remove(Feed *feed)
+{
+    const auto &existing = positions.constFind(feed);
+    if (existing == positions.constEnd()) {
         return;
     }
-    const QDateTime &updateTime{nextUpdate(feed)};
-    for (auto i = schedule.begin(); i != schedule.end(); ++i) {
-        if (nextUpdate(*i) > updateTime) {
-            schedule.insert(i, feed);
-            return;
+    const int index{*existing};
+    positions.erase(existing);
+    const Entry last{heap.takeLast()};
+    if (index < heap.size()) {
+        place(index, last);
+        siftUp(index);
+        siftDown(positions.value(last.feed));
+    }
+    arm();
+}
+
+void Scheduler::PrivData::place(int index, const Entry &entry)
+{
+    heap[index] = entry;
+    positions[entry.feed] = index;
+}
+
+void Scheduler::PrivData::siftUp(int index)
+{
+    const Entry entry{heap[index]};
+    while (index > 0) {
+        const int parent{(index - 1) / 2};
+        if (heap[parent].deadline <= entry.deadline) {
+            break;
+        }
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, entry);
+}
+
+void Scheduler::PrivData::siftDown(int index)
+{
+    const Entry entry{heap[index]};
+    const int size = heap.size();
+    while (true) {
+        int child{index * 2 + 1};
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && heap[child + 1].deadline < heap[child].deadline) {
+            ++child;
         }
+        if (entry.deadline <= heap[child].deadline) {
+            break;
+        }
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, entry);
+}
+
+void Scheduler::PrivData::arm()
+{
+    if (!lastCheck.isValid()) {
+        // the scheduler has not been started
+        return;
+    }
+    if (heap.isEmpty()) {
+        timer.stop();
+        armedDeadline = std::numeric_limits<qint64>::max();
+        return;
+    }
+    const qint64 deadline{heap.first().deadline};
+    if (timer.isActive() && deadline == armedDeadline) {
+        return;
+    }
+    armedDeadline = deadline;
+    // feeds are stale once their deadline has passed, so wake just after it
+    qint64 delay{deadline == std::numeric_limits<qint64>::min() ? 0 : deadline - QDateTime::currentMSecsSinceEpoch() + 1};
+    delay = std::max(delay, resolution - lastCheck.elapsed());
+    timer.start(static_cast<int>(std::clamp(delay, qint64(0), maxSleep)));
+}
+
+Scheduler::Scheduler(QObject *parent)
+    : QObject(parent)
+    , d(std::make_unique<PrivData>())
+{
+    d->queue = new UpdateQueue(this);
+    d->timer.setSingleShot(true);
+    d->timer.callOnTimeout(this, &Scheduler::updateStale);
+}
+
+Scheduler::~Scheduler() = default;
+
+void Scheduler::insertIntoSchedule(Feed *feed)
+{
+    if (feed->updateMode() == Feed::DisableUpdateMode || d->interval(feed) <= 0) {
+        d->remove(feed);
+        return;
+    }
+    d->insert(feed, d->deadline(feed));
+}
+
+void Scheduler::enqueue(Feed *feed, const QDateTime &timestamp)
+{
+    d->queue->enqueue(feed, timestamp, UpdateQueue::Scheduled, d->nextUpdate(feed));
+    if (feed->status() != LoadStatus::Updating && !d->positions.contains(feed)) {
+        // the queue is full; check again later, as the old polling timer would have
+        d->insert(feed, QDateTime::currentMSecsSinceEpoch() + std::max(d->resolution, 1000));
     }
-    schedule.append(feed);
 }
 
 void Scheduler::schedule(Feed *feed, const QDateTime &timestamp)
@@ -58,23 +254,32 @@ void Scheduler::schedule(Feed *feed, const QDateTime &timestamp)
     QObject::connect(feed, &Feed::updateIntervalChanged, this, [this, feed] {
         reschedule(feed);
     });
+    QObject::connect(feed, &Feed::postingIntervalChanged, this, [this, feed] {
+        if (feed->updateMode() == Feed::AdaptiveUpdateMode) {
+            reschedule(feed);
+        }
+    });
     QObject::connect(feed, &QObject::destroyed, this, [this, feed] {
-        d->schedule.removeAll(feed);
+        d->remove(feed);
+        d->feeds.remove(feed);
     });
+    d->feeds.insert(feed);
     reschedule(feed, timestamp);
 }
 
 void Scheduler::unschedule(Feed *feed)
 {
-    d->schedule.removeOne(feed);
+    d->remove(feed);
+    d->feeds.remove(feed);
+    d->queue->remove(feed);
     QObject::disconnect(feed, nullptr, this, nullptr);
 }
 
 void Scheduler::start(int resolution)
 {
-    d->timer.setInterval(resolution);
-    d->timer.callOnTimeout(this, &Scheduler::updateStale);
-    d->timer.start();
+    d->resolution = resolution;
+    d->lastCheck.start();
+    d->arm();
 
     // also update immediately, in case anything was scheduled while we were stopped
     QTimer::singleShot(0, this, &Scheduler::updateStale);
@@ -83,63 +288,124 @@ void Scheduler::start(int resolution)
 void Scheduler::stop()
 {
     d->timer.stop();
-}
-
-static void updateMany(const QDateTime &timestamp, const QList<Feed::Updater *> &toUpdate)
-{
-    for (auto *entry : toUpdate) {
-        entry->start(timestamp);
-    }
+    d->lastCheck.invalidate();
 }
 
 void Scheduler::updateStale()
 {
-    // find all the stale feeds before we start updating them so that we don't modify the schedule while we're searching it...
+    // take the stale feeds off the heap before we start updating them, since starting them changes the heap
     const auto &timestamp = QDateTime::currentDateTime();
-    QList<Feed::Updater *> toUpdate{};
-    const auto &schedule{d->schedule};
-    for (Feed *entry : schedule) {
-        if (!needsUpdate(entry, timestamp)) {
-            break;
-        }
-        toUpdate << entry->updater();
+    const qint64 now{timestamp.toMSecsSinceEpoch()};
+    QList<Feed *> toUpdate{};
+    while (!d->heap.isEmpty() && d->heap.first().deadline < now) {
+        Feed *feed{d->heap.first().feed};
+        toUpdate << feed;
+        d->remove(feed);
+    }
+    if (d->lastCheck.isValid()) {
+        d->lastCheck.start();
+    }
+    for (Feed *feed : qAsConst(toUpdate)) {
+        enqueue(feed, timestamp);
     }
-    updateMany(timestamp, toUpdate);
+    d->arm();
 }
 
 void Scheduler::clearErrors()
 {
     QList<Feed *> errorFeeds;
-    for (Feed *feed : qAsConst(d->schedule)) {
-        if (feed->status() == Feed::Error) {
-            errorFeeds << feed;
+    for (const auto &entry : qAsConst(d->heap)) {
+        if (entry.feed->status() == Feed::Error) {
+            errorFeeds << entry.feed;
         }
     }
-    QDateTime timestamp{QDateTime::currentDateTime()};
+    // a network change usually affects many feeds, so their retries are spread out instead of
+    // starting all at once; they keep their failure counts in case the network is still broken
+    const qint64 now{QDateTime::currentMSecsSinceEpoch()};
+    const qint64 window{std::min(errorFeeds.size() * recoverySpacing, maxRecoveryWindow)};
     for (Feed *feed : qAsConst(errorFeeds)) {
-        feed->updater()->start(timestamp);
+        d->insert(feed, now + static_cast<qint64>(QRandomGenerator::global()->generateDouble() * window));
     }
 }
 
+UpdateQueue *Scheduler::updateQueue() const
+{
+    return d->queue;
+}
+
+qint64 Scheduler::updateInterval(Feed *feed) const
+{
+    return d->interval(feed);
+}
+
+void Scheduler::setAdaptiveIntervalLimits(qint64 minimum, qint64 maximum)
+{
+    if (minimum == d->minAdaptiveInterval && maximum == d->maxAdaptiveInterval) {
+        return;
+    }
+    d->minAdaptiveInterval = minimum;
+    d->maxAdaptiveInterval = maximum;
+    const auto feeds = d->feeds;
+    for (Feed *feed : feeds) {
+        if (feed->updateMode() == Feed::AdaptiveUpdateMode) {
+            reschedule(feed);
+        }
+    }
+}
+
+qint64 Scheduler::minAdaptiveInterval() const
+{
+    return d->minAdaptiveInterval;
+}
+
+qint64 Scheduler::maxAdaptiveInterval() const
+{
+    return d->maxAdaptiveInterval;
+}
+
+AdaptiveUpdateStats Scheduler::adaptiveStats() const
+{
+    AdaptiveUpdateStats stats;
+    for (Feed *feed : qAsConst(d->feeds)) {
+        const qint64 fixed{feed->updateInterval()};
+        const qint64 adaptive{d->interval(feed)};
+        if (feed->updateMode() != Feed::AdaptiveUpdateMode || fixed <= 0 || adaptive <= 0) {
+            continue;
+        }
+        ++stats.feeds;
+        stats.fixedFetchesPerDay += double(secsPerDay) / fixed;
+        stats.adaptiveFetchesPerDay += double(secsPerDay) / adaptive;
+    }
+    return stats;
+}
+
 void Scheduler::reschedule(Feed *feed, const QDateTime &timestamp)
 {
-    d->schedule.removeOne(feed);
+    d->remove(feed);
     if (feed->status() == LoadStatus::Updating) {
         return;
     }
-    if (needsUpdate(feed, timestamp)) {
-        feed->updater()->start();
+    if (feed->updateMode() == Feed::DisableUpdateMode || d->interval(feed) <= 0) {
+        // feeds without automatic updates are not scheduled, but are still updated once if stale
+        if (d->nextUpdate(feed) < timestamp) {
+            enqueue(feed, QDateTime::currentDateTime());
+        }
+        return;
+    }
+    const qint64 deadline{d->deadline(feed)};
+    if (deadline < timestamp.toMSecsSinceEpoch()) {
+        enqueue(feed, QDateTime::currentDateTime());
     } else {
-        insertIntoSchedule(d->schedule, feed);
+        d->insert(feed, deadline);
     }
 }
 
 void Scheduler::onFeedStatusChanged(Feed *sender)
 {
     if (sender->status() == LoadStatus::Updating) {
-        d->schedule.removeOne(sender);
+        d->remove(sender);
     } else {
-        insertIntoSchedule(d->schedule, sender);
+        insertIntoSchedule(sender);
     }
 }
 
@@ -13,8 +13,38 @@
 
 namespace FeedCore
 {
+class UpdateQueue;
+
+/**
+ * What AdaptiveUpdateMode does to the number of updates, for the feeds that use it.
+ */
+struct AdaptiveUpdateStats {
+    Q_GADGET
+    Q_PROPERTY(int feeds MEMBER feeds)
+    Q_PROPERTY(double fixedFetchesPerDay MEMBER fixedFetchesPerDay)
+    Q_PROPERTY(double adaptiveFetchesPerDay MEMBER adaptiveFetchesPerDay)
+    Q_PROPERTY(double savedFetchesPerDay READ savedFetchesPerDay)
+
+public:
+    int feeds{0}; /** < scheduled feeds in AdaptiveUpdateMode */
+    double fixedFetchesPerDay{0}; /** < how often those feeds would be updated at their fixed updateInterval */
+    double adaptiveFetchesPerDay{0}; /** < how often they are updated at the adaptive intervals */
+
+    /**
+     * Negative if the feeds publish faster than their fixed interval.
+     */
+    double savedFetchesPerDay() const
+    {
+        return fixedFetchesPerDay - adaptiveFetchesPerDay;
+    }
+};
+
 /**
  * Automatically update feeds when they become stale
+ *
+ * Stale feeds are started through an UpdateQueue, in the order that they became due.  The
+ * scheduler keeps its feeds in a heap ordered by the time that each one becomes stale, and
+ * only wakes up when the earliest of those times arrives.
  */
 class Scheduler : public QObject
 {
@@ -39,8 +69,9 @@ public:
     /**
      * Start the update timer
      *
-     * Once this method is called, stale feeds will be checked for every /resolution/ msecs
-     * until stop() is called.
+     * Once this method is called, feeds will be updated as they become stale until stop() is
+     * called.  To batch updates that fall close together, stale feeds are checked at most once
+     * every /resolution/ msecs.
      */
     void start(int resolution = 60000);
 
@@ -59,13 +90,44 @@ public:
      */
     void clearErrors();
 
+    /**
+     * The queue that scheduled updates go through.  It belongs to the scheduler.
+     */
+    UpdateQueue *updateQueue() const;
+
+    /**
+     * The time between scheduled updates of /feed/, in seconds.
+     *
+     * This is the feed's updateInterval, except in AdaptiveUpdateMode, where it is half of the
+     * feed's postingInterval, kept between the adaptive limits.  Feeds in AdaptiveUpdateMode
+     * that have no postingInterval use their updateInterval.
+     */
+    qint64 updateInterval(Feed *feed) const;
+
+    /**
+     * Keep the intervals of feeds in AdaptiveUpdateMode between /minimum/ and /maximum/
+     * seconds.  The defaults are 15 minutes and a day.
+     */
+    void setAdaptiveIntervalLimits(qint64 minimum, qint64 maximum);
+    qint64 minAdaptiveInterval() const;
+    qint64 maxAdaptiveInterval() const;
+
+    /**
+     * Compare the update rate of the scheduled feeds in AdaptiveUpdateMode with the rate at
+     * their fixed intervals.
+     */
+    AdaptiveUpdateStats adaptiveStats() const;
+
 private:
     struct PrivData;
     std::unique_ptr<PrivData> d;
     void reschedule(Feed *feed, const QDateTime &timestamp = QDateTime::currentDateTime());
+    void insertIntoSchedule(Feed *feed);
+    void enqueue(Feed *feed, const QDateTime &timestamp);
     void onUpdateModeChanged(Feed *feed);
     void onFeedStatusChanged(Feed *sender);
     void onNetworkStateChanged();
 };
 }
+Q_DECLARE_METATYPE(FeedCore::AdaptiveUpdateStats);
 #endif // FEEDCORE_SCHEDULER_H
@@ -0,0 +1,93 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "searchfeed.h"
+#include "context.h"
+using namespace FeedCore;
+
+class SearchFeed::SearchUpdater : public Updater
+{
+public:
+    explicit SearchUpdater(SearchFeed *parent)
+        : Updater(parent, parent)
+    {
+    }
+
+    void run() override
+    {
+        finish();
+    }
+};
+
+SearchFeed::SearchFeed(QObject *parent)
+    : Feed(parent)
+    , m_updater{new SearchUpdater(this)}
+{
+}
+
+SearchFeed::SearchFeed(FeedCore::Context *context, const QString &name, QObject *parent)
+    : Feed(parent)
+    , m_context{context}
+    , m_updater{new SearchUpdater(this)}
+{
+    setName(name);
+}
+
+QString SearchFeed::query() const
+{
+    return m_query;
+}
+
+void SearchFeed::setQuery(const QString &query)
+{
+    if (m_query != query) {
+        m_query = query;
+        emit queryChanged();
+        emit reset();
+    }
+}
+
+Context *SearchFeed::context() const
+{
+    return m_context;
+}
+
+void SearchFeed::setContext(Context *context)
+{
+    if (m_context != context) {
+        m_context = context;
+        emit contextChanged();
+        emit reset();
+    }
+}
+
+Future<ArticleRef> *SearchFeed::getArticles(bool /*unused*/)
+{
+    if (m_context == nullptr) {
+        return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+    }
+    return m_context->search(m_query, {}, -1);
+}
+
+Future<ArticleRef> *SearchFeed::getArticlePage(bool /*unused*/, const ArticleRef &after, int limit)
+{
+    if (m_context == nullptr) {
+        return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+    }
+    return m_context->search(m_query, after, limit);
+}
+
+Future<ArticleRows> *SearchFeed::getArticleRows(bool /*unused*/, const ArticleRows::Row &after, int limit)
+{
+    if (m_context == nullptr) {
+        return Future<ArticleRows>::yield(this, [](auto /*unused*/) {});
+    }
+    return m_context->searchRows(m_query, after, limit);
+}
+
+Feed::Updater *SearchFeed::updater()
+{
+    return m_updater;
+}
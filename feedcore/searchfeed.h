@@ -0,0 +1,55 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef FEEDCORE_SEARCHFEED_H
+#define FEEDCORE_SEARCHFEED_H
+#include "feed.h"
+namespace FeedCore
+{
+class Context;
+
+/**
+ * A Feed implementation which lists the articles from all feeds in a context
+ * that match a search query, best match first.
+ */
+class SearchFeed : public Feed
+{
+    Q_OBJECT
+
+    /**
+     * The words to search for.  Changing the query resets the feed.
+     */
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged);
+
+    /**
+     * The context to search.  This is set by the constructor, or from QML.
+     */
+    Q_PROPERTY(FeedCore::Context *context READ context WRITE setContext NOTIFY contextChanged);
+
+public:
+    explicit SearchFeed(QObject *parent = nullptr);
+    SearchFeed(Context *context, const QString &name, QObject *parent = nullptr);
+    QString query() const;
+    void setQuery(const QString &query);
+    Context *context() const;
+    void setContext(Context *context);
+    Future<ArticleRef> *getArticles(bool unreadFilter) final;
+    Future<ArticleRef> *getArticlePage(bool unreadFilter, const ArticleRef &after, int limit) final;
+    Future<ArticleRows> *getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit) final;
+    Updater *updater() final;
+
+signals:
+    void queryChanged();
+    void contextChanged();
+
+private:
+    Context *m_context{nullptr};
+    Updater *m_updater{nullptr};
+    QString m_query;
+    class SearchUpdater;
+};
+}
+
+#endif // FEEDCORE_SEARCHFEED_H
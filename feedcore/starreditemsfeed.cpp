@@ -34,6 +34,16 @@ Future<ArticleRef> *StarredItemsFeed::getArticles(bool /*unused*/)
     return m_context->getStarred();
 }
 
+Future<ArticleRef> *StarredItemsFeed::getArticlePage(bool /*unused*/, const ArticleRef &after, int limit)
+{
+    return m_context->getStarredPage(after, limit);
+}
+
+Future<ArticleRows> *StarredItemsFeed::getArticleRows(bool /*unused*/, const ArticleRows::Row &after, int limit)
+{
+    return m_context->getStarredRows(after, limit);
+}
+
 Feed::Updater *StarredItemsFeed::updater()
 {
     return m_updater;
@@ -19,6 +19,8 @@ class StarredItemsFeed : public Feed
 public:
     StarredItemsFeed(Context *context, const QString &name, QObject *parent = nullptr);
     Future<ArticleRef> *getArticles(bool unreadFilter) final;
+    Future<ArticleRef> *getArticlePage(bool unreadFilter, const ArticleRef &after, int limit) final;
+    Future<ArticleRows> *getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit) final;
     Updater *updater() final;
 
 private:
@@ -0,0 +1,142 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "storage.h"
+#include "article.h"
+#include "feed.h"
+#include <functional>
+using namespace FeedCore;
+
+Future<ArticleRef> *Storage::getAllPage(const ArticleRef &after, int /*limit*/)
+{
+    if (after.isNull()) {
+        return getAll();
+    }
+    return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+}
+
+Future<ArticleRef> *Storage::getUnreadPage(const ArticleRef &after, int /*limit*/)
+{
+    if (after.isNull()) {
+        return getUnread();
+    }
+    return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+}
+
+Future<ArticleRef> *Storage::getStarredPage(const ArticleRef &after, int /*limit*/)
+{
+    if (after.isNull()) {
+        return getStarred();
+    }
+    return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+}
+
+Future<ArticleRef> *Storage::search(const QString & /*query*/, const ArticleRef & /*after*/, int /*limit*/)
+{
+    return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+}
+
+static Future<ArticleRows> *firstPageRows(Storage *storage, const ArticleRows::Row &after, const std::function<Future<ArticleRef> *()> &getPage)
+{
+    if (after.id == 0) {
+        return ArticleRows::describe(getPage());
+    }
+    return Future<ArticleRows>::yield(storage, [](auto /*unused*/) {});
+}
+
+Future<ArticleRows> *Storage::getAllRows(const ArticleRows::Row &after, int limit)
+{
+    return firstPageRows(this, after, [this, limit] {
+        return getAllPage({}, limit);
+    });
+}
+
+Future<ArticleRows> *Storage::getUnreadRows(const ArticleRows::Row &after, int limit)
+{
+    return firstPageRows(this, after, [this, limit] {
+        return getUnreadPage({}, limit);
+    });
+}
+
+Future<ArticleRows> *Storage::getStarredRows(const ArticleRows::Row &after, int limit)
+{
+    return firstPageRows(this, after, [this, limit] {
+        return getStarredPage({}, limit);
+    });
+}
+
+Future<ArticleRows> *Storage::searchRows(const QString &query, const ArticleRows::Row &after, int limit)
+{
+    return firstPageRows(this, after, [this, query, limit] {
+        return search(query, {}, limit);
+    });
+}
+
+Future<qint64> *Storage::markRead(const QVector<ArticleRef> &articles, bool isRead)
+{
+    return Future<qint64>::yield(this, [articles, isRead](auto *op) {
+        qint64 changed{0};
+        for (const auto &article : articles) {
+            if (article->isRead() != isRead) {
+                article->setRead(isRead);
+                ++changed;
+            }
+        }
+        op->setResult(changed);
+    });
+}
+
+Future<qint64> *Storage::markStarred(const QVector<ArticleRef> &articles, bool isStarred)
+{
+    return Future<qint64>::yield(this, [articles, isStarred](auto *op) {
+        qint64 changed{0};
+        for (const auto &article : articles) {
+            if (article->isStarred() != isStarred) {
+                article->setStarred(isStarred);
+                ++changed;
+            }
+        }
+        op->setResult(changed);
+    });
+}
+
+static Future<qint64> *markLoadedRead(QObject *context, Future<ArticleRef> *articles, const QDateTime &upTo)
+{
+    auto *op = new Future<qint64>;
+    QObject::connect(articles, &BaseFuture::finished, context, [op, articles, upTo] {
+        qint64 changed{0};
+        for (const auto &article : articles->result()) {
+            if (!article->isRead() && (!upTo.isValid() || article->date() <= upTo)) {
+                article->setRead(true);
+                ++changed;
+            }
+        }
+        op->setResult(changed);
+        emit op->finished();
+        delete op;
+    });
+    return op;
+}
+
+Future<qint64> *Storage::markFeedRead(Feed *feed, const QDateTime &upTo)
+{
+    return markLoadedRead(this, feed->getArticles(true), upTo);
+}
+
+Future<qint64> *Storage::markAllRead(const QDateTime &upTo)
+{
+    return markLoadedRead(this, getUnread(), upTo);
+}
+
+Future<qint64> *Storage::runMaintenance(qint64 /*defaultExpireAge*/)
+{
+    return Future<qint64>::yield(this, [](auto *op) {
+        op->setResult(qint64(0));
+    });
+}
+
+void Storage::flush()
+{
+}
@@ -5,7 +5,9 @@
 
 #ifndef FEEDCORE_STORAGE_H
 #define FEEDCORE_STORAGE_H
+#include "articlerows.h"
 #include "future.h"
+#include <QDateTime>
 #include <QObject>
 #include <Syndication/Feed>
 #include <Syndication/Item>
@@ -23,6 +25,72 @@ public:
     virtual Future<ArticleRef> *getAll() = 0;
     virtual Future<ArticleRef> *getUnread() = 0;
     virtual Future<ArticleRef> *getStarred() = 0;
+
+    /**
+     * Return one page of a date-ordered article list.
+     *
+     * The page holds at most /limit/ articles that sort after /after/, newest first.  Pass
+     * a null ArticleRef to request the first page.  The default implementations return the
+     * complete list as the first page, and nothing after it.
+     */
+    virtual Future<ArticleRef> *getAllPage(const ArticleRef &after, int limit);
+    virtual Future<ArticleRef> *getUnreadPage(const ArticleRef &after, int limit);
+    virtual Future<ArticleRef> *getStarredPage(const ArticleRef &after, int limit);
+
+    /**
+     * Search the stored articles.
+     *
+     * Returns one page of the articles that match /query/, best match first, in the same way
+     * as the paged lists.  The default implementation finds nothing.
+     *
+     * Each page starts after the relevance of /after/ as it is when the page is read.  Relevance
+     * can depend on every stored article, so if articles are stored or expired between pages, a
+     * later page may repeat or skip a few matches.
+     */
+    virtual Future<ArticleRef> *search(const QString &query, const ArticleRef &after, int limit);
+
+    /**
+     * Row variants of the paged lists and search, which do not create the articles.
+     *
+     * /after/ is the last row of the previous page, or an empty row for the first page.  The
+     * default implementations describe the first page of the article lists above, and return
+     * nothing after it.
+     */
+    virtual Future<ArticleRows> *getAllRows(const ArticleRows::Row &after, int limit);
+    virtual Future<ArticleRows> *getUnreadRows(const ArticleRows::Row &after, int limit);
+    virtual Future<ArticleRows> *getStarredRows(const ArticleRows::Row &after, int limit);
+    virtual Future<ArticleRows> *searchRows(const QString &query, const ArticleRows::Row &after, int limit);
+
+    /**
+     * Bulk flag updates.
+     *
+     * Each operation changes every matching article in storage at once, updates the articles
+     * that are currently loaded, and adjusts each feed's unread count once.  The future's
+     * result is the number of articles that changed.  An invalid /upTo/ matches articles of
+     * any date.
+     *
+     * The default implementations load the articles and change them one at a time.
+     */
+    virtual Future<qint64> *markRead(const QVector<ArticleRef> &articles, bool isRead);
+    virtual Future<qint64> *markStarred(const QVector<ArticleRef> &articles, bool isStarred);
+    virtual Future<qint64> *markFeedRead(Feed *feed, const QDateTime &upTo);
+    virtual Future<qint64> *markAllRead(const QDateTime &upTo);
+
+    /**
+     * Periodic housekeeping, run while the application is idle.
+     *
+     * Deletes the articles that are older than their feed's expiry age, where feeds that
+     * inherit the age use /defaultExpireAge/, and compacts the storage.  The future's result
+     * is the number of articles deleted.  The default implementation does nothing.
+     */
+    virtual Future<qint64> *runMaintenance(qint64 defaultExpireAge);
+
+    /**
+     * Write any changes that are being held back, and wait until they are saved.
+     *
+     * The default implementation does nothing.
+     */
+    virtual void flush();
     virtual Future<Feed *> *getFeeds() = 0;
     virtual Future<Feed *> *storeFeed(Feed *feed) = 0;
 };
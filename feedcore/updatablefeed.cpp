@@ -4,27 +4,46 @@
  */
 
 #include "updatablefeed.h"
+#include "feedparser.h"
 #include "networkaccessmanager.h"
 #include <QDebug>
 #include <QNetworkReply>
+#include <QPointer>
+#include <QRegularExpression>
 #include <Syndication/DataRetriever>
-#include <Syndication/Image>
-#include <Syndication/Loader>
+#include <functional>
 using namespace FeedCore;
 
 namespace
 {
+// a server can ask for a long max-age, but the feed should not go quiet for longer than this
+static constexpr qint64 maxCacheLifetime{24 * 60 * 60};
+
+/**
+ * Makes the request conditional on the feed's stored validators, and reads the caching
+ * headers of the response.
+ */
 class DataRetriever : public Syndication::DataRetriever
 {
 public:
+    /**
+     * Called with the caching headers of a successful response, and whether the server
+     * answered 304, before the retriever reports its data.
+     */
+    using ResponseHandler = std::function<void(const Feed::HttpCache &cache, bool notModified)>;
+
+    DataRetriever(Feed *feed, const ResponseHandler &onResponse);
     void retrieveData(const QUrl &url) final;
     int errorCode() const final;
     void abort() final;
 
 private:
+    QPointer<Feed> m_feed;
+    ResponseHandler m_onResponse;
     QNetworkReply *m_reply{nullptr};
     void onRedirect(const QUrl &url);
     void onFinished();
+    Feed::HttpCache responseCache() const;
 };
 }
 
@@ -36,10 +55,15 @@ public:
     void abort() final;
 
 private:
-    Syndication::Loader *m_loader{nullptr};
+    DataRetriever *m_retriever{nullptr};
     UpdatableFeed *m_updatableFeed{nullptr};
     bool m_sourceIsFeedDiscoveryResult{false};
-    void loadingComplete(Syndication::Loader *loader, const Syndication::FeedPtr &content, Syndication::ErrorCode status);
+    bool m_notModified{false};
+    HttpCache m_httpCache; /** < the caching headers of the current response, stored once the update succeeds */
+    quint64 m_run{0}; /** < incremented by each run and abort, so that stale results are dropped */
+    void onDataRetrieved(const QByteArray &data, bool success);
+    void onParsed(const ParsedFeed &parsed);
+    void onStored(const QVector<StoredArticles> &stored);
 };
 
 Feed::Updater *UpdatableFeed::updater()
@@ -47,33 +71,65 @@ Feed::Updater *UpdatableFeed::updater()
     return m_updater;
 }
 
+qint64 UpdatableFeed::lastParseTime() const
+{
+    return m_lastParseTime;
+}
+
+QDateTime UpdatableFeed::cacheExpiry(const QByteArray &cacheControl, const QDateTime &now)
+{
+    static const QRegularExpression noCache{"(^|[,\\s])(no-cache|no-store)($|[,\\s=])"};
+    static const QRegularExpression maxAge{"(^|[,\\s])max-age\\s*=\\s*\"?(\\d+)"};
+    const QString &directives{QString::fromLatin1(cacheControl).toLower()};
+    if (directives.contains(noCache)) {
+        return {};
+    }
+    const auto &match = maxAge.match(directives);
+    if (!match.hasMatch()) {
+        return {};
+    }
+    const qint64 age{std::min(match.captured(2).toLongLong(), maxCacheLifetime)};
+    return age > 0 ? now.addSecs(age) : QDateTime();
+}
+
 FeedCore::UpdatableFeed::UpdatableFeed(QObject *parent)
     : Feed(parent)
     , m_updater{new UpdaterImpl(this, this)}
 {
 }
 
-void UpdatableFeed::updateFromSource(const Syndication::FeedPtr &feed)
+Future<StoredArticles> *UpdatableFeed::updateFromSource(const ParsedFeed &feed)
 {
     if (name().isEmpty()) {
-        setName(feed->title());
+        setName(feed.title);
     }
-    setLink(feed->link());
-    setIcon(feed->icon()->url());
-    const auto &items = feed->items();
+    setLink(feed.link);
+    setIcon(feed.icon);
+    const auto &items = feed.items;
     time_t expireTime = 0;
     if ((expireAge() > 0) && (expireMode() != DisableUpdateMode)) {
         expireTime = updater()->updateStartTime().toTime_t() - expireAge();
     }
+    QVector<ParsedItem> currentItems;
+    currentItems.reserve(items.size());
     for (const auto &item : items) {
-        const auto &dateUpdated = item->dateUpdated();
-        if (dateUpdated == 0 || dateUpdated >= expireTime) {
-            updateSourceArticle(item);
+        if (item.date == 0 || item.date >= expireTime) {
+            currentItems.append(item);
         }
     }
-    if (expireTime > 0) {
-        expire(QDateTime::fromTime_t(expireTime));
-    }
+    // stored articles are expired by the storage maintenance job
+    auto *stored = updateSourceArticles(currentItems);
+    QObject::connect(stored, &BaseFuture::finished, this, [this, stored] {
+        for (const auto &result : stored->result()) {
+            for (const auto &item : result.added) {
+                if (!item->isRead()) {
+                    incrementUnreadCount();
+                }
+                emit articleAdded(item);
+            }
+        }
+    });
+    return stored;
 }
 
 UpdatableFeed::UpdaterImpl::UpdaterImpl(UpdatableFeed *feed, QObject *parent)
@@ -88,70 +144,126 @@ void UpdatableFeed::UpdaterImpl::run()
         setError(tr("Invalid URL", "error message"));
         return;
     }
-    m_loader = Syndication::Loader::create();
-    QObject::connect(m_loader, &Syndication::Loader::loadingComplete, this, &UpdaterImpl::loadingComplete);
-    m_loader->loadFrom(feed()->url(), new DataRetriever);
+    const auto &expires = feed()->httpCache().expires;
+    if (expires.isValid() && expires > updateStartTime()) {
+        // the server said that the last response is still current
+        finish();
+        return;
+    }
+    ++m_run;
+    m_notModified = false;
+    m_retriever = new DataRetriever(feed(), [this](const HttpCache &cache, bool notModified) {
+        m_httpCache = cache;
+        m_notModified = notModified;
+    });
+    QObject::connect(m_retriever, &Syndication::DataRetriever::dataRetrieved, this, &UpdaterImpl::onDataRetrieved);
+    m_retriever->retrieveData(feed()->url());
 }
 
 void UpdatableFeed::UpdaterImpl::abort()
 {
-    if (m_loader != nullptr) {
-        m_loader->abort();
+    if (m_retriever != nullptr) {
+        m_retriever->disconnect(this);
+        m_retriever->abort();
+        m_retriever->deleteLater();
+        m_retriever = nullptr;
+        aborted();
+    } else if (feed()->status() == LoadStatus::Updating) {
+        // the document is being parsed; its result will be dropped
+        ++m_run;
+        aborted();
     }
 }
 
-void UpdatableFeed::UpdaterImpl::loadingComplete(Syndication::Loader *loader, const Syndication::FeedPtr &content, Syndication::ErrorCode status)
+void UpdatableFeed::UpdaterImpl::onDataRetrieved(const QByteArray &data, bool success)
 {
-    m_loader = nullptr;
-    QString errorMessage;
-    switch (status) {
-    case Syndication::Success:
-        m_updatableFeed->updateFromSource(content);
+    m_retriever->deleteLater();
+    m_retriever = nullptr;
+    if (m_notModified) {
+        // nothing to parse or store
+        m_notModified = false;
+        feed()->setHttpCache(m_httpCache);
         finish();
         return;
-    case Syndication::Aborted:
-        aborted();
+    }
+    if (!success) {
+        const QString &errorMessage{tr("Retriever Error", "error message")};
+        qDebug() << "Error:" << errorMessage;
+        setError(errorMessage);
+        return;
+    }
+    // parsing a large document takes long enough to stall the UI, so it happens on a worker thread
+    const quint64 run{m_run};
+    auto *parsed = parseFeed(data, feed()->url());
+    QObject::connect(parsed, &BaseFuture::finished, this, [this, parsed, run] {
+        if (run == m_run) {
+            onParsed(parsed->result().first());
+        }
+    });
+}
+
+void UpdatableFeed::UpdaterImpl::onParsed(const ParsedFeed &parsed)
+{
+    m_updatableFeed->m_lastParseTime = parsed.parseTime;
+    if (parsed.isFeed) {
+        const quint64 run{m_run};
+        auto *stored = m_updatableFeed->updateFromSource(parsed);
+        QObject::connect(stored, &BaseFuture::finished, this, [this, stored, run] {
+            if (run == m_run) {
+                onStored(stored->result());
+            }
+        });
         return;
-    case Syndication::Timeout:
-        errorMessage = tr("Timeout", "error message");
-        break;
-    case Syndication::UnknownHost:
-        errorMessage = tr("Unknown Host", "error message");
-        break;
-    case Syndication::FileNotFound:
-        errorMessage = tr("File Not Found", "error message");
-        break;
-    case Syndication::OtherRetrieverError:
-        errorMessage = tr("Retriever Error", "error message");
-        break;
-    case Syndication::InvalidXml:
-        errorMessage = tr("Invalid XML", "error message");
-        break;
-    case Syndication::XmlNotAccepted:
-        errorMessage = tr("XML Not Accepted", "error message");
-        break;
-    case Syndication::InvalidFormat:
-        errorMessage = tr("Invalid Format", "error message");
-        break;
-    default:
-        errorMessage = tr("Unknown Error", "error message");
     }
 
     // try the discovered url
-    if ((!m_sourceIsFeedDiscoveryResult) && loader->discoveredFeedURL().isValid()) {
-        qDebug() << "Discovered alternate source:" << loader->discoveredFeedURL();
+    if ((!m_sourceIsFeedDiscoveryResult) && parsed.discoveredUrl.isValid()) {
+        qDebug() << "Discovered alternate source:" << parsed.discoveredUrl;
         m_sourceIsFeedDiscoveryResult = true;
-        m_updatableFeed->setUrl(loader->discoveredFeedURL());
+        m_updatableFeed->setUrl(parsed.discoveredUrl);
         run();
     } else {
+        const QString &errorMessage{tr("Invalid Format", "error message")};
         qDebug() << "Error:" << errorMessage;
         setError(errorMessage);
     }
 }
 
+void UpdatableFeed::UpdaterImpl::onStored(const QVector<StoredArticles> &stored)
+{
+    if (stored.isEmpty() || !stored.first().ok) {
+        const QString &errorMessage{tr("Storage Error", "error message")};
+        qDebug() << "Error:" << errorMessage;
+        setError(errorMessage);
+        return;
+    }
+    // the validators describe the content, so they are only kept once the content is
+    feed()->setHttpCache(m_httpCache);
+    finish();
+}
+
+DataRetriever::DataRetriever(Feed *feed, const ResponseHandler &onResponse)
+    : m_feed{feed}
+    , m_onResponse{onResponse}
+{
+}
+
 void DataRetriever::retrieveData(const QUrl &url)
 {
     QNetworkRequest request(url);
+    if (!m_feed.isNull()) {
+        const auto &cache = m_feed->httpCache();
+        if (!cache.etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", cache.etag.toLatin1());
+        }
+        if (!cache.lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", cache.lastModified.toLatin1());
+        }
+        if (!cache.etag.isEmpty() || !cache.lastModified.isEmpty()) {
+            // let the 304 through, rather than have the disk cache answer it
+            request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        }
+    }
     m_reply = NetworkAccessManager::instance()->get(request);
     QObject::connect(m_reply, &QNetworkReply::finished, this, &DataRetriever::onFinished);
 }
@@ -171,7 +283,11 @@ void DataRetriever::abort()
 void DataRetriever::onFinished()
 {
     m_reply->deleteLater();
-    if (m_reply->error() == QNetworkReply::NoError) {
+    if (m_reply->error() == QNetworkReply::NoError && m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        m_onResponse(responseCache(), true);
+        emit dataRetrieved({}, false);
+    } else if (m_reply->error() == QNetworkReply::NoError) {
+        m_onResponse(responseCache(), false);
         const auto &data = m_reply->readAll();
         emit dataRetrieved(data, true);
     } else if (m_reply->error() == QNetworkReply::InsecureRedirectError) {
@@ -183,3 +299,20 @@ void DataRetriever::onFinished()
         emit dataRetrieved({}, false);
     }
 }
+
+Feed::HttpCache DataRetriever::responseCache() const
+{
+    Feed::HttpCache cache;
+    if (!m_feed.isNull()) {
+        cache = m_feed->httpCache();
+    }
+    // a 304 may leave out validators that have not changed
+    if (m_reply->hasRawHeader("ETag")) {
+        cache.etag = QString::fromLatin1(m_reply->rawHeader("ETag"));
+    }
+    if (m_reply->hasRawHeader("Last-Modified")) {
+        cache.lastModified = QString::fromLatin1(m_reply->rawHeader("Last-Modified"));
+    }
+    cache.expires = UpdatableFeed::cacheExpiry(m_reply->rawHeader("Cache-Control"), QDateTime::currentDateTime());
+    return cache;
+}
@@ -6,18 +6,40 @@
 #ifndef UPDATABLEFEED_H
 #define UPDATABLEFEED_H
 #include "feed.h"
-#include <Syndication/Feed>
-#include <Syndication/Item>
+#include "feedparser.h"
+#include "future.h"
 namespace FeedCore
 {
 /**
- * Base class for feed implementations that are updated locally using the Syndication library
+ * The result of storing the articles from one update
+ */
+struct StoredArticles {
+    bool ok{false}; /** < false if the articles could not be written */
+    QVector<ArticleRef> added; /** < the articles that were not stored before */
+    int updated{0}; /** < stored articles that were written again */
+    int skipped{0}; /** < stored articles that had not changed, and were not written */
+};
+
+/**
+ * Base class for feed implementations that are updated locally by downloading and parsing their source
  */
 class UpdatableFeed : public Feed
 {
 public:
     virtual Updater *updater() final;
 
+    /**
+     * The time it took to parse the last download, in msecs.  Parsing happens on a worker
+     * thread, so this is not time that the UI was blocked.
+     */
+    qint64 lastParseTime() const;
+
+    /**
+     * When a response with the given Cache-Control header, received at /now/, goes stale.
+     * Returns an invalid QDateTime if the response should not be cached.
+     */
+    static QDateTime cacheExpiry(const QByteArray &cacheControl, const QDateTime &now);
+
 protected:
     explicit UpdatableFeed(QObject *parent);
 
@@ -26,31 +48,29 @@ private:
      * Process an update from the remote source.
      *
      * This is called whenever an update has been sucessfully downloaded and processed
-     * by the Syndication library.  The base implementation updates the properties of the
-     * feed using the retrieved data, then calls updateSourceArticle for each article.
-     */
-    virtual void updateFromSource(const Syndication::FeedPtr &feed);
-
-    /**
-     * Process an article from the remote source.
+     * by parseFeed.  The base implementation updates the properties of the
+     * feed using the retrieved data, then calls updateSourceArticles once with every
+     * article that has not expired, and emits Feed::articleAdded for each new article
+     * once they have been stored.
      *
-     * This is called by the base implmentation of updateFromSource.  Derived classes
-     * should implement this to create insances of their corresponding article implementation.
-     * The implementation is responsible for identifying duplicates, and should emit the
-     * Feed::articleAdded signal when a new article is found.
+     * The update is not finished until the returned future is.
      */
-    virtual void updateSourceArticle(const Syndication::ItemPtr &article) = 0;
+    virtual Future<StoredArticles> *updateFromSource(const ParsedFeed &feed);
 
     /**
-     * Delete old articles
+     * Process the articles from the remote source.
      *
-     * This is called by the base implementation of updateFromSource.  Derivce classes
-     * should override this and remove old articles from storage.
+     * This is called by the base implmentation of updateFromSource with all of the articles
+     * from a single update, so that implementations can store them in one batch.  Derived classes
+     * should implement this to create insances of their corresponding article implementation.
+     * The implementation is responsible for identifying duplicates, and should return only the
+     * new articles in StoredArticles::added.
      */
-    virtual void expire(const QDateTime &olderThan) = 0;
+    virtual Future<StoredArticles> *updateSourceArticles(const QVector<ParsedItem> &articles) = 0;
 
     class UpdaterImpl;
     UpdaterImpl *m_updater;
+    qint64 m_lastParseTime{0};
 };
 
 }
@@ -0,0 +1,222 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "updatequeue.h"
+#include "feed.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <algorithm>
+
+namespace FeedCore
+{
+// Qt opens up to six connections per host, so this leaves room for the rest of the application
+static constexpr int defaultMaxActive{8};
+static constexpr int defaultMaxActivePerHost{2};
+
+namespace
+{
+struct Entry {
+    QPointer<Feed> feed;
+    QDateTime timestamp;
+    QDateTime due;
+    UpdateQueue::Priority priority;
+    qint64 queuedAt; /** < msecs on the queue's clock */
+};
+}
+
+struct UpdateQueue::PrivData {
+    QList<Entry> queue; /** < in the order the updates should start */
+    QHash<Feed *, QString> active; /** < the host of each active feed */
+    QHash<QString, int> activePerHost;
+    int maxActive{defaultMaxActive};
+    int maxActivePerHost{defaultMaxActivePerHost};
+    bool startPending{false};
+    bool starting{false};
+    QElapsedTimer clock;
+    quint64 started{0};
+    qint64 totalWait{0};
+};
+
+UpdateQueue::UpdateQueue(QObject *parent)
+    : QObject(parent)
+    , d{std::make_unique<PrivData>()}
+{
+    d->clock.start();
+}
+
+UpdateQueue::~UpdateQueue() = default;
+
+static bool startsBefore(const Entry &l, const Entry &r)
+{
+    if (l.priority != r.priority) {
+        return l.priority > r.priority;
+    }
+    return l.due < r.due;
+}
+
+static QString host(Feed *feed)
+{
+    return feed->url().host().toLower();
+}
+
+void UpdateQueue::enqueue(Feed *feed, const QDateTime &timestamp, Priority priority, const QDateTime &due)
+{
+    if (feed == nullptr || d->active.contains(feed) || feed->status() == Feed::Updating) {
+        return;
+    }
+    Entry entry{feed, timestamp, due.isValid() ? due : timestamp, priority, d->clock.elapsed()};
+    auto &queue = d->queue;
+    const auto &existing = std::find_if(queue.begin(), queue.end(), [feed](const Entry &queued) {
+        return queued.feed == feed;
+    });
+    if (existing != queue.end()) {
+        entry.priority = std::max(entry.priority, existing->priority);
+        entry.due = std::min(entry.due, existing->due);
+        entry.queuedAt = existing->queuedAt;
+        queue.erase(existing);
+    }
+    queue.insert(std::upper_bound(queue.begin(), queue.end(), entry, startsBefore), entry);
+    startWaiting();
+}
+
+void UpdateQueue::remove(Feed *feed)
+{
+    auto &queue = d->queue;
+    queue.erase(std::remove_if(queue.begin(),
+                               queue.end(),
+                               [feed](const Entry &queued) {
+                                   return queued.feed == feed;
+                               }),
+                queue.end());
+}
+
+void UpdateQueue::clear()
+{
+    d->queue.clear();
+}
+
+int UpdateQueue::maxActive() const
+{
+    return d->maxActive;
+}
+
+void UpdateQueue::setMaxActive(int maxActive)
+{
+    d->maxActive = std::max(maxActive, 1);
+    scheduleStartWaiting();
+}
+
+int UpdateQueue::maxActivePerHost() const
+{
+    return d->maxActivePerHost;
+}
+
+void UpdateQueue::setMaxActivePerHost(int maxActivePerHost)
+{
+    d->maxActivePerHost = std::max(maxActivePerHost, 1);
+    scheduleStartWaiting();
+}
+
+UpdateQueueStats UpdateQueue::stats() const
+{
+    UpdateQueueStats stats;
+    stats.queued = d->queue.size();
+    stats.active = d->active.size();
+    stats.started = d->started;
+    stats.averageWait = d->started > 0 ? d->totalWait / qint64(d->started) : 0;
+    const qint64 now{d->clock.elapsed()};
+    for (const auto &entry : qAsConst(d->queue)) {
+        stats.longestWait = std::max(stats.longestWait, now - entry.queuedAt);
+    }
+    return stats;
+}
+
+int UpdateQueue::nextStartable()
+{
+    auto &queue = d->queue;
+    for (int i = 0; i < queue.size();) {
+        Feed *feed{queue[i].feed};
+        if (feed == nullptr || feed->status() == Feed::Updating) {
+            // destroyed, or started by someone else while it waited
+            queue.removeAt(i);
+            continue;
+        }
+        // feeds without a host, such as local files, are only subject to the global limit
+        const QString &feedHost{host(feed)};
+        if (feedHost.isEmpty() || d->activePerHost.value(feedHost) < d->maxActivePerHost) {
+            return i;
+        }
+        ++i;
+    }
+    return -1;
+}
+
+void UpdateQueue::startWaiting()
+{
+    // starting an update can lead back here, through signals from the feed
+    if (d->starting) {
+        scheduleStartWaiting();
+        return;
+    }
+    d->starting = true;
+    while (d->active.size() < d->maxActive) {
+        const int index{nextStartable()};
+        if (index < 0) {
+            break;
+        }
+        const Entry entry{d->queue.takeAt(index)};
+        Feed *feed{entry.feed};
+        const QString &feedHost{host(feed)};
+        ++d->started;
+        d->totalWait += d->clock.elapsed() - entry.queuedAt;
+        d->active.insert(feed, feedHost);
+        ++d->activePerHost[feedHost];
+        QObject::connect(feed, &Feed::statusChanged, this, [this, feed] {
+            onFeedStatusChanged(feed);
+        });
+        QObject::connect(feed, &QObject::destroyed, this, [this, feed] {
+            release(feed);
+        });
+        feed->updater()->start(entry.timestamp);
+    }
+    d->starting = false;
+}
+
+void UpdateQueue::scheduleStartWaiting()
+{
+    if (d->startPending) {
+        return;
+    }
+    d->startPending = true;
+    QTimer::singleShot(0, this, [this] {
+        d->startPending = false;
+        startWaiting();
+    });
+}
+
+void UpdateQueue::onFeedStatusChanged(Feed *feed)
+{
+    if (feed->status() != Feed::Updating) {
+        release(feed);
+    }
+}
+
+void UpdateQueue::release(Feed *feed)
+{
+    const auto &active = d->active.constFind(feed);
+    if (active == d->active.constEnd()) {
+        return;
+    }
+    const QString feedHost{*active};
+    d->active.erase(active);
+    if (--d->activePerHost[feedHost] <= 0) {
+        d->activePerHost.remove(feedHost);
+    }
+    QObject::disconnect(feed, nullptr, this, nullptr);
+    scheduleStartWaiting();
+}
+}
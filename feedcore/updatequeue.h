@@ -0,0 +1,84 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef FEEDCORE_UPDATEQUEUE_H
+#define FEEDCORE_UPDATEQUEUE_H
+#include <QDateTime>
+#include <QObject>
+#include <memory>
+
+namespace FeedCore
+{
+class Feed;
+
+/**
+ * Counters describing an update queue, for tuning its limits.
+ */
+struct UpdateQueueStats {
+    int queued{0}; /** < feeds waiting to start */
+    int active{0}; /** < feeds that are updating */
+    quint64 started{0}; /** < feeds started since the queue was created */
+    qint64 averageWait{0}; /** < mean msecs between a feed being queued and started */
+    qint64 longestWait{0}; /** < msecs that the longest-waiting queued feed has waited */
+};
+
+/**
+ * Starts feed updates a few at a time.
+ *
+ * At most maxActive feeds update at once, and at most maxActivePerHost of those share a host,
+ * so that a large update neither floods the network nor trips a server's rate limits.  Feeds
+ * that were requested by the user start first, followed by the rest in the order they were due.
+ *
+ * A feed is counted as active from when it is started until its status leaves Feed::Updating.
+ */
+class UpdateQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Scheduled, /** < an automatic update */
+        Requested, /** < an update the user asked for */
+    };
+
+    explicit UpdateQueue(QObject *parent = nullptr);
+    ~UpdateQueue();
+
+    /**
+     * Queue an update for /feed/.
+     *
+     * /due/ orders scheduled updates; the feed's updater is started with /timestamp/.  Queuing a
+     * feed that is already queued keeps the earlier due time and the higher priority; feeds that
+     * are already updating are ignored.  The update starts immediately if there is room.
+     */
+    void enqueue(Feed *feed, const QDateTime &timestamp, Priority priority = Scheduled, const QDateTime &due = {});
+
+    /**
+     * Drop the queued update for /feed/, if there is one.
+     */
+    void remove(Feed *feed);
+
+    /**
+     * Drop every queued update.  Updates that have started are left alone.
+     */
+    void clear();
+
+    int maxActive() const;
+    void setMaxActive(int maxActive);
+    int maxActivePerHost() const;
+    void setMaxActivePerHost(int maxActivePerHost);
+
+    UpdateQueueStats stats() const;
+
+private:
+    struct PrivData;
+    std::unique_ptr<PrivData> d;
+    int nextStartable();
+    void startWaiting();
+    void scheduleStartWaiting();
+    void onFeedStatusChanged(Feed *feed);
+    void release(Feed *feed);
+};
+}
+#endif // FEEDCORE_UPDATEQUEUE_H
@@ -0,0 +1,370 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "xmlfeedparser.h"
+#include <QXmlStreamWriter>
+#include <Syndication/Person>
+#include <Syndication/Tools>
+
+namespace FeedCore
+{
+static const QString atomNamespace{QStringLiteral("http://www.w3.org/2005/Atom")};
+static const QString rdfNamespace{QStringLiteral("http://www.w3.org/1999/02/22-rdf-syntax-ns#")};
+static const QString rss1Namespace{QStringLiteral("http://purl.org/rss/1.0/")};
+static const QString dublinCoreNamespace{QStringLiteral("http://purl.org/dc/elements/1.1/")};
+static const QString contentNamespace{QStringLiteral("http://purl.org/rss/1.0/modules/content/")};
+
+static QString personName(const QString &text)
+{
+    if (text.isEmpty()) {
+        return {};
+    }
+    const auto &person = Syndication::personFromString(text);
+    return person->isNull() ? QString() : person->name();
+}
+
+XmlFeedParser::XmlFeedParser(const QByteArray &data)
+    : m_reader(data)
+{
+}
+
+bool XmlFeedParser::parse(const ItemHandler &onItem)
+{
+    if (!m_reader.readNextStartElement()) {
+        return fail(QStringLiteral("not an XML document"));
+    }
+    const auto &name = m_reader.name();
+    const auto &ns = m_reader.namespaceUri();
+    if (name == QLatin1String("rss") && ns.isEmpty()) {
+        return parseRss(onItem);
+    }
+    if (name == QLatin1String("RDF") && ns == rdfNamespace) {
+        return parseRdf(onItem);
+    }
+    if (name == QLatin1String("feed") && ns == atomNamespace) {
+        return parseAtom(onItem);
+    }
+    return fail(QStringLiteral("unknown document type"));
+}
+
+const QString &XmlFeedParser::title() const
+{
+    return m_title;
+}
+
+const QUrl &XmlFeedParser::link() const
+{
+    return m_link;
+}
+
+const QUrl &XmlFeedParser::icon() const
+{
+    return m_icon;
+}
+
+const QString &XmlFeedParser::errorString() const
+{
+    return m_error;
+}
+
+bool XmlFeedParser::parseRss(const ItemHandler &onItem)
+{
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.name() != QLatin1String("channel") || !m_reader.namespaceUri().isEmpty()) {
+            m_reader.skipCurrentElement();
+            continue;
+        }
+        while (m_reader.readNextStartElement()) {
+            const auto &name = m_reader.name();
+            if (!m_reader.namespaceUri().isEmpty()) {
+                m_reader.skipCurrentElement();
+            } else if (name == QLatin1String("item")) {
+                if (!parseRssItem(onItem, false)) {
+                    return false;
+                }
+            } else if (name == QLatin1String("title")) {
+                m_title = readNormalized();
+            } else if (name == QLatin1String("link")) {
+                m_link = QUrl(readText().text.trimmed());
+            } else if (name == QLatin1String("image")) {
+                m_icon = readImageUrl();
+            } else {
+                m_reader.skipCurrentElement();
+            }
+        }
+    }
+    return !m_reader.hasError() || fail(m_reader.errorString());
+}
+
+bool XmlFeedParser::parseRdf(const ItemHandler &onItem)
+{
+    // in RSS 1.0 the items and image are siblings of the channel, not children
+    while (m_reader.readNextStartElement()) {
+        const auto &name = m_reader.name();
+        if (m_reader.namespaceUri() != rss1Namespace) {
+            m_reader.skipCurrentElement();
+        } else if (name == QLatin1String("item")) {
+            if (!parseRssItem(onItem, true)) {
+                return false;
+            }
+        } else if (name == QLatin1String("image")) {
+            m_icon = readImageUrl();
+        } else if (name == QLatin1String("channel")) {
+            while (m_reader.readNextStartElement()) {
+                if (m_reader.namespaceUri() != rss1Namespace) {
+                    m_reader.skipCurrentElement();
+                } else if (m_reader.name() == QLatin1String("title")) {
+                    m_title = readNormalized();
+                } else if (m_reader.name() == QLatin1String("link")) {
+                    m_link = QUrl(readText().text.trimmed());
+                } else {
+                    m_reader.skipCurrentElement();
+                }
+            }
+        } else {
+            m_reader.skipCurrentElement();
+        }
+    }
+    return !m_reader.hasError() || fail(m_reader.errorString());
+}
+
+bool XmlFeedParser::parseRssItem(const ItemHandler &onItem, bool isRdf)
+{
+    const QString &itemNamespace = isRdf ? rss1Namespace : QString();
+    ParsedItem item;
+    if (isRdf) {
+        item.id = m_reader.attributes().value(rdfNamespace, QStringLiteral("about")).toString().trimmed();
+    }
+    QString description;
+    QString author;
+    QString creator;
+    QString pubDate;
+    QString dcDate;
+    while (m_reader.readNextStartElement()) {
+        const auto &name = m_reader.name();
+        const auto &ns = m_reader.namespaceUri();
+        if (ns == itemNamespace) {
+            if (name == QLatin1String("title")) {
+                item.title = readNormalized();
+            } else if (name == QLatin1String("link")) {
+                item.url = QUrl(readText().text.trimmed());
+            } else if (name == QLatin1String("description")) {
+                description = readNormalized();
+            } else if (!isRdf && name == QLatin1String("guid")) {
+                item.id = readText().text.trimmed();
+            } else if (!isRdf && name == QLatin1String("pubDate")) {
+                pubDate = readText().text.trimmed();
+            } else if (!isRdf && name == QLatin1String("author")) {
+                author = readText().text.trimmed();
+            } else {
+                m_reader.skipCurrentElement();
+            }
+        } else if (ns == dublinCoreNamespace && name == QLatin1String("creator")) {
+            if (creator.isEmpty()) {
+                creator = readText().text.trimmed();
+            } else {
+                m_reader.skipCurrentElement();
+            }
+        } else if (ns == dublinCoreNamespace && name == QLatin1String("date")) {
+            dcDate = readText().text.trimmed();
+        } else if (ns == contentNamespace && name == QLatin1String("encoded")) {
+            item.content = readText().text;
+        } else {
+            m_reader.skipCurrentElement();
+        }
+    }
+    if (m_reader.hasError()) {
+        return fail(m_reader.errorString());
+    }
+    if (item.id.isEmpty()) {
+        return fail(QStringLiteral("item without an id"));
+    }
+
+    item.author = personName(author);
+    if (item.author.isEmpty()) {
+        item.author = personName(creator);
+    }
+    if (!pubDate.isEmpty()) {
+        item.date = Syndication::parseDate(pubDate, Syndication::RFCDate);
+    } else if (!dcDate.isEmpty()) {
+        item.date = Syndication::parseDate(dcDate, Syndication::ISODate);
+    }
+    if (item.content.isEmpty()) {
+        item.content = description;
+    }
+    onItem(std::move(item));
+    return true;
+}
+
+bool XmlFeedParser::parseAtom(const ItemHandler &onItem)
+{
+    QUrl logo;
+    while (m_reader.readNextStartElement()) {
+        const auto &name = m_reader.name();
+        if (m_reader.namespaceUri() != atomNamespace) {
+            m_reader.skipCurrentElement();
+        } else if (name == QLatin1String("entry")) {
+            if (!parseAtomEntry(onItem)) {
+                return false;
+            }
+        } else if (name == QLatin1String("title")) {
+            m_title = readAtomText();
+        } else if (name == QLatin1String("link")) {
+            const auto &attributes = m_reader.attributes();
+            const auto &rel = attributes.value(QStringLiteral("rel"));
+            if (m_link.isEmpty() && (rel.isEmpty() || rel == QLatin1String("alternate"))) {
+                m_link = QUrl(attributes.value(QStringLiteral("href")).toString().trimmed());
+            }
+            m_reader.skipCurrentElement();
+        } else if (name == QLatin1String("icon")) {
+            m_icon = QUrl(readText().text.trimmed());
+        } else if (name == QLatin1String("logo")) {
+            logo = QUrl(readText().text.trimmed());
+        } else {
+            m_reader.skipCurrentElement();
+        }
+    }
+    if (m_icon.isEmpty()) {
+        m_icon = logo;
+    }
+    return !m_reader.hasError() || fail(m_reader.errorString());
+}
+
+bool XmlFeedParser::parseAtomEntry(const ItemHandler &onItem)
+{
+    ParsedItem item;
+    QString summary;
+    QString updated;
+    QString published;
+    while (m_reader.readNextStartElement()) {
+        const auto &name = m_reader.name();
+        if (m_reader.namespaceUri() != atomNamespace) {
+            m_reader.skipCurrentElement();
+        } else if (name == QLatin1String("id")) {
+            item.id = readText().text.trimmed();
+        } else if (name == QLatin1String("title")) {
+            item.title = readAtomText();
+        } else if (name == QLatin1String("link")) {
+            const auto &attributes = m_reader.attributes();
+            const auto &rel = attributes.value(QStringLiteral("rel"));
+            if (item.url.isEmpty() && (rel.isEmpty() || rel == QLatin1String("alternate"))) {
+                item.url = QUrl(attributes.value(QStringLiteral("href")).toString().trimmed());
+            }
+            m_reader.skipCurrentElement();
+        } else if (name == QLatin1String("author")) {
+            while (m_reader.readNextStartElement()) {
+                if (item.author.isEmpty() && m_reader.namespaceUri() == atomNamespace && m_reader.name() == QLatin1String("name")) {
+                    item.author = readText().text.trimmed();
+                } else {
+                    m_reader.skipCurrentElement();
+                }
+            }
+        } else if (name == QLatin1String("updated")) {
+            updated = readText().text.trimmed();
+        } else if (name == QLatin1String("published")) {
+            published = readText().text.trimmed();
+        } else if (name == QLatin1String("content")) {
+            item.content = readAtomText();
+        } else if (name == QLatin1String("summary")) {
+            summary = readAtomText();
+        } else {
+            m_reader.skipCurrentElement();
+        }
+    }
+    if (m_reader.hasError()) {
+        return fail(m_reader.errorString());
+    }
+    if (item.id.isEmpty()) {
+        return fail(QStringLiteral("entry without an id"));
+    }
+
+    const QString &date = updated.isEmpty() ? published : updated;
+    if (!date.isEmpty()) {
+        item.date = Syndication::parseDate(date, Syndication::ISODate);
+    }
+    if (item.content.isEmpty()) {
+        item.content = summary;
+    }
+    onItem(std::move(item));
+    return true;
+}
+
+QUrl XmlFeedParser::readImageUrl()
+{
+    const QString &ns = m_reader.namespaceUri().toString();
+    QUrl url;
+    while (m_reader.readNextStartElement()) {
+        if (m_reader.namespaceUri() == ns && m_reader.name() == QLatin1String("url")) {
+            url = QUrl(readText().text.trimmed());
+        } else {
+            m_reader.skipCurrentElement();
+        }
+    }
+    return url;
+}
+
+QString XmlFeedParser::readAtomText()
+{
+    const auto &type = m_reader.attributes().value(QStringLiteral("type"));
+    if (type == QLatin1String("xhtml")) {
+        // the markup is part of the document; write it back out as it was
+        QString markup;
+        QXmlStreamWriter writer(&markup);
+        int depth = 0;
+        while (!m_reader.atEnd()) {
+            m_reader.readNext();
+            if (m_reader.isEndElement()) {
+                if (depth == 0) {
+                    break;
+                }
+                --depth;
+            } else if (m_reader.isStartElement()) {
+                ++depth;
+            }
+            writer.writeCurrentToken(m_reader);
+        }
+        return markup.trimmed();
+    }
+    const QString &text = readText().text.trimmed();
+    if (type == QLatin1String("html") || type.endsWith(QLatin1String("html"))) {
+        return text;
+    }
+    return Syndication::plainTextToHtml(text);
+}
+
+XmlFeedParser::Text XmlFeedParser::readText()
+{
+    // like QDomElement::text(), this keeps the text of any child elements but not their tags
+    Text result;
+    int depth = 0;
+    while (!m_reader.atEnd()) {
+        m_reader.readNext();
+        if (m_reader.isCharacters()) {
+            result.text += m_reader.text();
+            result.isCDATA = result.isCDATA || m_reader.isCDATA();
+        } else if (m_reader.isStartElement()) {
+            ++depth;
+        } else if (m_reader.isEndElement()) {
+            if (depth == 0) {
+                break;
+            }
+            --depth;
+        }
+    }
+    return result;
+}
+
+QString XmlFeedParser::readNormalized()
+{
+    const auto &text = readText();
+    return Syndication::normalize(text.text, text.isCDATA, Syndication::stringContainsMarkup(text.text));
+}
+
+bool XmlFeedParser::fail(const QString &error)
+{
+    m_error = error;
+    return false;
+}
+}
@@ -0,0 +1,73 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef FEEDCORE_XMLFEEDPARSER_H
+#define FEEDCORE_XMLFEEDPARSER_H
+#include "feedparser.h"
+#include <QXmlStreamReader>
+#include <functional>
+
+namespace FeedCore
+{
+/**
+ * Reads RSS 2.0, RSS 1.0 (RDF) and Atom documents in a single pass, without building a DOM.
+ *
+ * Items are passed on as soon as each one has been read, so the memory that a document needs
+ * beyond its own bytes is about one item.  The fields are formatted as the Syndication library
+ * formats them, so that switching parsers does not change the stored articles.
+ *
+ * Documents that it can't read, and items without an id, are left to the Syndication library:
+ * Syndication derives ids for those items from a hash of their formatted text, which this
+ * parser does not reproduce.
+ */
+class XmlFeedParser
+{
+public:
+    using ItemHandler = std::function<void(ParsedItem &&item)>;
+
+    explicit XmlFeedParser(const QByteArray &data);
+
+    /**
+     * Read the document, calling /onItem/ for each item in document order.
+     *
+     * Returns false if the document is not a feed this parser can read.  Items that were
+     * passed on before the failure should be discarded.
+     */
+    bool parse(const ItemHandler &onItem);
+
+    const QString &title() const;
+    const QUrl &link() const;
+    const QUrl &icon() const;
+
+    /**
+     * Why parse() failed.
+     */
+    const QString &errorString() const;
+
+private:
+    struct Text {
+        QString text;
+        bool isCDATA{false};
+    };
+
+    QXmlStreamReader m_reader;
+    QString m_title;
+    QUrl m_link;
+    QUrl m_icon;
+    QString m_error;
+
+    bool parseRss(const ItemHandler &onItem);
+    bool parseRdf(const ItemHandler &onItem);
+    bool parseAtom(const ItemHandler &onItem);
+    bool parseRssItem(const ItemHandler &onItem, bool isRdf);
+    bool parseAtomEntry(const ItemHandler &onItem);
+    QUrl readImageUrl();
+    QString readAtomText();
+    Text readText();
+    QString readNormalized();
+    bool fail(const QString &error);
+};
+}
+#endif // FEEDCORE_XMLFEEDPARSER_H
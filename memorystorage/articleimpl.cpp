@@ -0,0 +1,80 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "memorystorage/articleimpl.h"
+#include "memorystorage/feedimpl.h"
+#include "memorystorage/storageimpl.h"
+
+using namespace FeedCore;
+using namespace MemoryStorage;
+
+ArticleImpl::ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const StoredItem &item)
+    : Article(feed, nullptr)
+    , m_id{id}
+    , m_storage(storage)
+{
+    updateHeaders(item);
+    Article::setRead(item.isRead);
+    Article::setStarred(item.isStarred);
+}
+
+qint64 ArticleImpl::id() const
+{
+    return m_id;
+}
+
+void ArticleImpl::updateHeaders(const StoredItem &item)
+{
+    Article::setTitle(item.headline);
+    Article::setAuthor(item.author);
+    Article::setDate(QDateTime::fromSecsSinceEpoch(item.date));
+    Article::setUrl(item.url);
+}
+
+void ArticleImpl::updateRead(bool isRead)
+{
+    Article::setRead(isRead);
+}
+
+void ArticleImpl::updateStarred(bool isStarred)
+{
+    Article::setStarred(isStarred);
+}
+
+void ArticleImpl::setRead(bool isRead)
+{
+    if (isRead == this->isRead()) {
+        return;
+    }
+    Article::setRead(isRead);
+    if (!m_storage.isNull()) {
+        m_storage->onArticleReadChanged(this);
+    }
+    if (auto *feedImpl = qobject_cast<FeedImpl *>(feed())) {
+        feedImpl->onArticleReadChanged(this);
+    }
+}
+
+void ArticleImpl::setStarred(bool isStarred)
+{
+    if (isStarred == this->isStarred()) {
+        return;
+    }
+    Article::setStarred(isStarred);
+    if (!m_storage.isNull()) {
+        m_storage->onArticleStarredChanged(this);
+    }
+}
+
+void ArticleImpl::requestContent()
+{
+    if (m_storage.isNull()) {
+        return;
+    }
+    Future<QString> *fut = m_storage->getContent(this);
+    QObject::connect(fut, &BaseFuture::finished, this, [this, fut] {
+        emit gotContent(fut->result().first());
+    });
+}
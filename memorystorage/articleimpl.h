@@ -0,0 +1,45 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MEMORYSTORAGE_ARTICLEIMPL_H
+#define MEMORYSTORAGE_ARTICLEIMPL_H
+#include "article.h"
+#include "factory.h"
+
+namespace MemoryStorage
+{
+class FeedImpl;
+class StorageImpl;
+struct StoredItem;
+
+class ArticleImpl : public FeedCore::Article
+{
+    Q_OBJECT
+public:
+    qint64 id() const;
+
+    /**
+     * Refresh the article's headers from the stored item.
+     */
+    void updateHeaders(const StoredItem &item);
+
+    /**
+     * Apply a flag change that was already made in storage by a bulk update.
+     */
+    void updateRead(bool isRead);
+    void updateStarred(bool isStarred);
+
+    void setRead(bool isRead) final;
+    void setStarred(bool isStarred) final;
+    void requestContent() final;
+
+private:
+    ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const StoredItem &item);
+    qint64 m_id;
+    QPointer<StorageImpl> m_storage;
+    friend FeedCore::SharedFactory<qint64, ArticleImpl>;
+};
+}
+#endif // MEMORYSTORAGE_ARTICLEIMPL_H
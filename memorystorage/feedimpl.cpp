@@ -0,0 +1,67 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "memorystorage/feedimpl.h"
+#include "memorystorage/articleimpl.h"
+#include "memorystorage/storageimpl.h"
+
+using namespace FeedCore;
+using namespace MemoryStorage;
+
+FeedImpl::FeedImpl(qint64 feedId, StorageImpl *storage)
+    : UpdatableFeed(storage)
+    , m_id{feedId}
+    , m_storage{storage}
+{
+    QObject::connect(this, &Feed::deleteRequested, storage, [this, storage] {
+        storage->onFeedRequestDelete(this);
+    });
+}
+
+qint64 FeedImpl::id() const
+{
+    return m_id;
+}
+
+Future<ArticleRef> *FeedImpl::getArticles(bool unreadFilter)
+{
+    return getArticlePage(unreadFilter, {}, -1);
+}
+
+Future<ArticleRef> *FeedImpl::getArticlePage(bool unreadFilter, const ArticleRef &after, int limit)
+{
+    if (unreadFilter) {
+        return m_storage->getUnreadByFeed(this, after, limit);
+    }
+    return m_storage->getByFeed(this, after, limit);
+}
+
+Future<ArticleRows> *FeedImpl::getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit)
+{
+    if (unreadFilter) {
+        return m_storage->getUnreadRowsByFeed(this, after, limit);
+    }
+    return m_storage->getRowsByFeed(this, after, limit);
+}
+
+Future<qint64> *FeedImpl::markAllRead(const QDateTime &upTo)
+{
+    return m_storage->markFeedRead(this, upTo);
+}
+
+Future<StoredArticles> *FeedImpl::updateSourceArticles(const QVector<ParsedItem> &articles)
+{
+    return m_storage->storeArticles(this, articles);
+}
+
+void FeedImpl::onArticleReadChanged(ArticleImpl *article)
+{
+    incrementUnreadCount(article->isRead() ? -1 : 1);
+}
+
+void FeedImpl::onArticlesReadChanged(int delta)
+{
+    incrementUnreadCount(delta);
+}
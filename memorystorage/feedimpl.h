@@ -0,0 +1,50 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MEMORYSTORAGE_FEEDIMPL_H
+#define MEMORYSTORAGE_FEEDIMPL_H
+#include "factory.h"
+#include "updatablefeed.h"
+
+namespace MemoryStorage
+{
+class ArticleImpl;
+class StorageImpl;
+
+/**
+ * A feed held by MemoryStorage::StorageImpl.
+ *
+ * The feed object itself is the only copy of its properties, so there is nothing to
+ * write back when they change.
+ */
+class FeedImpl : public FeedCore::UpdatableFeed
+{
+    Q_OBJECT
+public:
+    qint64 id() const;
+    FeedCore::Future<FeedCore::ArticleRef> *getArticles(bool unreadFilter) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getArticlePage(bool unreadFilter, const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getArticleRows(bool unreadFilter, const FeedCore::ArticleRows::Row &after, int limit) final;
+    bool editable() final
+    {
+        return true;
+    }
+    FeedCore::Future<qint64> *markAllRead(const QDateTime &upTo) final;
+    void onArticleReadChanged(ArticleImpl *article);
+
+    /**
+     * Adjust the unread count after a bulk update changed /delta/ articles at once.
+     */
+    void onArticlesReadChanged(int delta);
+
+private:
+    FeedImpl(qint64 feedId, StorageImpl *storage);
+    qint64 m_id{0};
+    StorageImpl *m_storage{nullptr};
+    FeedCore::Future<FeedCore::StoredArticles> *updateSourceArticles(const QVector<FeedCore::ParsedItem> &articles) final;
+    friend FeedCore::ObjectFactory<qint64, FeedImpl>;
+};
+}
+#endif // MEMORYSTORAGE_FEEDIMPL_H
@@ -0,0 +1,534 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "memorystorage/storageimpl.h"
+#include "articleref.h"
+#include "memorystorage/articleimpl.h"
+#include "memorystorage/feedimpl.h"
+#include <QPointer>
+#include <QSet>
+#include <Syndication/Tools>
+#include <algorithm>
+#include <limits>
+using namespace FeedCore;
+using namespace MemoryStorage;
+
+namespace
+{
+/**
+ * The position of an item in the sorted array.
+ */
+struct ItemKey {
+    qint64 date{std::numeric_limits<qint64>::max()};
+    qint64 id{std::numeric_limits<qint64>::max()};
+};
+
+bool sortsBefore(const StoredItem &item, const ItemKey &key)
+{
+    return item.date < key.date || (item.date == key.date && item.id < key.id);
+}
+
+bool sortsAfter(const ItemKey &key, const StoredItem &item)
+{
+    return key.date < item.date || (key.date == item.date && key.id < item.id);
+}
+}
+
+// the same window as FeedDatabase::postingWindow
+static constexpr qint64 postingWindow{60 * 24 * 60 * 60};
+
+static QString searchText(const StoredItem &item, const QString &content)
+{
+    return item.headline + '\n' + item.author + '\n' + Syndication::htmlToPlainText(content);
+}
+
+class StorageImpl::RowSource : public ArticleRows::Source
+{
+public:
+    explicit RowSource(StorageImpl *storage)
+        : m_storage{storage}
+    {
+    }
+
+    ArticleRef article(const ArticleRows::Row &row) final
+    {
+        const StoredItem *item{m_storage.isNull() ? nullptr : m_storage->findItem(row.id)};
+        return item != nullptr ? m_storage->article(*item) : ArticleRef();
+    }
+
+    ArticleRef find(const ArticleRows::Row &row) final
+    {
+        return m_storage.isNull() ? ArticleRef() : m_storage->m_articleFactory.find(row.id);
+    }
+
+private:
+    QPointer<StorageImpl> m_storage;
+};
+
+StorageImpl::StorageImpl(QObject *parent)
+    : Storage(parent)
+    , m_rowSource{std::make_shared<RowSource>(this)}
+{
+}
+
+StorageImpl::~StorageImpl() = default;
+
+StoredItem *StorageImpl::findItem(qint64 id)
+{
+    const auto &date = m_itemDates.constFind(id);
+    if (date == m_itemDates.constEnd()) {
+        return nullptr;
+    }
+    const auto &it = std::lower_bound(m_items.begin(), m_items.end(), ItemKey{*date, id}, sortsBefore);
+    if (it == m_items.end() || it->id != id) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+void StorageImpl::insertItem(const StoredItem &item)
+{
+    // new items are usually the newest, so this rarely moves much of the array
+    const auto &position = std::upper_bound(m_items.begin(), m_items.end(), ItemKey{item.date, item.id}, sortsAfter);
+    m_items.insert(position, item);
+    m_itemDates.insert(item.id, item.date);
+}
+
+ArticleRef StorageImpl::article(const StoredItem &item)
+{
+    return m_articleFactory.getInstance(item.id, this, m_feedFactory.find(item.feed), item);
+}
+
+QVector<const StoredItem *> StorageImpl::select(const ArticleRows::Row &after, int limit, const ItemFilter &filter) const
+{
+    QVector<const StoredItem *> selected;
+    const ItemKey &cursor{after.id == 0 ? ItemKey{} : ItemKey{after.date, after.id}};
+    auto it = std::lower_bound(m_items.cbegin(), m_items.cend(), cursor, sortsBefore);
+    while (it != m_items.cbegin() && (limit < 0 || selected.size() < limit)) {
+        --it;
+        if (filter(*it)) {
+            selected.append(&*it);
+        }
+    }
+    return selected;
+}
+
+Future<ArticleRef> *StorageImpl::page(const ArticleRef &after, int limit, const ItemFilter &filter)
+{
+    ArticleRows::Row cursor;
+    if (const auto *article = qobject_cast<const ArticleImpl *>(after.get())) {
+        cursor.id = article->id();
+        cursor.date = article->date().toSecsSinceEpoch();
+    }
+    QVector<ArticleRef> articles;
+    for (const auto *item : select(cursor, limit, filter)) {
+        articles.append(article(*item));
+    }
+    return Future<ArticleRef>::yield(this, [articles](auto *op) {
+        for (const auto &article : articles) {
+            op->appendResult(article);
+        }
+    });
+}
+
+Future<ArticleRows> *StorageImpl::rows(const ArticleRows::Row &after, int limit, const ItemFilter &filter)
+{
+    ArticleRows rows(m_rowSource);
+    for (const auto *item : select(after, limit, filter)) {
+        rows.append({item->id, item->feed, item->date, item->isRead, item->isStarred, item->headline, item->author, item->url});
+    }
+    return Future<ArticleRows>::yield(this, [rows](auto *op) {
+        op->setResult(rows);
+    });
+}
+
+static bool anyItem(const StoredItem & /*item*/)
+{
+    return true;
+}
+
+static bool unreadItem(const StoredItem &item)
+{
+    return !item.isRead;
+}
+
+static bool starredItem(const StoredItem &item)
+{
+    return item.isStarred;
+}
+
+static StorageImpl::ItemFilter feedItems(FeedImpl *feed, bool unreadOnly)
+{
+    const qint64 feedId{feed->id()};
+    return [feedId, unreadOnly](const StoredItem &item) {
+        return item.feed == feedId && !(unreadOnly && item.isRead);
+    };
+}
+
+StorageImpl::ItemFilter StorageImpl::searchFilter(const QString &query) const
+{
+    const QString &simplified{query.simplified()};
+    const QStringList &words{simplified.isEmpty() ? QStringList() : simplified.split(' ')};
+    return [this, words](const StoredItem &item) {
+        if (words.isEmpty()) {
+            return false;
+        }
+        const QString &text{m_searchText[item.id]};
+        return std::all_of(words.cbegin(), words.cend(), [&text](const QString &word) {
+            return text.contains(word, Qt::CaseInsensitive);
+        });
+    };
+}
+
+Future<ArticleRef> *StorageImpl::getAll()
+{
+    return getAllPage({}, -1);
+}
+
+Future<ArticleRef> *StorageImpl::getUnread()
+{
+    return getUnreadPage({}, -1);
+}
+
+Future<ArticleRef> *StorageImpl::getStarred()
+{
+    return getStarredPage({}, -1);
+}
+
+Future<ArticleRef> *StorageImpl::getAllPage(const ArticleRef &after, int limit)
+{
+    return page(after, limit, anyItem);
+}
+
+Future<ArticleRef> *StorageImpl::getUnreadPage(const ArticleRef &after, int limit)
+{
+    return page(after, limit, unreadItem);
+}
+
+Future<ArticleRef> *StorageImpl::getStarredPage(const ArticleRef &after, int limit)
+{
+    return page(after, limit, starredItem);
+}
+
+Future<ArticleRef> *StorageImpl::getByFeed(FeedImpl *feed, const ArticleRef &after, int limit)
+{
+    return page(after, limit, feedItems(feed, false));
+}
+
+Future<ArticleRef> *StorageImpl::getUnreadByFeed(FeedImpl *feed, const ArticleRef &after, int limit)
+{
+    return page(after, limit, feedItems(feed, true));
+}
+
+Future<ArticleRef> *StorageImpl::search(const QString &query, const ArticleRef &after, int limit)
+{
+    return page(after, limit, searchFilter(query));
+}
+
+Future<ArticleRows> *StorageImpl::getAllRows(const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, anyItem);
+}
+
+Future<ArticleRows> *StorageImpl::getUnreadRows(const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, unreadItem);
+}
+
+Future<ArticleRows> *StorageImpl::getStarredRows(const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, starredItem);
+}
+
+Future<ArticleRows> *StorageImpl::getRowsByFeed(FeedImpl *feed, const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, feedItems(feed, false));
+}
+
+Future<ArticleRows> *StorageImpl::getUnreadRowsByFeed(FeedImpl *feed, const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, feedItems(feed, true));
+}
+
+Future<ArticleRows> *StorageImpl::searchRows(const QString &query, const ArticleRows::Row &after, int limit)
+{
+    return rows(after, limit, searchFilter(query));
+}
+
+Future<StoredArticles> *StorageImpl::storeArticles(FeedImpl *feed, const QVector<ParsedItem> &items)
+{
+    const qint64 feedId{feed->id()};
+    const qint64 now{QDateTime::currentSecsSinceEpoch()};
+    QVector<ArticleRef> inserted;
+    int updated{0};
+    for (const auto &source : items) {
+        const QString &content{source.content};
+        const qint64 date{static_cast<qint64>(source.date)};
+        const QPair<qint64, QString> localId{feedId, source.id};
+
+        const auto &existing = m_localIds.constFind(localId);
+        StoredItem *stored{existing != m_localIds.constEnd() ? findItem(*existing) : nullptr};
+        StoredItem item{stored != nullptr ? *stored : StoredItem{}};
+        item.headline = source.title;
+        item.author = source.author;
+        item.url = source.url;
+        if (stored == nullptr) {
+            // like the SQLite storage, undated items are stamped with the time they were first seen
+            item.id = ++m_lastItemId;
+            item.feed = feedId;
+            item.localId = source.id;
+            item.date = date != 0 ? date : now;
+            insertItem(item);
+            m_localIds.insert(localId, item.id);
+        } else {
+            if (date != 0 && date != item.date) {
+                m_items.erase(m_items.begin() + (stored - m_items.data()));
+                item.date = date;
+                insertItem(item);
+            } else {
+                *stored = item;
+            }
+        }
+        if (!content.isEmpty()) {
+            m_content.insert(item.id, content);
+        }
+        m_searchText.insert(item.id, searchText(item, m_content.value(item.id)));
+
+        if (stored == nullptr) {
+            inserted.append(article(item));
+            continue;
+        }
+        ++updated;
+        if (const auto &instance = m_articleFactory.find(item.id)) {
+            instance->updateHeaders(item);
+        }
+    }
+    feed->setPostingInterval(postingInterval(feedId, now));
+    // there are no writes to save here, so nothing is skipped
+    return Future<StoredArticles>::yield(this, [inserted, updated](auto *op) {
+        op->setResult(StoredArticles{true, inserted, updated, 0});
+    });
+}
+
+qint64 StorageImpl::postingInterval(qint64 feedId, qint64 now) const
+{
+    // measured like the SQLite storage does: the feed's items in the window, spread up to now
+    const ItemKey windowStart{now - postingWindow, std::numeric_limits<qint64>::max()};
+    const auto &first = std::upper_bound(m_items.begin(), m_items.end(), windowStart, sortsAfter);
+    qint64 count{0};
+    qint64 oldest{now};
+    for (auto it = first; it != m_items.end(); ++it) {
+        if (it->feed == feedId) {
+            oldest = std::min(oldest, it->date);
+            ++count;
+        }
+    }
+    if (count == 0) {
+        return postingWindow;
+    }
+    return std::max<qint64>((now - oldest) / count, 1);
+}
+
+Future<QString> *StorageImpl::getContent(ArticleImpl *article)
+{
+    const QString &content{m_content.value(article->id())};
+    return Future<QString>::yield(this, [content](auto *op) {
+        op->appendResult(content);
+    });
+}
+
+void StorageImpl::onArticleReadChanged(ArticleImpl *article)
+{
+    if (auto *item = findItem(article->id())) {
+        item->isRead = article->isRead();
+    }
+}
+
+void StorageImpl::onArticleStarredChanged(ArticleImpl *article)
+{
+    if (auto *item = findItem(article->id())) {
+        item->isStarred = article->isStarred();
+    }
+}
+
+void StorageImpl::applyUnreadDeltas(const QHash<qint64, int> &deltas)
+{
+    for (auto it = deltas.constBegin(); it != deltas.constEnd(); ++it) {
+        if (auto *feed = m_feedFactory.find(it.key())) {
+            feed->onArticlesReadChanged(it.value());
+        }
+    }
+}
+
+template<typename Filter>
+Future<qint64> *StorageImpl::markReadWhere(bool isRead, Filter filter)
+{
+    QHash<qint64, int> unreadDeltas;
+    qint64 changed{0};
+    for (auto &item : m_items) {
+        if (item.isRead == isRead || !filter(item)) {
+            continue;
+        }
+        item.isRead = isRead;
+        unreadDeltas[item.feed] += isRead ? -1 : 1;
+        if (const auto &instance = m_articleFactory.find(item.id)) {
+            instance->updateRead(isRead);
+        }
+        ++changed;
+    }
+    applyUnreadDeltas(unreadDeltas);
+    return Future<qint64>::yield(this, [changed](auto *op) {
+        op->setResult(changed);
+    });
+}
+
+static QSet<qint64> articleIds(const QVector<ArticleRef> &articles)
+{
+    QSet<qint64> ids;
+    ids.reserve(articles.size());
+    for (const auto &article : articles) {
+        if (const auto *articleImpl = qobject_cast<const ArticleImpl *>(article.get())) {
+            ids.insert(articleImpl->id());
+        }
+    }
+    return ids;
+}
+
+Future<qint64> *StorageImpl::markRead(const QVector<ArticleRef> &articles, bool isRead)
+{
+    const QSet<qint64> &ids{articleIds(articles)};
+    return markReadWhere(isRead, [&ids](const StoredItem &item) {
+        return ids.contains(item.id);
+    });
+}
+
+Future<qint64> *StorageImpl::markStarred(const QVector<ArticleRef> &articles, bool isStarred)
+{
+    qint64 changed{0};
+    for (const qint64 id : articleIds(articles)) {
+        auto *item = findItem(id);
+        if (item == nullptr || item->isStarred == isStarred) {
+            continue;
+        }
+        item->isStarred = isStarred;
+        if (const auto &instance = m_articleFactory.find(id)) {
+            instance->updateStarred(isStarred);
+        }
+        ++changed;
+    }
+    return Future<qint64>::yield(this, [changed](auto *op) {
+        op->setResult(changed);
+    });
+}
+
+static qint64 dateLimit(const QDateTime &upTo)
+{
+    return upTo.isValid() ? upTo.toSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+}
+
+Future<qint64> *StorageImpl::markFeedRead(Feed *feed, const QDateTime &upTo)
+{
+    auto *feedImpl = qobject_cast<FeedImpl *>(feed);
+    if (feedImpl == nullptr) {
+        return Storage::markFeedRead(feed, upTo);
+    }
+    const qint64 feedId{feedImpl->id()};
+    const qint64 limit{dateLimit(upTo)};
+    return markReadWhere(true, [feedId, limit](const StoredItem &item) {
+        return item.feed == feedId && item.date <= limit;
+    });
+}
+
+Future<qint64> *StorageImpl::markAllRead(const QDateTime &upTo)
+{
+    const qint64 limit{dateLimit(upTo)};
+    return markReadWhere(true, [limit](const StoredItem &item) {
+        return item.date <= limit;
+    });
+}
+
+template<typename Filter>
+int StorageImpl::removeWhere(Filter filter)
+{
+    // a stable partition leaves the removed items intact, so that they can be forgotten before they are erased
+    const auto &removed = std::stable_partition(m_items.begin(), m_items.end(), [&filter](const StoredItem &item) {
+        return !filter(item);
+    });
+    QHash<qint64, int> unreadDeltas;
+    for (auto it = removed; it != m_items.end(); ++it) {
+        m_itemDates.remove(it->id);
+        m_localIds.remove({it->feed, it->localId});
+        m_content.remove(it->id);
+        m_searchText.remove(it->id);
+        if (!it->isRead) {
+            --unreadDeltas[it->feed];
+        }
+    }
+    const int count{static_cast<int>(m_items.end() - removed)};
+    m_items.erase(removed, m_items.end());
+    applyUnreadDeltas(unreadDeltas);
+    return count;
+}
+
+Future<qint64> *StorageImpl::runMaintenance(qint64 defaultExpireAge)
+{
+    const qint64 now{QDateTime::currentSecsSinceEpoch()};
+    QHash<qint64, qint64> oldestKept;
+    for (auto *feed : qAsConst(m_feeds)) {
+        qint64 expireAge{defaultExpireAge};
+        if (feed->expireMode() == Feed::DisableUpdateMode) {
+            expireAge = 0;
+        } else if (feed->expireMode() == Feed::OverrideUpdateMode) {
+            expireAge = feed->expireAge();
+        }
+        if (expireAge > 0) {
+            oldestKept.insert(feed->id(), now - expireAge);
+        }
+    }
+    const qint64 deleted{removeWhere([&oldestKept](const StoredItem &item) {
+        const auto &limit = oldestKept.constFind(item.feed);
+        return !item.isStarred && limit != oldestKept.constEnd() && item.date < *limit;
+    })};
+    m_items.shrink_to_fit();
+    return Future<qint64>::yield(this, [deleted](auto *op) {
+        op->setResult(deleted);
+    });
+}
+
+void StorageImpl::onFeedRequestDelete(FeedImpl *feed)
+{
+    feed->updater()->abort();
+    const qint64 feedId{feed->id()};
+    removeWhere([feedId](const StoredItem &item) {
+        return item.feed == feedId;
+    });
+    m_feeds.removeAll(feed);
+    feed->deleteLater();
+}
+
+Future<Feed *> *StorageImpl::getFeeds()
+{
+    const QVector<QPointer<FeedImpl>> feeds{m_feeds.cbegin(), m_feeds.cend()};
+    return Future<Feed *>::yield(this, [feeds](auto *op) {
+        for (const auto &feed : feeds) {
+            if (!feed.isNull()) {
+                op->appendResult(feed.data());
+            }
+        }
+    });
+}
+
+Future<Feed *> *StorageImpl::storeFeed(Feed *feed)
+{
+    auto *feedImpl = m_feedFactory.getInstance(++m_lastFeedId, this);
+    feedImpl->updateParams(feed);
+    m_feeds.append(feedImpl);
+    const QPointer<FeedImpl> stored{feedImpl};
+    return Future<Feed *>::yield(this, [stored](auto *op) {
+        if (!stored.isNull()) {
+            op->appendResult(stored.data());
+        }
+    });
+}
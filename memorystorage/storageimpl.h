@@ -0,0 +1,133 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MEMORYSTORAGE_STORAGEIMPL_H
+#define MEMORYSTORAGE_STORAGEIMPL_H
+#include "factory.h"
+#include "storage.h"
+#include <QHash>
+#include <QUrl>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace MemoryStorage
+{
+class FeedImpl;
+class ArticleImpl;
+
+/**
+ * An article as it is held by StorageImpl.
+ */
+struct StoredItem {
+    qint64 date{0}; /** < seconds since the epoch */
+    qint64 id{0};
+    qint64 feed{0};
+    bool isRead{false};
+    bool isStarred{false};
+    QString localId;
+    QString headline;
+    QString author;
+    QUrl url;
+};
+
+/**
+ * Storage that keeps every feed and article in memory, and discards them when it is destroyed.
+ *
+ * Articles are kept in one contiguous array sorted by date, so each date-ordered list is a
+ * scan backwards from its cursor.  Content and search text are kept out of the array, and
+ * articles are found by a hash of their feed and localId when a feed is updated.
+ *
+ * Every operation runs immediately on the calling thread, but the futures still finish on
+ * a later pass of the event loop, as they do with other storage.
+ */
+class StorageImpl : public FeedCore::Storage
+{
+    Q_OBJECT
+public:
+    explicit StorageImpl(QObject *parent = nullptr);
+    ~StorageImpl();
+    FeedCore::Future<FeedCore::ArticleRef> *getByFeed(FeedImpl *feed, const FeedCore::ArticleRef &after = {}, int limit = -1);
+    FeedCore::Future<FeedCore::ArticleRef> *getUnreadByFeed(FeedImpl *feed, const FeedCore::ArticleRef &after = {}, int limit = -1);
+    FeedCore::Future<FeedCore::ArticleRows> *getRowsByFeed(FeedImpl *feed, const FeedCore::ArticleRows::Row &after, int limit);
+    FeedCore::Future<FeedCore::ArticleRows> *getUnreadRowsByFeed(FeedImpl *feed, const FeedCore::ArticleRows::Row &after, int limit);
+    FeedCore::Future<FeedCore::StoredArticles> *storeArticles(FeedImpl *feed, const QVector<FeedCore::ParsedItem> &items);
+    FeedCore::Future<QString> *getContent(ArticleImpl *article);
+    void onArticleReadChanged(ArticleImpl *article);
+    void onArticleStarredChanged(ArticleImpl *article);
+    void onFeedRequestDelete(FeedImpl *feed);
+
+    FeedCore::Future<FeedCore::ArticleRef> *getAll() final;
+    FeedCore::Future<FeedCore::ArticleRef> *getUnread() final;
+    FeedCore::Future<FeedCore::ArticleRef> *getStarred() final;
+    FeedCore::Future<FeedCore::ArticleRef> *getAllPage(const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getUnreadPage(const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getStarredPage(const FeedCore::ArticleRef &after, int limit) final;
+
+    /**
+     * Every word of /query/ must appear in the headline, author or text of an article.  Unlike
+     * the SQLite storage, matches are not ranked; they are listed newest first.
+     */
+    FeedCore::Future<FeedCore::ArticleRef> *search(const QString &query, const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getAllRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getUnreadRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getStarredRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *searchRows(const QString &query, const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<qint64> *markRead(const QVector<FeedCore::ArticleRef> &articles, bool isRead) final;
+    FeedCore::Future<qint64> *markStarred(const QVector<FeedCore::ArticleRef> &articles, bool isStarred) final;
+    FeedCore::Future<qint64> *markFeedRead(FeedCore::Feed *feed, const QDateTime &upTo) final;
+    FeedCore::Future<qint64> *markAllRead(const QDateTime &upTo) final;
+    FeedCore::Future<qint64> *runMaintenance(qint64 defaultExpireAge) final;
+    FeedCore::Future<FeedCore::Feed *> *getFeeds() final;
+    FeedCore::Future<FeedCore::Feed *> *storeFeed(FeedCore::Feed *feed) final;
+
+    using ItemFilter = std::function<bool(const StoredItem &)>;
+
+private:
+    class RowSource;
+    std::shared_ptr<RowSource> m_rowSource;
+    std::vector<StoredItem> m_items; /** < sorted by date, then id */
+    QHash<qint64, qint64> m_itemDates; /** < the date of each item, which locates it in m_items */
+    QHash<QPair<qint64, QString>, qint64> m_localIds;
+    QHash<qint64, QString> m_content;
+    QHash<qint64, QString> m_searchText;
+    QVector<FeedImpl *> m_feeds;
+    qint64 m_lastItemId{0};
+    qint64 m_lastFeedId{0};
+    FeedCore::ObjectFactory<qint64, FeedImpl> m_feedFactory;
+    FeedCore::SharedFactory<qint64, ArticleImpl> m_articleFactory;
+
+    StoredItem *findItem(qint64 id);
+    void insertItem(const StoredItem &item);
+    FeedCore::ArticleRef article(const StoredItem &item);
+
+    /**
+     * The mean time between the feed's recent items, for Feed::postingInterval.
+     */
+    qint64 postingInterval(qint64 feedId, qint64 now) const;
+
+    /**
+     * One page of the items that pass /filter/, newest first, as articles or as rows.
+     */
+    QVector<const StoredItem *> select(const FeedCore::ArticleRows::Row &after, int limit, const ItemFilter &filter) const;
+    FeedCore::Future<FeedCore::ArticleRef> *page(const FeedCore::ArticleRef &after, int limit, const ItemFilter &filter);
+    FeedCore::Future<FeedCore::ArticleRows> *rows(const FeedCore::ArticleRows::Row &after, int limit, const ItemFilter &filter);
+    ItemFilter searchFilter(const QString &query) const;
+
+    /**
+     * Change the read flag of every article that passes /filter/, and adjust the unread counts.
+     */
+    template<typename Filter>
+    FeedCore::Future<qint64> *markReadWhere(bool isRead, Filter filter);
+
+    /**
+     * Delete every article that passes /filter/, and adjust the unread counts.
+     */
+    template<typename Filter>
+    int removeWhere(Filter filter);
+    void applyUnreadDeltas(const QHash<qint64, int> &deltas);
+};
+}
+#endif // MEMORYSTORAGE_STORAGEIMPL_H
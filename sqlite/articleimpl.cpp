@@ -5,6 +5,7 @@
 
 #include "sqlite/articleimpl.h"
 #include "sqlite/feedimpl.h"
+#include "sqlite/itemquery.h"
 #include "sqlite/storageimpl.h"
 #include <QSqlQuery>
 #include <QVariant>
@@ -12,21 +13,14 @@
 using namespace FeedCore;
 using namespace SqliteStorage;
 
-ArticleImpl::ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const ItemQuery &q)
+ArticleImpl::ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const ItemRow &row)
     : Article(feed, nullptr)
     , m_id{id}
     , m_storage(storage)
 {
-    updateFromQuery(q);
-    QObject::connect(this, &Article::readStatusChanged, storage, [this, storage] {
-        storage->onArticleReadChanged(this);
-    });
-    QObject::connect(this, &Article::readStatusChanged, feed, [this, feed] {
-        feed->onArticleReadChanged(this);
-    });
-    QObject::connect(this, &Article::starredChanged, storage, [this, storage] {
-        storage->onArticleStarredChanged(this);
-    });
+    updateHeaders(row);
+    Article::setRead(row.isRead);
+    Article::setStarred(row.isStarred);
 }
 
 qint64 ArticleImpl::id() const
@@ -34,14 +28,47 @@ qint64 ArticleImpl::id() const
     return m_id;
 }
 
-void ArticleImpl::updateFromQuery(const ItemQuery &q)
+void ArticleImpl::updateHeaders(const ItemRow &row)
+{
+    Article::setTitle(row.headline);
+    Article::setAuthor(row.author);
+    Article::setDate(row.date);
+    Article::setUrl(row.url);
+}
+
+void ArticleImpl::updateRead(bool isRead)
+{
+    Article::setRead(isRead);
+}
+
+void ArticleImpl::updateStarred(bool isStarred)
+{
+    Article::setStarred(isStarred);
+}
+
+void ArticleImpl::setRead(bool isRead)
 {
-    Article::setTitle(q.headline());
-    Article::setAuthor(q.author());
-    Article::setDate(q.date());
-    Article::setUrl(q.url());
-    Article::setRead(q.isRead());
-    Article::setStarred(q.isStarred());
+    if (isRead == this->isRead()) {
+        return;
+    }
+    Article::setRead(isRead);
+    if (!m_storage.isNull()) {
+        m_storage->onArticleReadChanged(this);
+    }
+    if (auto *feedImpl = qobject_cast<FeedImpl *>(feed())) {
+        feedImpl->onArticleReadChanged(this);
+    }
+}
+
+void ArticleImpl::setStarred(bool isStarred)
+{
+    if (isStarred == this->isStarred()) {
+        return;
+    }
+    Article::setStarred(isStarred);
+    if (!m_storage.isNull()) {
+        m_storage->onArticleStarredChanged(this);
+    }
 }
 
 void ArticleImpl::requestContent()
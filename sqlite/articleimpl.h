@@ -13,18 +13,36 @@ namespace SqliteStorage
 {
 class FeedImpl;
 class StorageImpl;
-class ItemQuery;
+struct ItemRow;
 
 class ArticleImpl : public FeedCore::Article
 {
     Q_OBJECT
 public:
     qint64 id() const;
-    void updateFromQuery(const ItemQuery &q);
+
+    /**
+     * Refresh the article's headers from a stored row.
+     *
+     * The read and starred flags are left alone, since the in-memory values are
+     * authoritative once the article has been loaded.
+     */
+    void updateHeaders(const ItemRow &row);
+
+    /**
+     * Apply a flag change that was already written to storage by a bulk update.
+     *
+     * Unlike setRead and setStarred, these only update the in-memory value.
+     */
+    void updateRead(bool isRead);
+    void updateStarred(bool isStarred);
+
+    void setRead(bool isRead) final;
+    void setStarred(bool isStarred) final;
     void requestContent() final;
 
 private:
-    ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const ItemQuery &q);
+    ArticleImpl(qint64 id, StorageImpl *storage, FeedImpl *feed, const ItemRow &row);
     qint64 m_id;
     QPointer<StorageImpl> m_storage;
     friend FeedCore::SharedFactory<qint64, ArticleImpl>;
@@ -0,0 +1,65 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sqlite/databasethread.h"
+#include <QMutexLocker>
+
+using namespace SqliteStorage;
+
+DatabaseThread::DatabaseThread(const QString &filePath, const DatabaseOptions &options, FeedDatabase::Mode mode)
+    : m_context{new QObject}
+{
+    m_thread.setObjectName(QStringLiteral("FeedDatabase"));
+    m_context->moveToThread(&m_thread);
+    QObject::connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+    enqueue([this, filePath, options, mode] {
+        m_db = std::make_unique<FeedDatabase>(filePath, options, mode);
+    });
+}
+
+DatabaseThread::~DatabaseThread()
+{
+    enqueue([this] {
+        m_db.reset();
+        QThread::currentThread()->quit();
+    });
+    m_thread.wait();
+}
+
+quint64 DatabaseThread::enqueue(const std::function<void()> &job)
+{
+    const quint64 ticket{++m_posted};
+    QMetaObject::invokeMethod(
+        m_context,
+        [this, job, ticket] {
+            job();
+            QMutexLocker lock(&m_mutex);
+            m_completed = ticket;
+            m_progress.wakeAll();
+        },
+        Qt::QueuedConnection);
+    return ticket;
+}
+
+quint64 DatabaseThread::post(const Job &job)
+{
+    return enqueue([this, job] {
+        job(*m_db);
+    });
+}
+
+void DatabaseThread::waitFor(quint64 ticket)
+{
+    QMutexLocker lock(&m_mutex);
+    while (m_completed < ticket) {
+        m_progress.wait(&m_mutex);
+    }
+}
+
+void DatabaseThread::sync()
+{
+    waitFor(m_posted);
+}
@@ -0,0 +1,65 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SQLITE_DATABASETHREAD_H
+#define SQLITE_DATABASETHREAD_H
+#include "sqlite/feeddatabase.h"
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+
+namespace SqliteStorage
+{
+/**
+ * A FeedDatabase connection that is opened, used and closed on its own thread.
+ *
+ * Jobs run on the worker thread in the order in which they were posted.  Destroying
+ * the DatabaseThread waits for every posted job to finish before closing the connection.
+ *
+ * Jobs must only be posted from the thread that created the DatabaseThread.
+ */
+class DatabaseThread
+{
+public:
+    using Job = std::function<void(FeedDatabase &)>;
+
+    DatabaseThread(const QString &filePath, const DatabaseOptions &options, FeedDatabase::Mode mode);
+    ~DatabaseThread();
+    DatabaseThread(const DatabaseThread &) = delete;
+    DatabaseThread &operator=(const DatabaseThread &) = delete;
+
+    /**
+     * Queue a job on the worker thread.
+     *
+     * Returns a ticket that can be passed to waitFor().
+     */
+    quint64 post(const Job &job);
+
+    /**
+     * Block until the job with the given ticket, and every job before it, has run.
+     *
+     * This may be called from any thread except the worker thread itself.
+     */
+    void waitFor(quint64 ticket);
+
+    /**
+     * Block until every job posted so far has run.
+     */
+    void sync();
+
+private:
+    QThread m_thread;
+    QObject *m_context{nullptr};
+    std::unique_ptr<FeedDatabase> m_db;
+    quint64 m_posted{0};
+    quint64 m_completed{0};
+    QMutex m_mutex;
+    QWaitCondition m_progress;
+    quint64 enqueue(const std::function<void()> &job);
+};
+}
+#endif // SQLITE_DATABASETHREAD_H
@@ -4,12 +4,22 @@
  */
 
 #include "feeddatabase.h"
+#include "cmake-config.h"
+#include "sqlite/itemcontent.h"
 #include <QDebug>
 #include <QDir>
 #include <QSqlDatabase>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QStandardPaths>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#ifdef SQLITE3_FOUND
+#include "sqlite/nativestatement.h"
+#include <sqlite3.h>
+#endif
 
 namespace SqliteStorage
 {
@@ -51,105 +61,684 @@ static bool exec(QSqlDatabase &db, const QVector<QString> &queries)
     return true;
 }
 
-static void initDatabase(QSqlDatabase &db)
+/**
+ * One step of the schema history.  The step at index N upgrades a database from user_version N
+ * to N+1; it runs inside the same transaction that records the new version.
+ */
+using Migration = std::function<bool(QSqlDatabase &)>;
+
+static Migration sqlMigration(const QVector<QString> &queries)
+{
+    return [queries](QSqlDatabase &db) {
+        return exec(db, queries);
+    };
+}
+
+static bool compressExistingContent(QSqlDatabase &db)
+{
+    if (!exec(db, "ALTER TABLE Item ADD COLUMN contentCodec INTEGER NOT NULL DEFAULT 0;")) {
+        return false;
+    }
+
+    static constexpr int batchSize{500};
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    select.prepare("SELECT id, feedContent FROM Item WHERE id>:after AND feedContent IS NOT NULL ORDER BY id LIMIT :limit");
+    QSqlQuery update(db);
+    update.prepare("UPDATE Item SET feedContent=:content, contentCodec=:codec WHERE id=:id");
+
+    qint64 lastId{0};
+    for (;;) {
+        select.bindValue(":after", lastId);
+        select.bindValue(":limit", batchSize);
+        if (!select.exec()) {
+            qWarning() << "SQL Error in compressExistingContent: " + select.lastError().text();
+            return false;
+        }
+        QVector<QPair<qint64, QString>> batch;
+        while (select.next()) {
+            batch.append({select.value(0).toLongLong(), select.value(1).toString()});
+        }
+        if (batch.isEmpty()) {
+            break;
+        }
+        for (const auto &row : qAsConst(batch)) {
+            const StoredContent &stored{compressContent(row.second)};
+            update.bindValue(":content", stored.data);
+            update.bindValue(":codec", stored.codec);
+            update.bindValue(":id", row.first);
+            if (!update.exec()) {
+                qWarning() << "SQL Error in compressExistingContent: " + update.lastError().text();
+                return false;
+            }
+        }
+        lastId = batch.last().first;
+    }
+    return true;
+}
+
+static bool indexExistingItems(QSqlDatabase &db)
+{
+    if (!exec(db,
+              {"CREATE VIRTUAL TABLE ItemSearch USING fts5(headline, author, content, tokenize='unicode61 remove_diacritics 2');",
+
+               // content is compressed, so it is indexed by upsertItems rather than by a trigger
+               "CREATE TRIGGER Item_insert_search AFTER INSERT ON Item BEGIN "
+               "INSERT INTO ItemSearch (rowid, headline, author) VALUES (new.id, new.headline, new.author); "
+               "END;",
+
+               "CREATE TRIGGER Item_update_search AFTER UPDATE OF headline, author ON Item "
+               "WHEN old.headline IS NOT new.headline OR old.author IS NOT new.author BEGIN "
+               "UPDATE ItemSearch SET headline=new.headline, author=new.author WHERE rowid=new.id; "
+               "END;",
+
+               "CREATE TRIGGER Item_delete_search AFTER DELETE ON Item BEGIN "
+               "DELETE FROM ItemSearch WHERE rowid=old.id; "
+               "END;"})) {
+        return false;
+    }
+
+    static constexpr int batchSize{500};
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    select.prepare(
+        "SELECT Item.id, Item.headline, Item.author, ItemContent.codec, ItemContent.content "
+        "FROM Item LEFT JOIN ItemContent ON ItemContent.itemId=Item.id "
+        "WHERE Item.id>:after ORDER BY Item.id LIMIT :limit");
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO ItemSearch (rowid, headline, author, content) VALUES (:id, :headline, :author, :content)");
+
+    qint64 lastId{0};
+    for (;;) {
+        select.bindValue(":after", lastId);
+        select.bindValue(":limit", batchSize);
+        if (!select.exec()) {
+            qWarning() << "SQL Error in indexExistingItems: " + select.lastError().text();
+            return false;
+        }
+        QVector<QVariantList> batch;
+        while (select.next()) {
+            const QString &content{select.value(4).isNull() ? QString() : decompressContent({select.value(3).toInt(), select.value(4)})};
+            batch.append({select.value(0), select.value(1), select.value(2), searchableText(content)});
+        }
+        if (batch.isEmpty()) {
+            break;
+        }
+        for (const auto &row : qAsConst(batch)) {
+            insert.bindValue(":id", row[0]);
+            insert.bindValue(":headline", row[1]);
+            insert.bindValue(":author", row[2]);
+            insert.bindValue(":content", row[3]);
+            if (!insert.exec()) {
+                qWarning() << "SQL Error in indexExistingItems: " + insert.lastError().text();
+                return false;
+            }
+        }
+        lastId = batch.last()[0].toLongLong();
+    }
+    return true;
+}
+
+// the Item indexes and triggers are created again whenever the Item table is rebuilt
+static const QVector<QString> &itemIndexes()
+{
+    // indexes for the article lists, so that they can be read in date order without a sort
+    static const QVector<QString> indexes{"CREATE INDEX IF NOT EXISTS Item_date ON Item(date);",
+                                          "CREATE INDEX IF NOT EXISTS Item_feed_date ON Item(feed, date);",
+                                          "CREATE INDEX IF NOT EXISTS Item_isRead_date ON Item(isRead, date);",
+                                          "CREATE INDEX IF NOT EXISTS Item_feed_isRead_date ON Item(feed, isRead, date);",
+                                          "CREATE INDEX IF NOT EXISTS Item_starred_date ON Item(date) WHERE isStarred=1;"};
+    return indexes;
+}
+
+static const QVector<QString> &itemUnreadCountTriggers()
+{
+    static const QVector<QString> triggers{
+        "CREATE TRIGGER Item_insert_unreadCount AFTER INSERT ON Item WHEN new.isRead=0 BEGIN "
+        "UPDATE FeedUnreadCount SET unreadCount=unreadCount+1 WHERE feed=new.feed; "
+        "END;",
+
+        "CREATE TRIGGER Item_delete_unreadCount AFTER DELETE ON Item WHEN old.isRead=0 BEGIN "
+        "UPDATE FeedUnreadCount SET unreadCount=unreadCount-1 WHERE feed=old.feed; "
+        "END;",
+
+        "CREATE TRIGGER Item_update_unreadCount AFTER UPDATE OF isRead, feed ON Item "
+        "WHEN (old.isRead=0) IS NOT (new.isRead=0) OR old.feed IS NOT new.feed BEGIN "
+        "UPDATE FeedUnreadCount SET unreadCount=unreadCount-1 WHERE feed=old.feed AND old.isRead=0; "
+        "UPDATE FeedUnreadCount SET unreadCount=unreadCount+1 WHERE feed=new.feed AND new.isRead=0; "
+        "END;"};
+    return triggers;
+}
+
+static const QVector<Migration> &migrations()
+{
+    static const QVector<Migration> steps{
+        // 1: initial schema
+        sqlMigration({"CREATE TABLE Feed("
+                      "id INTEGER PRIMARY KEY,"
+                      "displayName TEXT,"
+                      "category TEXT,"
+                      "url TEXT NOT NULL,"
+                      "link TEXT,"
+                      "icon TEXT,"
+                      "updateInterval INTEGER,"
+                      "lastUpdate INTEGER,"
+                      "expireAge INTEGER);",
+
+                      "CREATE TABLE Item("
+                      "id INTEGER PRIMARY KEY,"
+                      "feed INTEGER REFERENCES Feed,"
+                      "localId TEXT NOT NULL,"
+                      "headline TEXT,"
+                      "author TEXT,"
+                      "date INTEGER,"
+                      "url TEXT,"
+                      "feedContent TEXT,"
+                      "isRead INTEGER,"
+                      "isStarred INTEGER,"
+                      "UNIQUE(feed,localId));"}),
+
+        // 2: indexes for the article lists
+        sqlMigration(itemIndexes()),
+
+        // 3: per-feed unread counters, maintained by triggers
+        sqlMigration(QVector<QString>{"CREATE TABLE FeedUnreadCount("
+                                      "feed INTEGER PRIMARY KEY,"
+                                      "unreadCount INTEGER NOT NULL DEFAULT 0);",
+
+                                      "INSERT INTO FeedUnreadCount (feed, unreadCount) "
+                                      "SELECT Feed.id, (SELECT COUNT(*) FROM Item WHERE Item.feed=Feed.id AND Item.isRead=0) FROM Feed;",
+
+                                      "CREATE TRIGGER Feed_insert_unreadCount AFTER INSERT ON Feed BEGIN "
+                                      "INSERT INTO FeedUnreadCount (feed, unreadCount) VALUES (new.id, 0); "
+                                      "END;",
+
+                                      "CREATE TRIGGER Feed_delete_unreadCount AFTER DELETE ON Feed BEGIN "
+                                      "DELETE FROM FeedUnreadCount WHERE feed=old.id; "
+                                      "END;"}
+                     + itemUnreadCountTriggers()),
+
+        // 4: compressed content
+        compressExistingContent,
+
+        // 5: content moves to its own table, so that list scans only read the narrow Item rows.
+        // SQLite can't drop columns in place, so Item is rebuilt along with its indexes and triggers.
+        sqlMigration(QVector<QString>{"CREATE TABLE ItemContent("
+                                      "itemId INTEGER PRIMARY KEY,"
+                                      "codec INTEGER NOT NULL DEFAULT 0,"
+                                      "content BLOB);",
+
+                                      "INSERT INTO ItemContent (itemId, codec, content) "
+                                      "SELECT id, contentCodec, feedContent FROM Item WHERE feedContent IS NOT NULL;",
+
+                                      "CREATE TABLE Item_new("
+                                      "id INTEGER PRIMARY KEY,"
+                                      "feed INTEGER REFERENCES Feed,"
+                                      "localId TEXT NOT NULL,"
+                                      "headline TEXT,"
+                                      "author TEXT,"
+                                      "date INTEGER,"
+                                      "url TEXT,"
+                                      "isRead INTEGER,"
+                                      "isStarred INTEGER,"
+                                      "UNIQUE(feed,localId));",
+
+                                      "INSERT INTO Item_new (id, feed, localId, headline, author, date, url, isRead, isStarred) "
+                                      "SELECT id, feed, localId, headline, author, date, url, isRead, isStarred FROM Item;",
+
+                                      "DROP TABLE Item;",
+                                      "ALTER TABLE Item_new RENAME TO Item;",
+
+                                      "CREATE TRIGGER Item_delete_content AFTER DELETE ON Item BEGIN "
+                                      "DELETE FROM ItemContent WHERE itemId=old.id; "
+                                      "END;"}
+                     + itemIndexes() + itemUnreadCountTriggers()),
+
+        // 6: full-text search
+        indexExistingItems,
+
+        // 7: fingerprints for skipping unchanged items; existing items are rewritten once on their next update
+        sqlMigration({"ALTER TABLE Item ADD COLUMN fingerprint INTEGER;"}),
+
+        // 8: HTTP caching headers, for conditional updates
+        sqlMigration({"ALTER TABLE Feed ADD COLUMN etag TEXT;",
+                      "ALTER TABLE Feed ADD COLUMN lastModified TEXT;",
+                      "ALTER TABLE Feed ADD COLUMN cacheExpires INTEGER;"}),
+
+        // 9: consecutive failed updates, for backing off from broken feeds
+        sqlMigration({"ALTER TABLE Feed ADD COLUMN failureCount INTEGER NOT NULL DEFAULT 0;",
+                      "ALTER TABLE Feed ADD COLUMN lastFailure INTEGER;"}),
+    };
+    return steps;
+}
+
+static bool migrate(QSqlDatabase &db, int version)
+{
+    const auto &steps = migrations();
+    if (!db.transaction()) {
+        qWarning() << "SQL Error in migrate: " + db.lastError().text();
+        return false;
+    }
+    if (!steps[version](db) || !exec(db, QStringLiteral("PRAGMA user_version = %1;").arg(version + 1)) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// schema versions before this one keep content inline in Item, so migrating them frees space that VACUUM releases
+static constexpr int contentTableVersion{5};
+
+static qint64 databaseSize(QSqlDatabase &db)
+{
+    QSqlQuery q(db);
+    if (!q.exec("SELECT page_count * page_size FROM pragma_page_count(), pragma_page_size()") || !q.next()) {
+        qWarning() << "SQL Error in databaseSize: " + q.lastError().text();
+        return 0;
+    }
+    return q.value(0).toLongLong();
+}
+
+// the value of PRAGMA auto_vacuum for INCREMENTAL
+static constexpr int incrementalAutoVacuum{2};
+
+static int getAutoVacuum(QSqlDatabase &db)
 {
-    const auto &v = getVersion(db);
-    bool success = true;
-    if (v == 0) {
-        success = exec(db,
-                       {"CREATE TABLE Feed("
-                        "id INTEGER PRIMARY KEY,"
-                        "displayName TEXT,"
-                        "category TEXT,"
-                        "url TEXT NOT NULL,"
-                        "link TEXT,"
-                        "icon TEXT,"
-                        "updateInterval INTEGER,"
-                        "lastUpdate INTEGER,"
-                        "expireAge INTEGER);",
+    QSqlQuery q("PRAGMA auto_vacuum", db);
+    if (!q.next()) {
+        qWarning("getAutoVacuum returned empty set");
+        return 0;
+    }
+    return q.value(0).toInt();
+}
 
-                        "CREATE TABLE Item("
-                        "id INTEGER PRIMARY KEY,"
-                        "feed INTEGER REFERENCES Feed,"
-                        "localId TEXT NOT NULL,"
-                        "headline TEXT,"
-                        "author TEXT,"
-                        "date INTEGER,"
-                        "url TEXT,"
-                        "feedContent TEXT,"
-                        "isRead INTEGER,"
-                        "isStarred INTEGER,"
-                        "UNIQUE(feed,localId));",
+static DatabaseUpgrade initDatabase(QSqlDatabase &db)
+{
+    const auto &steps = migrations();
+    const int currentVersion{getVersion(db)};
+    DatabaseUpgrade upgrade;
+    upgrade.fromVersion = currentVersion;
+    if (currentVersion > steps.size()) {
+        qWarning() << "Database schema version" << currentVersion << "is newer than this version of the application supports";
+        return upgrade;
+    }
+    upgrade.sizeBefore = databaseSize(db);
+    // maintenance returns the pages freed by expiry with incremental_vacuum.  The mode can
+    // only change before the first table is created, or by rebuilding the file with VACUUM.
+    exec(db, "PRAGMA auto_vacuum=INCREMENTAL");
+    for (int version = currentVersion; version < steps.size(); ++version) {
+        if (!migrate(db, version)) {
+            qWarning() << "Database migration to version" << version + 1 << "failed!";
+            db.close();
+            return upgrade;
+        }
+    }
+    if (currentVersion > 0 && (currentVersion < contentTableVersion || getAutoVacuum(db) != incrementalAutoVacuum)) {
+        // release the space freed by compressing and moving the content, and switch the auto_vacuum mode.
+        // This needs room for a copy of the database, so it is tried again on the next start if it fails.
+        upgrade.vacuumed = exec(db, "VACUUM");
+    }
+    upgrade.sizeAfter = databaseSize(db);
+    return upgrade;
+}
 
-                        "PRAGMA user_version = 1;"});
+static void configureConnection(QSqlDatabase &db, const DatabaseOptions &options)
+{
+    static const QStringList synchronousModes{"OFF", "NORMAL", "FULL", "EXTRA"};
+    const QString &synchronous{options.synchronous.toUpper()};
+    if (synchronousModes.contains(synchronous)) {
+        exec(db, "PRAGMA synchronous=" + synchronous);
+    } else if (!synchronous.isEmpty()) {
+        qWarning() << "Ignoring unknown synchronous mode" << options.synchronous;
     }
-    if (!success) {
-        qWarning("Database initialization failed!");
-        db.close();
+    if (options.cacheSize != 0) {
+        exec(db, QStringLiteral("PRAGMA cache_size=%1").arg(options.cacheSize));
     }
+    exec(db, QStringLiteral("PRAGMA mmap_size=%1").arg(options.mmapSize));
+    exec(db, QStringLiteral("PRAGMA busy_timeout=%1").arg(options.busyTimeout));
 }
 
-FeedDatabase::FeedDatabase(const QString &filePath)
+#ifdef SQLITE3_FOUND
+static sqlite3 *nativeHandle(QSqlDatabase &db)
 {
-    static int dbCount{0};
+    const QVariant &handle{db.driver()->handle()};
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        qWarning() << "Native reads are not supported by the database driver";
+        return nullptr;
+    }
+    // the connection can only be shared with a QtSql driver that uses the same SQLite build
+    QSqlQuery q("SELECT sqlite_source_id()", db);
+    if (!q.next() || q.value(0).toString() != QLatin1String(sqlite3_sourceid())) {
+        qWarning() << "Native reads are disabled, because QtSql uses a different SQLite library";
+        return nullptr;
+    }
+    return *static_cast<sqlite3 *const *>(handle.constData());
+}
+#endif
+
+FeedDatabase::FeedDatabase(const QString &filePath, const DatabaseOptions &options, Mode mode)
+{
+    // connections are opened from several database threads
+    static std::atomic<int> dbCount{0};
     m_dbName = db_name_fmt.arg(++dbCount);
     auto db = QSqlDatabase::addDatabase("QSQLITE", m_dbName);
     db.setDatabaseName(filePath);
+    if (mode == ReadOnly) {
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+    }
     if (!db.open()) {
         qWarning("Failed to open database!");
-    } else {
-        initDatabase(db);
+        return;
+    }
+    configureConnection(db, options);
+    if (mode == ReadWrite) {
+        // the journal mode is persistent, so switch back if WAL was disabled
+        exec(db, options.walMode ? "PRAGMA journal_mode=WAL" : "PRAGMA journal_mode=DELETE");
+        m_upgrade = initDatabase(db);
+    }
+    if (options.nativeReads) {
+#ifdef SQLITE3_FOUND
+        m_native = nativeHandle(db);
+#else
+        qWarning() << "Native reads are not available in this build";
+#endif
     }
 }
 
 FeedDatabase::~FeedDatabase()
 {
+    m_nativeStatements.clear();
+    m_statements.clear();
     db().close();
 }
 
-static const QString select_sort = QStringLiteral("ORDER BY date DESC");
+bool FeedDatabase::nativeReads() const
+{
+    return m_native != nullptr;
+}
+
+const FeedDatabase::StatementCacheStats &FeedDatabase::statementCacheStats() const
+{
+    return m_statementCacheStats;
+}
+
+const DatabaseUpgrade &FeedDatabase::upgrade() const
+{
+    return m_upgrade;
+}
+
+/**
+ * Make room for one more statement in /statements/, and return whether one was dropped.
+ */
+template<typename T>
+static bool evictLeastRecentlyUsed(QHash<QString, T> &statements)
+{
+    if (statements.size() < FeedDatabase::maxCachedStatements) {
+        return false;
+    }
+    // the cache is small, and this only runs when a statement has to be prepared
+    const auto oldest = std::min_element(statements.begin(), statements.end(), [](const T &a, const T &b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    statements.erase(oldest);
+    return true;
+}
+
+QSqlQuery FeedDatabase::statement(const QString &sql)
+{
+    auto it = m_statements.find(sql);
+    // a select that has rows left is still being read by whoever executed it
+    if (it != m_statements.end() && !(it->statement.isActive() && it->statement.isSelect() && it->statement.at() != QSql::AfterLastRow)) {
+        ++m_statementCacheStats.hits;
+        it->lastUsed = ++m_statementUses;
+        it->statement.finish();
+        return it->statement;
+    }
+
+    ++m_statementCacheStats.misses;
+    QSqlQuery q(db());
+    q.setForwardOnly(true);
+    if (!q.prepare(sql)) {
+        qWarning() << "SQL Error preparing statement: " + q.lastError().text();
+        return q;
+    }
+    // a statement that is still being read can be replaced in place
+    if (it == m_statements.end() && evictLeastRecentlyUsed(m_statements)) {
+        ++m_statementCacheStats.evictions;
+    }
+    m_statements.insert(sql, {q, ++m_statementUses});
+    return q;
+}
+
+static QString placeholderList(const QString &placeholder, int count)
+{
+    QStringList placeholders;
+    placeholders.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        placeholders << placeholder;
+    }
+    return placeholders.join(',');
+}
+
+static const QString select_page = QStringLiteral("(date, id) < (:date, :id) ORDER BY date DESC, id DESC LIMIT :limit");
+static const QString select_all_items = ItemQuery::statement(select_page);
+static const QString select_unread_items = ItemQuery::statement("isRead=0 AND " + select_page);
+static const QString select_starred_items = ItemQuery::statement("isStarred=1 AND " + select_page);
+static const QString select_items_by_feed = ItemQuery::statement("feed=:feed AND " + select_page);
+static const QString select_unread_items_by_feed = ItemQuery::statement("feed=:feed AND isRead=0 AND " + select_page);
+static const QString select_item_by_id = ItemQuery::statement("id=:id");
+static const QString select_item_by_local_id = ItemQuery::statement("feed=:feed AND localId=:localId");
+
+static void bindPage(QSqlQuery &q, const ItemCursor &after, int limit)
+{
+    q.bindValue(":date", after.date);
+    q.bindValue(":id", after.id);
+    q.bindValue(":limit", limit);
+}
+
+QSqlQuery FeedDatabase::boundStatement(const QString &sql, const Bindings &bindings, const char *caller)
+{
+    QSqlQuery q{statement(sql)};
+    for (const auto &binding : bindings) {
+        q.bindValue(binding.first, binding.second);
+    }
+    if (!q.exec()) {
+        qWarning() << "SQL Error in" << caller << q.lastError().text();
+    }
+    return q;
+}
+
+#ifdef SQLITE3_FOUND
+NativeStatement *FeedDatabase::nativeStatement(const QString &sql, const Bindings &bindings)
+{
+    if (m_native == nullptr) {
+        return nullptr;
+    }
+    auto it = m_nativeStatements.find(sql);
+    if (it == m_nativeStatements.end()) {
+        auto prepared = std::make_shared<NativeStatement>(m_native, sql);
+        if (!prepared->isValid()) {
+            return nullptr;
+        }
+        evictLeastRecentlyUsed(m_nativeStatements);
+        it = m_nativeStatements.insert(sql, {prepared, 0});
+    }
+    it->lastUsed = ++m_statementUses;
+    NativeStatement *q{it->statement.get()};
+    q->reset();
+    for (const auto &binding : bindings) {
+        const QVariant &value{binding.second};
+        switch (static_cast<QMetaType::Type>(value.userType())) {
+        case QMetaType::Double:
+            q->bind(binding.first, value.toDouble());
+            break;
+        case QMetaType::QString:
+            q->bind(binding.first, value.toString());
+            break;
+        default:
+            q->bind(binding.first, value.toLongLong());
+        }
+    }
+    return q;
+}
+
+// the columns of ItemQuery::statement and FeedQuery::statement
+static ItemRow nativeItemRow(const NativeStatement &q)
+{
+    return {q.int64(0),
+            q.int64(1),
+            q.text(2),
+            q.text(3),
+            q.text(4),
+            QDateTime::fromSecsSinceEpoch(q.int64(5)),
+            QUrl(q.text(6)),
+            q.int64(7) != 0,
+            q.int64(8) != 0};
+}
+
+static FeedRow nativeFeedRow(const NativeStatement &q)
+{
+    return {q.int64(0),
+            q.text(1),
+            q.text(2),
+            QUrl(q.text(3)),
+            QUrl(q.text(4)),
+            QUrl(q.text(5)),
+            static_cast<int>(q.int64(6)),
+            q.int64(7),
+            QDateTime::fromSecsSinceEpoch(q.int64(8)),
+            q.int64(9),
+            q.text(10),
+            q.text(11),
+            cacheExpiry(q.int64(12)),
+            static_cast<int>(q.int64(13))};
+}
+
+// read every row, then reset the statement so that it does not hold the read transaction open
+template<typename Row>
+static QVector<Row> nativeRows(NativeStatement *q, Row (*decode)(const NativeStatement &))
+{
+    QVector<Row> rows;
+    while (q->step()) {
+        rows.append(decode(*q));
+    }
+    q->reset();
+    return rows;
+}
+#else
+NativeStatement *FeedDatabase::nativeStatement(const QString & /*sql*/, const Bindings & /*bindings*/)
+{
+    return nullptr;
+}
+#endif
+
+QVector<ItemRow> FeedDatabase::readItems(const QString &sql, const Bindings &bindings, const char *caller)
+{
+#ifdef SQLITE3_FOUND
+    if (auto *q = nativeStatement(sql, bindings)) {
+        return nativeRows(q, nativeItemRow);
+    }
+#endif
+    ItemQuery q{boundStatement(sql, bindings, caller)};
+    return q.rows();
+}
+
+QVector<FeedRow> FeedDatabase::readFeeds(const QString &sql, const Bindings &bindings, const char *caller)
+{
+#ifdef SQLITE3_FOUND
+    if (auto *q = nativeStatement(sql, bindings)) {
+        return nativeRows(q, nativeFeedRow);
+    }
+#endif
+    FeedQuery q{boundStatement(sql, bindings, caller)};
+    return q.rows();
+}
+
+static QVector<QPair<const char *, QVariant>> pageBindings(const ItemCursor &after, int limit)
+{
+    return {{":date", after.date}, {":id", after.id}, {":limit", limit}};
+}
+
+QVector<ItemRow> FeedDatabase::allItemRows(const ItemCursor &after, int limit)
+{
+    return readItems(select_all_items, pageBindings(after, limit), "allItemRows");
+}
+
+QVector<ItemRow> FeedDatabase::unreadItemRows(const ItemCursor &after, int limit)
+{
+    return readItems(select_unread_items, pageBindings(after, limit), "unreadItemRows");
+}
+
+QVector<ItemRow> FeedDatabase::starredItemRows(const ItemCursor &after, int limit)
+{
+    return readItems(select_starred_items, pageBindings(after, limit), "starredItemRows");
+}
+
+QVector<ItemRow> FeedDatabase::feedItemRows(qint64 feedId, const ItemCursor &after, int limit)
+{
+    Bindings bindings{pageBindings(after, limit)};
+    bindings.append({":feed", feedId});
+    return readItems(select_items_by_feed, bindings, "feedItemRows");
+}
+
+QVector<ItemRow> FeedDatabase::unreadFeedItemRows(qint64 feedId, const ItemCursor &after, int limit)
+{
+    Bindings bindings{pageBindings(after, limit)};
+    bindings.append({":feed", feedId});
+    return readItems(select_unread_items_by_feed, bindings, "unreadFeedItemRows");
+}
+
+QVector<ItemRow> FeedDatabase::itemRows(qint64 id)
+{
+    return readItems(select_item_by_id, {{":id", id}}, "itemRows");
+}
 
-ItemQuery FeedDatabase::selectAllItems()
+ItemQuery FeedDatabase::selectAllItems(const ItemCursor &after, int limit)
 {
-    ItemQuery q(db(), "1 " + select_sort);
+    ItemQuery q{statement(select_all_items)};
+    bindPage(q, after, limit);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectAllItems: " + q.lastError().text();
     }
     return q;
 }
 
-ItemQuery FeedDatabase::selectUnreadItems()
+ItemQuery FeedDatabase::selectUnreadItems(const ItemCursor &after, int limit)
 {
-    ItemQuery q(db(), "isRead=0 " + select_sort);
+    ItemQuery q{statement(select_unread_items)};
+    bindPage(q, after, limit);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectUnreadItems: " + q.lastError().text();
     }
     return q;
 }
 
-ItemQuery FeedDatabase::selectStarredItems()
+ItemQuery FeedDatabase::selectStarredItems(const ItemCursor &after, int limit)
 {
-    ItemQuery q(db(), "isStarred=1 " + select_sort);
+    ItemQuery q{statement(select_starred_items)};
+    bindPage(q, after, limit);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectStarredItems: " + q.lastError().text();
     }
     return q;
 }
 
-ItemQuery FeedDatabase::selectItemsByFeed(qint64 feedId)
+ItemQuery FeedDatabase::selectItemsByFeed(qint64 feedId, const ItemCursor &after, int limit)
 {
-    ItemQuery q(db(), "feed=:feed " + select_sort);
+    ItemQuery q{statement(select_items_by_feed)};
     q.bindValue(":feed", feedId);
+    bindPage(q, after, limit);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectItemsByFeed: " + q.lastError().text();
     }
     return q;
 }
 
-ItemQuery FeedDatabase::selectUnreadItemsByFeed(qint64 feedId)
+ItemQuery FeedDatabase::selectUnreadItemsByFeed(qint64 feedId, const ItemCursor &after, int limit)
 {
-    ItemQuery q(db(), "feed=:feed AND isRead=0 " + select_sort);
+    ItemQuery q{statement(select_unread_items_by_feed)};
     q.bindValue(":feed", feedId);
+    bindPage(q, after, limit);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectUnreadItemsByFeed: " + q.lastError().text();
     }
@@ -158,7 +747,7 @@ ItemQuery FeedDatabase::selectUnreadItemsByFeed(qint64 feedId)
 
 ItemQuery FeedDatabase::selectItem(qint64 id)
 {
-    ItemQuery q(db(), "id=:id");
+    ItemQuery q{statement(select_item_by_id)};
     q.bindValue(":id", id);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectItem: " + q.lastError().text();
@@ -168,7 +757,7 @@ ItemQuery FeedDatabase::selectItem(qint64 id)
 
 ItemQuery FeedDatabase::selectItem(qint64 feed, const QString &localId)
 {
-    ItemQuery q(db(), "feed=:feed AND localId=:localId");
+    ItemQuery q{statement(select_item_by_local_id)};
     q.bindValue(":feed", feed);
     q.bindValue(":localId", localId);
     if (!q.exec()) {
@@ -177,120 +766,238 @@ ItemQuery FeedDatabase::selectItem(qint64 feed, const QString &localId)
     return q;
 }
 
-QString FeedDatabase::selectItemContent(qint64 id)
+ItemQuery FeedDatabase::selectItems(qint64 feedId, const QStringList &localIds)
 {
-    QSqlQuery q(db());
-    q.prepare("SELECT feedContent FROM Item WHERE id=:id LIMIT 1");
+    ItemQuery q{statement(ItemQuery::statement("feed=? AND localId IN (" + placeholderList("?", localIds.size()) + ")"))};
+    q.addBindValue(feedId);
+    for (const auto &localId : localIds) {
+        q.addBindValue(localId);
+    }
+    if (!q.exec()) {
+        qWarning() << "SQL Error in selectItems: " + q.lastError().text();
+    }
+    return q;
+}
+
+StoredContent FeedDatabase::selectItemContent(qint64 id)
+{
+    QSqlQuery q{statement("SELECT codec, content FROM ItemContent WHERE itemId=:id")};
     q.bindValue(":id", id);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectItemContent: " << q.lastError().text();
-        return QString();
+        return {};
     }
     if (!q.next()) {
-        return QString();
+        return {};
     }
-    return q.value(0).toString();
+    const StoredContent content{q.value(0).toInt(), q.value(1)};
+    q.finish();
+    return content;
 }
 
-std::optional<qint64> FeedDatabase::selectItemId(qint64 feedId, const QString &localId)
+// quote every word, so that user input can't be read as FTS5 query syntax, and match it as a prefix
+static QString searchExpression(const QString &query)
 {
-    QSqlQuery q(db());
-    q.prepare(
-        "SELECT id FROM Item "
-        "WHERE feed=:feed AND localId=:localId;");
-    q.bindValue(":feed", feedId);
-    q.bindValue(":localId", localId);
+    QStringList terms;
+    const auto &words = query.simplified().split(' ');
+    for (const auto &word : words) {
+        terms << '"' + QString(word).replace('"', QStringLiteral("\"\"")) + "\"*";
+    }
+    return terms.join(' ');
+}
+
+static const QString search_items = ItemQuery::searchStatement(
+    "ItemSearch MATCH :query AND (ItemSearch.rank, Item.id) > (:rank, :id) "
+    "ORDER BY ItemSearch.rank, Item.id LIMIT :limit");
+
+ItemQuery FeedDatabase::searchItems(const QString &query, const SearchCursor &after, int limit)
+{
+    ItemQuery q{statement(search_items)};
+    q.bindValue(":query", searchExpression(query));
+    q.bindValue(":rank", after.rank);
+    q.bindValue(":id", after.id);
+    q.bindValue(":limit", limit);
     if (!q.exec()) {
-        qWarning() << "SQL Error in selectItemId: " + q.lastError().text();
+        qWarning() << "SQL Error in searchItems: " + q.lastError().text();
+    }
+    return q;
+}
+
+QVector<ItemRow> FeedDatabase::searchItemRows(const QString &query, const SearchCursor &after, int limit)
+{
+    return readItems(search_items, {{":query", searchExpression(query)}, {":rank", after.rank}, {":id", after.id}, {":limit", limit}}, "searchItemRows");
+}
+
+std::optional<SearchCursor> FeedDatabase::selectSearchCursor(const QString &query, qint64 id)
+{
+    QSqlQuery q{statement("SELECT rank FROM ItemSearch WHERE ItemSearch MATCH :query AND rowid=:id")};
+    q.bindValue(":query", searchExpression(query));
+    q.bindValue(":id", id);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in selectSearchCursor: " << q.lastError().text();
         return std::nullopt;
     }
     if (!q.next()) {
         return std::nullopt;
     }
-    return q.value(0).toLongLong();
+    const SearchCursor cursor{q.value(0).toDouble(), id};
+    q.finish();
+    return cursor;
 }
 
-std::optional<qint64> FeedDatabase::insertItem(qint64 feedId,
-                                               const QString &localId,
-                                               const QString &title,
-                                               const QString &author,
-                                               time_t date,
-                                               const QUrl &url,
-                                               const QString &content)
+// 64-bit FNV-1a
+static constexpr quint64 fnvOffsetBasis{14695981039346656037ULL};
+static constexpr quint64 fnvPrime{1099511628211ULL};
+
+static void hashBytes(quint64 &hash, const char *data, size_t size)
 {
-    QSqlQuery q(db());
-    q.prepare(
-        "INSERT INTO Item (id, feed, localId, headline, author, date, url, feedContent, isRead, isStarred) "
-        "VALUES (:id, :feed, :localId, :headline, :author, :date, :url, :feedContent, :isRead, :isStarred);");
-    q.bindValue(":feed", feedId);
-    q.bindValue(":localId", localId);
-    q.bindValue(":headline", title);
-    q.bindValue(":author", author);
-    q.bindValue(":date", qint64(date));
-    q.bindValue(":url", url.toString());
-    q.bindValue(":feedContent", content);
-    q.bindValue(":isRead", false);
-    q.bindValue(":isStarred", false);
-    if (!q.exec()) {
-        qWarning() << "SQL Error in insertItem: " + q.lastError().text();
-        return std::nullopt;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= fnvPrime;
     }
-    return q.lastInsertId().toLongLong();
 }
 
-void FeedDatabase::updateItemHeaders(qint64 id, const QString &title, const QString &author, const QUrl &url)
+static void hashString(quint64 &hash, const QString &value)
 {
-    QSqlQuery q(db());
-    q.prepare(
-        "UPDATE Item SET "
-        "headline=:headline,"
-        "author=:author,"
-        "url=:url "
-        "WHERE id=:id;");
-    q.bindValue(":headline", title);
-    q.bindValue(":author", author);
-    q.bindValue(":url", url.toString());
-    q.bindValue(":id", id);
+    hashBytes(hash, reinterpret_cast<const char *>(value.constData()), value.size() * sizeof(QChar));
+    // terminate each field, so that moving text from one field to the next changes the hash
+    hashBytes(hash, "\0\0", 2);
+}
+
+qint64 FeedDatabase::fingerprint(const ItemRecord &item)
+{
+    quint64 hash{fnvOffsetBasis};
+    hashString(hash, item.title);
+    hashString(hash, item.author);
+    hashString(hash, item.url.toString());
+    const qint64 date{item.date};
+    hashBytes(hash, reinterpret_cast<const char *>(&date), sizeof(date));
+    hashString(hash, item.content);
+    return static_cast<qint64>(hash);
+}
+
+QHash<QString, qint64> FeedDatabase::selectItemFingerprints(qint64 feedId, const QStringList &localIds)
+{
+    QSqlQuery q{statement("SELECT localId, fingerprint FROM Item WHERE fingerprint IS NOT NULL AND feed=? AND localId IN ("
+                          + placeholderList("?", localIds.size()) + ")")};
+    q.addBindValue(feedId);
+    for (const auto &localId : localIds) {
+        q.addBindValue(localId);
+    }
     if (!q.exec()) {
-        qWarning() << "SQL Error in updateItemHeaders: " + q.lastError().text();
+        qWarning() << "SQL Error in selectItemFingerprints: " << q.lastError().text();
+        return {};
     }
+    QHash<QString, qint64> fingerprints;
+    while (q.next()) {
+        fingerprints.insert(q.value(0).toString(), q.value(1).toLongLong());
+    }
+    return fingerprints;
 }
 
-void FeedDatabase::updateItemDate(qint64 id, time_t date)
+qint64 FeedDatabase::selectMaxItemId()
 {
-    QSqlQuery q(db());
-    q.prepare(
-        "UPDATE Item SET "
-        "date=:date "
-        "WHERE id=:id;");
-    q.bindValue(":date", qint64(date));
-    q.bindValue(":id", id);
+    QSqlQuery q{statement("SELECT MAX(id) FROM Item")};
     if (!q.exec()) {
-        qWarning() << "SQL Error in updateItemDate: " + q.lastError().text();
+        qWarning() << "SQL Error in selectMaxItemId: " << q.lastError().text();
+        return 0;
+    }
+    if (!q.next()) {
+        return 0;
     }
+    const qint64 maxId{q.value(0).toLongLong()};
+    q.finish();
+    return maxId;
 }
 
-void FeedDatabase::updateItemContent(qint64 id, const QString &content)
+bool FeedDatabase::upsertItems(qint64 feedId, const QVector<ItemRecord> &items)
 {
-    QSqlQuery q(db());
-    q.prepare(
-        "UPDATE Item SET "
-        "feedContent=:feedContent "
-        "WHERE id=:id;");
-    q.bindValue(":feedContent", content);
-    q.bindValue(":id", id);
+    if (items.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery q{statement(
+        "INSERT INTO Item (feed, localId, headline, author, date, url, fingerprint, isRead, isStarred) "
+        "VALUES "
+        + placeholderList("(?,?,?,?,?,?,?,0,0)", items.size())
+        + " ON CONFLICT(feed, localId) DO UPDATE SET "
+          "headline=excluded.headline,"
+          "author=excluded.author,"
+          "url=excluded.url,"
+          "date=COALESCE(excluded.date, date),"
+          "fingerprint=excluded.fingerprint;")};
+    QVector<QPair<QString, StoredContent>> contents;
+    QVector<QPair<QString, QString>> searchText;
+    for (const auto &item : items) {
+        q.addBindValue(feedId);
+        q.addBindValue(item.localId);
+        q.addBindValue(item.title);
+        q.addBindValue(item.author);
+        q.addBindValue(item.date > 0 ? QVariant(qint64(item.date)) : QVariant(QVariant::LongLong));
+        q.addBindValue(item.url.toString());
+        q.addBindValue(fingerprint(item));
+        // updates without content keep the stored content
+        if (!item.content.isEmpty()) {
+            contents.append({item.localId, compressContent(item.content)});
+            searchText.append({item.localId, searchableText(item.content)});
+        }
+    }
     if (!q.exec()) {
-        qWarning() << "SQL Error in updateItemContent: " + q.lastError().text();
+        qWarning() << "SQL Error in upsertItems: " + q.lastError().text();
+        return false;
     }
+
+    if (!contents.isEmpty()) {
+        QSqlQuery contentQuery{statement(
+            "INSERT INTO ItemContent (itemId, codec, content) "
+            "SELECT Item.id, content.column2, content.column3 FROM (VALUES "
+            + placeholderList("(?,?,?)", contents.size())
+            + ") AS content JOIN Item ON Item.localId=content.column1 WHERE Item.feed=? "
+              "ON CONFLICT(itemId) DO UPDATE SET "
+              "codec=excluded.codec,"
+              "content=excluded.content;")};
+        for (const auto &content : qAsConst(contents)) {
+            contentQuery.addBindValue(content.first);
+            contentQuery.addBindValue(content.second.codec);
+            contentQuery.addBindValue(content.second.data);
+        }
+        contentQuery.addBindValue(feedId);
+        if (!contentQuery.exec()) {
+            qWarning() << "SQL Error in upsertItems: " + contentQuery.lastError().text();
+            return false;
+        }
+
+        QSqlQuery searchQuery{statement(
+            "UPDATE ItemSearch SET content=search.column2 FROM (VALUES "
+            + placeholderList("(?,?)", searchText.size())
+            + ") AS search JOIN Item ON Item.localId=search.column1 WHERE Item.feed=? AND ItemSearch.rowid=Item.id;")};
+        for (const auto &text : qAsConst(searchText)) {
+            searchQuery.addBindValue(text.first);
+            searchQuery.addBindValue(text.second);
+        }
+        searchQuery.addBindValue(feedId);
+        if (!searchQuery.exec()) {
+            qWarning() << "SQL Error in upsertItems: " + searchQuery.lastError().text();
+            return false;
+        }
+    }
+
+    QSqlQuery dateQuery{statement("UPDATE Item SET date=:date WHERE feed=:feed AND date IS NULL")};
+    dateQuery.bindValue(":date", QDateTime::currentSecsSinceEpoch());
+    dateQuery.bindValue(":feed", feedId);
+    if (!dateQuery.exec()) {
+        qWarning() << "SQL Error in upsertItems: " + dateQuery.lastError().text();
+        return false;
+    }
+    return true;
 }
 
 void FeedDatabase::updateItemRead(qint64 id, bool isRead)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Item SET "
         "isRead=:isRead "
-        "WHERE id=:id;");
+        "WHERE id=:id;")};
     q.bindValue(":isRead", isRead);
     q.bindValue(":id", id);
     if (!q.exec()) {
@@ -300,11 +1007,10 @@ void FeedDatabase::updateItemRead(qint64 id, bool isRead)
 
 void FeedDatabase::updateItemStarred(qint64 id, bool isStarred)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Item SET "
         "isStarred=:isStarred "
-        "WHERE id=:id;");
+        "WHERE id=:id;")};
     q.bindValue(":isStarred", isStarred);
     q.bindValue(":id", id);
     if (!q.exec()) {
@@ -312,30 +1018,134 @@ void FeedDatabase::updateItemStarred(qint64 id, bool isStarred)
     }
 }
 
+// list the items that an update is about to change, then run it
+static std::optional<QVector<ItemFlagChange>> selectAndUpdate(QSqlQuery &select, QSqlQuery &update, const char *caller)
+{
+    if (!select.exec()) {
+        qWarning() << "SQL Error in" << caller << select.lastError().text();
+        return std::nullopt;
+    }
+    QVector<ItemFlagChange> changed;
+    while (select.next()) {
+        changed.append({select.value(0).toLongLong(), select.value(1).toLongLong()});
+    }
+    if (!update.exec()) {
+        qWarning() << "SQL Error in" << caller << update.lastError().text();
+        return std::nullopt;
+    }
+    return changed;
+}
+
+static void bindFlagAndIds(QSqlQuery &q, const QVariant &value, const QVector<qint64> &ids)
+{
+    q.addBindValue(value);
+    for (const qint64 id : ids) {
+        q.addBindValue(id);
+    }
+}
+
+std::optional<QVector<ItemFlagChange>> FeedDatabase::updateItemsRead(const QVector<qint64> &ids, bool isRead)
+{
+    const QString &where{"isRead IS NOT ? AND id IN (" + placeholderList("?", ids.size()) + ")"};
+    QSqlQuery select{statement("SELECT id, feed FROM Item WHERE " + where)};
+    QSqlQuery update{statement("UPDATE Item SET isRead=? WHERE " + where)};
+    bindFlagAndIds(select, isRead, ids);
+    update.addBindValue(isRead);
+    bindFlagAndIds(update, isRead, ids);
+    return selectAndUpdate(select, update, "updateItemsRead");
+}
+
+std::optional<QVector<ItemFlagChange>> FeedDatabase::updateItemsStarred(const QVector<qint64> &ids, bool isStarred)
+{
+    const QString &where{"isStarred IS NOT ? AND id IN (" + placeholderList("?", ids.size()) + ")"};
+    QSqlQuery select{statement("SELECT id, feed FROM Item WHERE " + where)};
+    QSqlQuery update{statement("UPDATE Item SET isStarred=? WHERE " + where)};
+    bindFlagAndIds(select, isStarred, ids);
+    update.addBindValue(isStarred);
+    bindFlagAndIds(update, isStarred, ids);
+    return selectAndUpdate(select, update, "updateItemsStarred");
+}
+
+std::optional<QVector<ItemFlagChange>> FeedDatabase::updateFeedItemsRead(qint64 feedId, qint64 upTo)
+{
+    QSqlQuery select{statement("SELECT id, feed FROM Item WHERE feed=:feed AND isRead=0 AND date<=:upTo")};
+    QSqlQuery update{statement("UPDATE Item SET isRead=1 WHERE feed=:feed AND isRead=0 AND date<=:upTo")};
+    for (auto *q : {&select, &update}) {
+        q->bindValue(":feed", feedId);
+        q->bindValue(":upTo", upTo);
+    }
+    return selectAndUpdate(select, update, "updateFeedItemsRead");
+}
+
+std::optional<QVector<ItemFlagChange>> FeedDatabase::updateAllItemsRead(qint64 upTo)
+{
+    QSqlQuery select{statement("SELECT id, feed FROM Item WHERE isRead=0 AND date<=:upTo")};
+    QSqlQuery update{statement("UPDATE Item SET isRead=1 WHERE isRead=0 AND date<=:upTo")};
+    for (auto *q : {&select, &update}) {
+        q->bindValue(":upTo", upTo);
+    }
+    return selectAndUpdate(select, update, "updateAllItemsRead");
+}
+
 void FeedDatabase::deleteItemsForFeed(qint64 feedId)
 {
-    QSqlQuery q(db());
-    q.prepare("DELETE FROM Item WHERE feed=:feed");
+    QSqlQuery q{statement("DELETE FROM Item WHERE feed=:feed")};
     q.bindValue(":feed", feedId);
     if (!q.exec()) {
         qWarning() << "SQL Error in deleteItemsForFeed: " << q.lastError().text();
     }
 }
 
-void FeedDatabase::deleteItemsOlderThan(qint64 feedId, const QDateTime &olderThan)
+// the stored expireAge is 0 to inherit the default, negative to disable expiry, or an override
+static const QString select_expired_items = QStringLiteral(
+    "WITH FeedExpiry AS (SELECT id AS feed, "
+    "CASE WHEN expireAge>0 THEN expireAge WHEN expireAge<0 THEN 0 ELSE :defaultExpireAge END AS age FROM Feed) "
+    "SELECT Item.id, Item.feed, Item.isRead FROM FeedExpiry "
+    "JOIN Item ON Item.feed=FeedExpiry.feed AND Item.date<:now-FeedExpiry.age "
+    "WHERE FeedExpiry.age>0 AND Item.isStarred IS NOT 1 "
+    "LIMIT :limit");
+
+std::optional<ExpiredItems> FeedDatabase::deleteExpiredItems(const QDateTime &now, qint64 defaultExpireAge, int limit)
 {
-    QSqlQuery q(db());
-    q.prepare("DELETE FROM Item WHERE feed=:feed AND isStarred!=1 AND date<:olderThan");
-    q.bindValue(":feed", feedId);
-    q.bindValue(":olderThan", olderThan.toSecsSinceEpoch());
-    if (!q.exec()) {
-        qWarning() << "SQL Error in deleteItemsForFeed: " << q.lastError().text();
+    QSqlQuery select{statement(select_expired_items)};
+    select.bindValue(":defaultExpireAge", defaultExpireAge);
+    select.bindValue(":now", now.toSecsSinceEpoch());
+    select.bindValue(":limit", limit);
+    if (!select.exec()) {
+        qWarning() << "SQL Error in deleteExpiredItems: " << select.lastError().text();
+        return std::nullopt;
+    }
+    ExpiredItems expired;
+    QVector<qint64> ids;
+    while (select.next()) {
+        ids.append(select.value(0).toLongLong());
+        if (!select.value(2).toBool()) {
+            ++expired.unreadByFeed[select.value(1).toLongLong()];
+        }
+    }
+    select.finish();
+
+    for (int i = 0; i < ids.size(); i += maxBatchSize) {
+        const QVector<qint64> &batch{ids.mid(i, maxBatchSize)};
+        QSqlQuery q{statement("DELETE FROM Item WHERE id IN (" + placeholderList("?", batch.size()) + ")")};
+        for (const qint64 id : batch) {
+            q.addBindValue(id);
+        }
+        if (!q.exec()) {
+            qWarning() << "SQL Error in deleteExpiredItems: " << q.lastError().text();
+            return std::nullopt;
+        }
+        expired.deleted += q.numRowsAffected();
     }
+    return expired;
 }
 
+static const QString select_all_feeds = FeedQuery::statement("1");
+static const QString select_feed_by_id = FeedQuery::statement("Feed.id=:id");
+
 FeedQuery FeedDatabase::selectAllFeeds()
 {
-    FeedQuery q(db(), "1");
+    FeedQuery q{statement(select_all_feeds)};
     if (!q.exec()) {
         qWarning() << "SQL Error: " + q.lastError().text();
     }
@@ -344,7 +1154,7 @@ FeedQuery FeedDatabase::selectAllFeeds()
 
 FeedQuery FeedDatabase::selectFeed(qint64 feedId)
 {
-    FeedQuery q(db(), "Feed.id=:id");
+    FeedQuery q{statement(select_feed_by_id)};
     q.bindValue(":id", feedId);
     if (!q.exec()) {
         qWarning() << "SQL Error in selectFeed: " + q.lastError().text();
@@ -352,14 +1162,73 @@ FeedQuery FeedDatabase::selectFeed(qint64 feedId)
     return q;
 }
 
+QVector<FeedRow> FeedDatabase::allFeedRows()
+{
+    auto rows = readFeeds(select_all_feeds, {}, "allFeedRows");
+    const auto &intervals = selectPostingIntervals(QDateTime::currentSecsSinceEpoch());
+    for (auto &row : rows) {
+        row.postingInterval = intervals.value(row.id, postingWindow);
+    }
+    return rows;
+}
+
+QVector<FeedRow> FeedDatabase::feedRows(qint64 feedId)
+{
+    auto rows = readFeeds(select_feed_by_id, {{":id", feedId}}, "feedRows");
+    for (auto &row : rows) {
+        row.postingInterval = selectPostingInterval(row.id, QDateTime::currentSecsSinceEpoch());
+    }
+    return rows;
+}
+
+static qint64 postingInterval(qint64 count, qint64 oldest, qint64 now)
+{
+    if (count == 0) {
+        return FeedDatabase::postingWindow;
+    }
+    // measured up to now rather than to the newest item, so that a feed that has gone quiet slows down
+    return std::max<qint64>((now - oldest) / count, 1);
+}
+
+qint64 FeedDatabase::selectPostingInterval(qint64 feedId, qint64 now)
+{
+    QSqlQuery q{statement("SELECT COUNT(*), MIN(date) FROM Item WHERE feed=:feed AND date>:since")};
+    q.bindValue(":feed", feedId);
+    q.bindValue(":since", now - postingWindow);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in selectPostingInterval: " << q.lastError().text();
+        return 0;
+    }
+    if (!q.next()) {
+        return 0;
+    }
+    const qint64 interval{postingInterval(q.value(0).toLongLong(), q.value(1).toLongLong(), now)};
+    q.finish();
+    return interval;
+}
+
+QHash<qint64, qint64> FeedDatabase::selectPostingIntervals(qint64 now)
+{
+    QHash<qint64, qint64> result;
+    QSqlQuery q{statement("SELECT feed, COUNT(*), MIN(date) FROM Item WHERE date>:since GROUP BY feed")};
+    q.bindValue(":since", now - postingWindow);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in selectPostingIntervals: " << q.lastError().text();
+        return result;
+    }
+    while (q.next()) {
+        result.insert(q.value(0).toLongLong(), postingInterval(q.value(1).toLongLong(), q.value(2).toLongLong(), now));
+    }
+    return result;
+}
+
 std::optional<qint64> FeedDatabase::insertFeed(const QUrl &url)
 {
-    QSqlQuery q(db());
+    QSqlQuery q{statement(
+        "INSERT INTO Feed (displayName, url) "
+        "VALUES (:displayName, :url);")};
     const QString &urlString = url.toString();
     const QString &urlHost = url.host();
-    q.prepare(
-        "INSERT INTO Feed (displayName, url) "
-        "VALUES (:displayName, :url);");
     q.bindValue(":displayName", urlHost);
     q.bindValue(":url", urlString);
     if (!q.exec()) {
@@ -371,11 +1240,10 @@ std::optional<qint64> FeedDatabase::insertFeed(const QUrl &url)
 
 void FeedDatabase::updateFeedName(qint64 feedId, const QString &newName)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "displayName=:displayName "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":displayName", newName);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -385,12 +1253,11 @@ void FeedDatabase::updateFeedName(qint64 feedId, const QString &newName)
 
 void FeedDatabase::updateFeedUrl(qint64 feedId, const QUrl &url)
 {
-    QSqlQuery q(db());
-    const QString &urlString = url.toString();
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "url=:url "
-        "WHERE id=:id");
+        "WHERE id=:id")};
+    const QString &urlString = url.toString();
     q.bindValue(":url", urlString);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -400,11 +1267,10 @@ void FeedDatabase::updateFeedUrl(qint64 feedId, const QUrl &url)
 
 void FeedDatabase::updateFeedCategory(qint64 feedId, const QString &category)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "category=:category "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":category", category);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -414,11 +1280,10 @@ void FeedDatabase::updateFeedCategory(qint64 feedId, const QString &category)
 
 void FeedDatabase::updateFeedLink(qint64 feedId, const QString &link)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "link=:link "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":link", link);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -428,11 +1293,10 @@ void FeedDatabase::updateFeedLink(qint64 feedId, const QString &link)
 
 void FeedDatabase::updateFeedIcon(qint64 feedId, const QString &icon)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "icon=:icon "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":icon", icon);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -442,11 +1306,10 @@ void FeedDatabase::updateFeedIcon(qint64 feedId, const QString &icon)
 
 void FeedDatabase::updateFeedUpdateInterval(qint64 feedId, qint64 updateInterval)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "updateInterval=:updateInterval "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":updateInterval", updateInterval);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -456,11 +1319,10 @@ void FeedDatabase::updateFeedUpdateInterval(qint64 feedId, qint64 updateInterval
 
 void FeedDatabase::updateFeedLastUpdate(qint64 feedId, const QDateTime &lastUpdate)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "lastUpdate=:lastUpdate "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     if (lastUpdate.isValid()) {
         q.bindValue(":lastUpdate", lastUpdate.toSecsSinceEpoch());
     } else {
@@ -472,13 +1334,61 @@ void FeedDatabase::updateFeedLastUpdate(qint64 feedId, const QDateTime &lastUpda
     }
 }
 
+void FeedDatabase::updateFeedHttpCache(qint64 feedId, const QString &etag, const QString &lastModified, const QDateTime &expires)
+{
+    QSqlQuery q{statement(
+        "UPDATE Feed SET "
+        "etag=:etag, lastModified=:lastModified, cacheExpires=:cacheExpires "
+        "WHERE id=:id")};
+    q.bindValue(":etag", etag.isEmpty() ? QVariant(QVariant::String) : etag);
+    q.bindValue(":lastModified", lastModified.isEmpty() ? QVariant(QVariant::String) : lastModified);
+    if (expires.isValid()) {
+        q.bindValue(":cacheExpires", expires.toSecsSinceEpoch());
+    } else {
+        q.bindValue(":cacheExpires", QVariant(QVariant::LongLong));
+    }
+    q.bindValue(":id", feedId);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in updateFeedHttpCache: " << q.lastError().text();
+    }
+}
+
+void FeedDatabase::updateFeedFailureCount(qint64 feedId, int failureCount)
+{
+    QSqlQuery q{statement(
+        "UPDATE Feed SET "
+        "failureCount=:failureCount "
+        "WHERE id=:id")};
+    q.bindValue(":failureCount", failureCount);
+    q.bindValue(":id", feedId);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in updateFeedFailureCount: " << q.lastError().text();
+    }
+}
+
+void FeedDatabase::updateFeedLastFailure(qint64 feedId, const QDateTime &lastFailure)
+{
+    QSqlQuery q{statement(
+        "UPDATE Feed SET "
+        "lastFailure=:lastFailure "
+        "WHERE id=:id")};
+    if (lastFailure.isValid()) {
+        q.bindValue(":lastFailure", lastFailure.toSecsSinceEpoch());
+    } else {
+        q.bindValue(":lastFailure", QVariant(QVariant::LongLong));
+    }
+    q.bindValue(":id", feedId);
+    if (!q.exec()) {
+        qWarning() << "SQL Error in updateFeedLastFailure: " << q.lastError().text();
+    }
+}
+
 void FeedDatabase::updateFeedExpireAge(qint64 feedId, qint64 expireAge)
 {
-    QSqlQuery q(db());
-    q.prepare(
+    QSqlQuery q{statement(
         "UPDATE Feed SET "
         "expireAge=:expireAge "
-        "WHERE id=:id");
+        "WHERE id=:id")};
     q.bindValue(":expireAge", expireAge);
     q.bindValue(":id", feedId);
     if (!q.exec()) {
@@ -488,12 +1398,124 @@ void FeedDatabase::updateFeedExpireAge(qint64 feedId, qint64 expireAge)
 
 void FeedDatabase::deleteFeed(qint64 feedId)
 {
-    QSqlQuery q(db());
-    q.prepare("DELETE FROM Feed WHERE id=:id");
+    QSqlQuery q{statement("DELETE FROM Feed WHERE id=:id")};
     q.bindValue(":id", feedId);
     if (!q.exec()) {
         qWarning() << "SQL Error in deleteFeed: " << q.lastError().text();
     }
 }
 
+bool FeedDatabase::checkUnreadCounts()
+{
+    QSqlQuery q{statement(
+        "SELECT "
+        "(SELECT COUNT(*) FROM Feed LEFT JOIN FeedUnreadCount ON FeedUnreadCount.feed=Feed.id "
+        "WHERE FeedUnreadCount.unreadCount IS NOT (SELECT COUNT(*) FROM Item WHERE Item.feed=Feed.id AND Item.isRead=0)) + "
+        "(SELECT COUNT(*) FROM FeedUnreadCount WHERE feed NOT IN (SELECT id FROM Feed))")};
+    if (!q.exec()) {
+        qWarning() << "SQL Error in checkUnreadCounts: " << q.lastError().text();
+        return false;
+    }
+    if (!q.next()) {
+        return false;
+    }
+    const int mismatches{q.value(0).toInt()};
+    q.finish();
+    if (mismatches > 0) {
+        qWarning() << "Found" << mismatches << "inconsistent unread counters";
+        return false;
+    }
+    return true;
+}
+
+bool FeedDatabase::rebuildUnreadCounts()
+{
+    if (!transaction()) {
+        return false;
+    }
+    QSqlQuery clear{statement("DELETE FROM FeedUnreadCount")};
+    QSqlQuery populate{statement(
+        "INSERT INTO FeedUnreadCount (feed, unreadCount) "
+        "SELECT Feed.id, (SELECT COUNT(*) FROM Item WHERE Item.feed=Feed.id AND Item.isRead=0) FROM Feed")};
+    if (!clear.exec() || !populate.exec()) {
+        qWarning() << "SQL Error in rebuildUnreadCounts: " << clear.lastError().text() << populate.lastError().text();
+        rollback();
+        return false;
+    }
+    return commit();
+}
+
+qint64 FeedDatabase::freePageCount()
+{
+    QSqlQuery q{statement("PRAGMA freelist_count")};
+    if (!q.exec() || !q.next()) {
+        qWarning() << "SQL Error in freePageCount: " << q.lastError().text();
+        return 0;
+    }
+    const qint64 count{q.value(0).toLongLong()};
+    q.finish();
+    return count;
+}
+
+bool FeedDatabase::incrementalVacuum(int pages)
+{
+    // every step of the pragma frees one page, but QSQLITE only takes the first step of a
+    // statement that has no result columns, so free the pages one statement at a time
+    const qint64 steps{qMin<qint64>(pages, freePageCount())};
+    if (steps <= 0) {
+        return true;
+    }
+    if (!transaction()) {
+        return false;
+    }
+    QSqlQuery q{statement("PRAGMA incremental_vacuum(1)")};
+    for (qint64 i = 0; i < steps; ++i) {
+        if (!q.exec()) {
+            qWarning() << "SQL Error in incrementalVacuum: " << q.lastError().text();
+            rollback();
+            return false;
+        }
+    }
+    q.finish();
+    return commit();
+}
+
+bool FeedDatabase::optimize()
+{
+    QSqlQuery q(db());
+    if (!q.exec("PRAGMA optimize")) {
+        qWarning() << "SQL Error in optimize: " << q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool FeedDatabase::transaction()
+{
+    auto database = db();
+    if (!database.transaction()) {
+        qWarning() << "SQL Error in transaction: " << database.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool FeedDatabase::commit()
+{
+    auto database = db();
+    if (!database.commit()) {
+        qWarning() << "SQL Error in commit: " << database.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void FeedDatabase::rollback()
+{
+    auto database = db();
+    if (!database.rollback()) {
+        qWarning() << "SQL Error in rollback: " << database.lastError().text();
+    }
+}
+
 }
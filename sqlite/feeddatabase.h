@@ -6,39 +6,261 @@
 #ifndef SQLITE_FEEDDATABASE_H
 #define SQLITE_FEEDDATABASE_H
 #include "sqlite/feedquery.h"
+#include "sqlite/itemcontent.h"
 #include "sqlite/itemquery.h"
 #include <QDateTime>
+#include <QHash>
 #include <QSqlQuery>
+#include <QStringList>
 #include <QUrl>
+#include <QVector>
+#include <limits>
+#include <memory>
 #include <optional>
 
+struct sqlite3;
+
 namespace SqliteStorage
 {
+class NativeStatement;
+
+/**
+ * The stored fields of an article, as received from the remote source.
+ */
+struct ItemRecord {
+    QString localId;
+    QString title;
+    QString author;
+    QUrl url;
+    time_t date{0}; /** < 0 if the source does not provide a date */
+    QString content; /** < empty if the source does not provide content */
+};
+
+/**
+ * A position in a date-ordered list of items.
+ *
+ * Paged queries return the items that sort after the cursor, newest first.  The default
+ * cursor sorts before every item, so it selects the first page.
+ */
+struct ItemCursor {
+    qint64 date{std::numeric_limits<qint64>::max()};
+    qint64 id{std::numeric_limits<qint64>::max()};
+};
+
+/**
+ * A position in a ranked list of search results.
+ *
+ * Search pages return the items that rank after the cursor, best match first.  The default
+ * cursor ranks before every item.
+ */
+struct SearchCursor {
+    double rank{std::numeric_limits<double>::lowest()};
+    qint64 id{0};
+};
+
+/**
+ * An item whose flag was changed by a bulk update.
+ */
+struct ItemFlagChange {
+    qint64 id{0};
+    qint64 feed{0};
+};
+
+/**
+ * The result of one step of FeedDatabase::deleteExpiredItems.
+ */
+struct ExpiredItems {
+    int deleted{0};
+    QHash<qint64, int> unreadByFeed; /** < the number of unread items deleted from each feed */
+};
+
+/**
+ * Connection parameters for FeedDatabase.
+ */
+struct DatabaseOptions {
+    /**
+     * Use write-ahead logging.  In WAL mode, reads are served by separate read-only connections
+     * so that they see a consistent snapshot and are not blocked by a long write.
+     */
+    bool walMode{false};
+    int readConnections{2}; /** < number of read-only connections to open in WAL mode */
+    QString synchronous; /** < PRAGMA synchronous (OFF, NORMAL, FULL or EXTRA); empty for the SQLite default */
+    int cacheSize{0}; /** < PRAGMA cache_size (pages if positive, KiB if negative); 0 for the SQLite default */
+    qint64 mmapSize{0}; /** < PRAGMA mmap_size, in bytes */
+    int busyTimeout{5000}; /** < PRAGMA busy_timeout, in msecs */
+
+    /**
+     * Decode the rows of the item and feed lists through the SQLite C API instead of QtSql.
+     * This is ignored if the application was built without SQLite, or if QtSql uses a
+     * different SQLite library.
+     */
+    bool nativeReads{false};
+};
+
+/**
+ * What opening a database for writing did to it.
+ */
+struct DatabaseUpgrade {
+    int fromVersion{0}; /** < the schema version that was found, or 0 for a new database */
+    qint64 sizeBefore{0}; /** < the size of the database in bytes before the migrations */
+    qint64 sizeAfter{0}; /** < the size after the migrations, and after VACUUM if it ran */
+    bool vacuumed{false}; /** < whether the file was rebuilt to release the space that the migrations freed */
+};
+
 class FeedDatabase
 {
 public:
-    explicit FeedDatabase(const QString &filePath);
+    /**
+     * Counters for the prepared statement cache.
+     */
+    struct StatementCacheStats {
+        qint64 hits{0}; /** < lookups that reused an already-prepared statement */
+        qint64 misses{0}; /** < lookups that had to prepare a new statement */
+        qint64 evictions{0}; /** < statements dropped to keep the cache within maxCachedStatements */
+    };
+
+    enum Mode {
+        ReadWrite, /** < initialize the schema and accept writes */
+        ReadOnly, /** < open an existing database for reading only */
+    };
+
+    /**
+     * The maximum number of items that should be passed to a single call to upsertItems, selectItems,
+     * updateItemsRead or updateItemsStarred.
+     *
+     * This keeps the number of bound parameters below SQLite's default limit of 999.
+     */
+    static constexpr int maxBatchSize{100};
+
+    /**
+     * The number of prepared statements each connection keeps.  Batched statements are
+     * prepared for every batch size they see, so the least recently used are dropped.
+     */
+    static constexpr int maxCachedStatements{64};
+
+    explicit FeedDatabase(const QString &filePath, const DatabaseOptions &options = {}, Mode mode = ReadWrite);
     ~FeedDatabase();
     FeedDatabase(const FeedDatabase &) = delete;
     FeedDatabase &operator=(const FeedDatabase &) = delete;
-    ItemQuery selectAllItems();
-    ItemQuery selectUnreadItems();
-    ItemQuery selectStarredItems();
-    ItemQuery selectItemsByFeed(qint64 feedId);
-    ItemQuery selectUnreadItemsByFeed(qint64 feedId);
+
+    /**
+     * The item lists return at most /limit/ items after /after/, newest first.  A negative
+     * limit returns every remaining item.
+     */
+    ItemQuery selectAllItems(const ItemCursor &after = {}, int limit = -1);
+    ItemQuery selectUnreadItems(const ItemCursor &after = {}, int limit = -1);
+    ItemQuery selectStarredItems(const ItemCursor &after = {}, int limit = -1);
+    ItemQuery selectItemsByFeed(qint64 feedId, const ItemCursor &after = {}, int limit = -1);
+    ItemQuery selectUnreadItemsByFeed(qint64 feedId, const ItemCursor &after = {}, int limit = -1);
     ItemQuery selectItem(qint64 id);
     ItemQuery selectItem(qint64 feed, const QString &localId);
-    QString selectItemContent(qint64 id);
-    std::optional<qint64> selectItemId(qint64 feedId, const QString &localId);
-    std::optional<qint64>
-    insertItem(qint64 feedId, const QString &localId, const QString &title, const QString &author, time_t date, const QUrl &url, const QString &content);
-    void updateItemHeaders(qint64 id, const QString &title, const QString &author, const QUrl &url);
-    void updateItemDate(qint64 id, time_t date);
-    void updateItemContent(qint64 id, const QString &content);
+    ItemQuery selectItems(qint64 feedId, const QStringList &localIds);
+
+    /**
+     * The item and feed lists, copied out as rows.
+     *
+     * These run the same queries as the select functions.  With DatabaseOptions::nativeReads
+     * the columns are decoded with their native types, rather than through QSqlQuery and a
+     * QVariant per value.
+     */
+    QVector<ItemRow> allItemRows(const ItemCursor &after = {}, int limit = -1);
+    QVector<ItemRow> unreadItemRows(const ItemCursor &after = {}, int limit = -1);
+    QVector<ItemRow> starredItemRows(const ItemCursor &after = {}, int limit = -1);
+    QVector<ItemRow> feedItemRows(qint64 feedId, const ItemCursor &after = {}, int limit = -1);
+    QVector<ItemRow> unreadFeedItemRows(qint64 feedId, const ItemCursor &after = {}, int limit = -1);
+    QVector<ItemRow> itemRows(qint64 id);
+    QVector<ItemRow> searchItemRows(const QString &query, const SearchCursor &after = {}, int limit = -1);
+    QVector<FeedRow> allFeedRows();
+    QVector<FeedRow> feedRows(qint64 feedId);
+
+    /**
+     * Items dated further back than this are not used to estimate how often a feed posts.
+     */
+    static constexpr qint64 postingWindow{60 * 24 * 60 * 60};
+
+    /**
+     * The average time between the feed's items, in seconds, over the items dated in the
+     * postingWindow before /now/.  A feed with no items in the window is taken to post once
+     * per window.
+     */
+    qint64 selectPostingInterval(qint64 feedId, qint64 now);
+
+    /**
+     * selectPostingInterval for every feed that has items in the window, in one query.
+     */
+    QHash<qint64, qint64> selectPostingIntervals(qint64 now);
+
+    /**
+     * Whether the row functions use the SQLite C API.
+     */
+    bool nativeReads() const;
+
+    /**
+     * Returns the stored, possibly compressed, content of an item.  Use decompressContent to read it.
+     */
+    StoredContent selectItemContent(qint64 id);
+    qint64 selectMaxItemId();
+
+    /**
+     * A hash of every stored field of an item record.
+     *
+     * upsertItems stores the fingerprint with the item, so that unchanged items can be
+     * recognized without comparing their content.
+     */
+    static qint64 fingerprint(const ItemRecord &item);
+
+    /**
+     * Returns the stored fingerprints of a batch of items, by localId.  Items that are not
+     * stored, or were stored before fingerprints were introduced, are left out.
+     */
+    QHash<QString, qint64> selectItemFingerprints(qint64 feedId, const QStringList &localIds);
+
+    /**
+     * Full-text search over item headlines, authors and content.
+     *
+     * Every word of /query/ must match, either whole or as a prefix.  Returns at most /limit/
+     * items after /after/, best match first.
+     */
+    ItemQuery searchItems(const QString &query, const SearchCursor &after = {}, int limit = -1);
+
+    /**
+     * The position of an item in the results of searchItems, or nullopt if it does not match.
+     */
+    std::optional<SearchCursor> selectSearchCursor(const QString &query, qint64 id);
+
+    /**
+     * Insert or update a batch of items in a single statement.
+     *
+     * Existing items are matched by feed and localId.  Their headers are always replaced,
+     * but the stored date and content are kept if the record does not provide them.  New
+     * items without a date are stamped with the current time.  Content is compressed
+     * before it is stored.
+     */
+    bool upsertItems(qint64 feedId, const QVector<ItemRecord> &items);
     void updateItemRead(qint64 id, bool isRead);
     void updateItemStarred(qint64 id, bool isStarred);
+
+    /**
+     * Bulk flag updates, each a single UPDATE statement.
+     *
+     * They return the items whose flag changed, or nullopt if the update failed.  Run them
+     * inside a transaction, so that the result matches what was written.  The id lists are
+     * subject to maxBatchSize.  Items dated after /upTo/ are left alone.
+     */
+    std::optional<QVector<ItemFlagChange>> updateItemsRead(const QVector<qint64> &ids, bool isRead);
+    std::optional<QVector<ItemFlagChange>> updateItemsStarred(const QVector<qint64> &ids, bool isStarred);
+    std::optional<QVector<ItemFlagChange>> updateFeedItemsRead(qint64 feedId, qint64 upTo);
+    std::optional<QVector<ItemFlagChange>> updateAllItemsRead(qint64 upTo);
     void deleteItemsForFeed(qint64 feedId);
-    void deleteItemsOlderThan(qint64 feedId, const QDateTime &olderThan);
+
+    /**
+     * Delete up to /limit/ expired items from every feed.
+     *
+     * Each feed's stored expireAge applies; feeds that inherit it use /defaultExpireAge/, and
+     * an age of 0 disables expiry.  Starred items are kept.  Run it inside a transaction and
+     * repeat it until fewer than /limit/ items are deleted.  Returns nullopt on failure.
+     */
+    std::optional<ExpiredItems> deleteExpiredItems(const QDateTime &now, qint64 defaultExpireAge, int limit);
 
     FeedQuery selectAllFeeds();
     FeedQuery selectFeed(qint64 feedId);
@@ -51,11 +273,97 @@ public:
     void updateFeedUpdateInterval(qint64 feedId, qint64 updateInterval);
     void updateFeedLastUpdate(qint64 feedId, const QDateTime &lastUpdated);
     void updateFeedExpireAge(qint64 feedId, qint64 expireAge);
+
+    /**
+     * Store the caching headers of the feed's last response.  Empty strings and an invalid
+     * /expires/ are stored as NULL.
+     */
+    void updateFeedHttpCache(qint64 feedId, const QString &etag, const QString &lastModified, const QDateTime &expires);
+    void updateFeedFailureCount(qint64 feedId, int failureCount);
+    void updateFeedLastFailure(qint64 feedId, const QDateTime &lastFailure);
     void deleteFeed(qint64 feedId);
 
+    /**
+     * Verify that the trigger-maintained unread counters match the Item table.
+     *
+     * This counts every unread item, so it should only be run as part of maintenance.
+     * Returns false if any counter is wrong or the check could not be run.
+     */
+    bool checkUnreadCounts();
+
+    /**
+     * Recompute every unread counter from the Item table.
+     */
+    bool rebuildUnreadCounts();
+
+    /**
+     * The number of unused pages in the database file.
+     */
+    qint64 freePageCount();
+
+    /**
+     * Return up to /pages/ unused pages to the file system.
+     *
+     * This only has an effect if the database uses auto_vacuum=INCREMENTAL, which is set up
+     * when the database is opened.
+     */
+    bool incrementalVacuum(int pages);
+
+    /**
+     * Run PRAGMA optimize, which refreshes the query planner statistics that are out of date.
+     */
+    bool optimize();
+
+    bool transaction();
+    bool commit();
+    void rollback();
+
+    const StatementCacheStats &statementCacheStats() const;
+
+    /**
+     * What opening the database did.  This is empty for read-only connections.
+     */
+    const DatabaseUpgrade &upgrade() const;
+
 private:
     QSqlDatabase db();
+
+    /**
+     * Return a prepared, forward-only query for the given SQL.
+     *
+     * Statements are prepared once per connection and kept until they are among the least
+     * recently used of more than maxCachedStatements.
+     * The returned query shares its result with the cached copy.  While a holder is still
+     * reading rows from it, a later call for the same SQL prepares a new query and caches that
+     * instead, so the holder's result is left alone.  Holders that stop reading early should
+     * finish() the query so that it can be reused.
+     */
+    QSqlQuery statement(const QString &sql);
+
+    using Bindings = QVector<QPair<const char *, QVariant>>;
+    QVector<ItemRow> readItems(const QString &sql, const Bindings &bindings, const char *caller);
+    QVector<FeedRow> readFeeds(const QString &sql, const Bindings &bindings, const char *caller);
+    QSqlQuery boundStatement(const QString &sql, const Bindings &bindings, const char *caller);
+
+    /**
+     * Like statement, but prepared through the SQLite C API on the same connection, and with
+     * /bindings/ applied.  Returns nullptr if native reads are not in use.
+     */
+    NativeStatement *nativeStatement(const QString &sql, const Bindings &bindings);
+
+    template<typename T>
+    struct CachedStatement {
+        T statement;
+        quint64 lastUsed{0};
+    };
+
     QString m_dbName;
+    QHash<QString, CachedStatement<QSqlQuery>> m_statements;
+    StatementCacheStats m_statementCacheStats;
+    quint64 m_statementUses{0}; /** < orders the cached statements by when they were last used */
+    DatabaseUpgrade m_upgrade;
+    sqlite3 *m_native{nullptr};
+    QHash<QString, CachedStatement<std::shared_ptr<NativeStatement>>> m_nativeStatements;
 };
 
 }
@@ -11,7 +11,6 @@
 #include "sqlite/storageimpl.h"
 #include <QSqlQuery>
 #include <QVariant>
-#include <Syndication/Image>
 
 using namespace FeedCore;
 using namespace SqliteStorage;
@@ -28,6 +27,8 @@ void FeedImpl::unpackUpdateInterval(qint64 updateInterval)
 {
     if (updateInterval == 0) {
         setUpdateMode(InheritUpdateMode);
+    } else if (updateInterval == adaptiveUpdateInterval) {
+        setUpdateMode(AdaptiveUpdateMode);
     } else if (updateInterval < 0) {
         setUpdateMode(DisableUpdateMode);
     } else {
@@ -48,17 +49,21 @@ void FeedImpl::unpackExpireAge(qint64 expireAge)
     }
 }
 
-void FeedImpl::updateFromQuery(const FeedQuery &query)
+void FeedImpl::updateFromRow(const FeedRow &row)
 {
-    setName(query.displayName());
-    setCategory(query.category());
-    setUrl(query.url());
-    setLink(query.link());
-    setIcon(query.icon());
-    setUnreadCount(query.unreadCount());
-    setLastUpdate(query.lastUpdate());
-    unpackUpdateInterval(query.updateInterval());
-    unpackExpireAge(query.expireAge());
+    setName(row.displayName);
+    setCategory(row.category);
+    setUrl(row.url);
+    setHttpCache({row.etag, row.lastModified, row.cacheExpires});
+    setLink(row.link);
+    setIcon(row.icon);
+    setUnreadCount(row.unreadCount);
+    setLastUpdate(row.lastUpdate);
+    setPostingInterval(row.postingInterval);
+    setFailureCount(row.failureCount);
+    setLastFailure(row.lastFailure);
+    unpackUpdateInterval(row.updateInterval);
+    unpackExpireAge(row.expireAge);
 }
 
 Future<ArticleRef> *FeedImpl::getArticles(bool unreadFilter)
@@ -69,22 +74,30 @@ Future<ArticleRef> *FeedImpl::getArticles(bool unreadFilter)
     return m_storage->getByFeed(this);
 }
 
-void FeedImpl::updateSourceArticle(const Syndication::ItemPtr &article)
+Future<ArticleRef> *FeedImpl::getArticlePage(bool unreadFilter, const ArticleRef &after, int limit)
 {
-    auto *q = m_storage->storeArticle(this, article);
-    QObject::connect(q, &BaseFuture::finished, this, [this, q] {
-        for (const auto &item : q->result()) {
-            if (!item->isRead()) {
-                incrementUnreadCount();
-            }
-            emit articleAdded(item);
-        }
-    });
+    if (unreadFilter) {
+        return m_storage->getUnreadByFeed(this, after, limit);
+    }
+    return m_storage->getByFeed(this, after, limit);
+}
+
+Future<ArticleRows> *FeedImpl::getArticleRows(bool unreadFilter, const ArticleRows::Row &after, int limit)
+{
+    if (unreadFilter) {
+        return m_storage->getUnreadRowsByFeed(this, after, limit);
+    }
+    return m_storage->getRowsByFeed(this, after, limit);
 }
 
-void FeedImpl::expire(const QDateTime &olderThan)
+Future<qint64> *FeedImpl::markAllRead(const QDateTime &upTo)
 {
-    m_storage->expire(this, olderThan);
+    return m_storage->markFeedRead(this, upTo);
+}
+
+Future<StoredArticles> *FeedImpl::updateSourceArticles(const QVector<ParsedItem> &articles)
+{
+    return m_storage->storeArticles(this, articles);
 }
 
 void FeedImpl::onArticleReadChanged(ArticleImpl *article)
@@ -92,6 +105,11 @@ void FeedImpl::onArticleReadChanged(ArticleImpl *article)
     incrementUnreadCount(article->isRead() ? -1 : 1);
 }
 
+void FeedImpl::onArticlesReadChanged(int delta)
+{
+    incrementUnreadCount(delta);
+}
+
 qint64 FeedImpl::id() const
 {
     return m_id;
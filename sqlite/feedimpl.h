@@ -17,29 +17,36 @@ namespace SqliteStorage
 {
 class StorageImpl;
 class ArticleImpl;
-class FeedQuery;
+struct FeedRow;
 
 class FeedImpl : public FeedCore::UpdatableFeed
 {
     Q_OBJECT
 public:
     qint64 id() const;
-    void updateFromQuery(const FeedQuery &query);
+    void updateFromRow(const FeedRow &row);
     FeedCore::Future<FeedCore::ArticleRef> *getArticles(bool unreadFilter) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getArticlePage(bool unreadFilter, const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getArticleRows(bool unreadFilter, const FeedCore::ArticleRows::Row &after, int limit) final;
     bool editable() final
     {
         return true;
     }
+    FeedCore::Future<qint64> *markAllRead(const QDateTime &upTo) final;
     void onArticleReadChanged(ArticleImpl *article);
 
+    /**
+     * Adjust the unread count after a bulk update changed /delta/ articles at once.
+     */
+    void onArticlesReadChanged(int delta);
+
 private:
     FeedImpl(qint64 feedId, StorageImpl *storage);
     qint64 m_id{0};
     StorageImpl *m_storage{nullptr};
     void unpackUpdateInterval(qint64 updateInterval);
     void unpackExpireAge(qint64 expireAge);
-    void updateSourceArticle(const Syndication::ItemPtr &article) final;
-    void expire(const QDateTime &olderThan) final;
+    FeedCore::Future<FeedCore::StoredArticles> *updateSourceArticles(const QVector<FeedCore::ParsedItem> &articles) final;
     friend FeedCore::ObjectFactory<qint64, FeedImpl>;
 };
 }
@@ -9,21 +9,66 @@
 #include <QSqlQuery>
 #include <QUrl>
 #include <QVariant>
+#include <QVector>
 
 namespace SqliteStorage
 {
+/**
+ * The columns of a FeedQuery row, copied out so that they can be passed between threads.
+ */
+struct FeedRow {
+    qint64 id{0};
+    QString displayName;
+    QString category;
+    QUrl url;
+    QUrl link;
+    QUrl icon;
+    int unreadCount{0};
+    qint64 updateInterval{0};
+    QDateTime lastUpdate;
+    qint64 expireAge{0};
+    QString etag;
+    QString lastModified;
+    QDateTime cacheExpires;
+    int failureCount{0};
+    QDateTime lastFailure;
+    qint64 postingInterval{0}; /** < not a Feed column; filled in by FeedDatabase from the feed's items */
+};
+
+/**
+ * Feed.updateInterval packs the update mode with the interval: 0 inherits the context's interval,
+ * -1 disables updates, this value selects AdaptiveUpdateMode, and positive values override.
+ */
+static constexpr qint64 adaptiveUpdateInterval{-2};
+
+/**
+ * Feed.cacheExpires is NULL when the source gave no expiry, which reads back as 0.
+ */
+inline QDateTime cacheExpiry(qint64 secsSinceEpoch)
+{
+    return secsSinceEpoch == 0 ? QDateTime() : QDateTime::fromSecsSinceEpoch(secsSinceEpoch);
+}
+
 class FeedQuery : public QSqlQuery
 {
 public:
-    FeedQuery(QSqlDatabase db, const QString &whereClause)
-        : QSqlQuery(db)
+    /**
+     * Wrap a query that was prepared from a statement returned by FeedQuery::statement.
+     */
+    explicit FeedQuery(const QSqlQuery &query)
+        : QSqlQuery(query)
+    {
+    }
+
+    static QString statement(const QString &whereClause)
     {
-        prepare(
-            "SELECT Feed.id, Feed.displayName, Feed.category, Feed.url, Feed.link, Feed.icon, "
-            "COUNT(Item.id), updateInterval, lastUpdate, expireAge "
-            "FROM Feed LEFT JOIN Item ON Item.feed=Feed.id AND Item.isRead=false "
-            "WHERE "
-            + whereClause + " GROUP BY Feed.id");
+        return QStringLiteral(
+                   "SELECT Feed.id, Feed.displayName, Feed.category, Feed.url, Feed.link, Feed.icon, "
+                   "COALESCE(FeedUnreadCount.unreadCount, 0), updateInterval, lastUpdate, expireAge, "
+                   "etag, lastModified, cacheExpires, failureCount, lastFailure "
+                   "FROM Feed LEFT JOIN FeedUnreadCount ON FeedUnreadCount.feed=Feed.id "
+                   "WHERE ")
+            + whereClause;
     }
     qint64 id() const
     {
@@ -65,6 +110,57 @@ public:
     {
         return value(9).toLongLong();
     }
+    QString etag() const
+    {
+        return value(10).toString();
+    }
+    QString lastModified() const
+    {
+        return value(11).toString();
+    }
+    QDateTime cacheExpires() const
+    {
+        return cacheExpiry(value(12).toLongLong());
+    }
+    int failureCount() const
+    {
+        return value(13).toInt();
+    }
+    QDateTime lastFailure() const
+    {
+        const QVariant &value{this->value(14)};
+        return value.isNull() ? QDateTime() : QDateTime::fromSecsSinceEpoch(value.toLongLong());
+    }
+    FeedRow row() const
+    {
+        return {id(),
+                displayName(),
+                category(),
+                url(),
+                link(),
+                icon(),
+                unreadCount(),
+                updateInterval(),
+                lastUpdate(),
+                expireAge(),
+                etag(),
+                lastModified(),
+                cacheExpires(),
+                failureCount(),
+                lastFailure()};
+    }
+
+    /**
+     * Read every remaining row.
+     */
+    QVector<FeedRow> rows()
+    {
+        QVector<FeedRow> result;
+        while (next()) {
+            result.append(row());
+        }
+        return result;
+    }
 };
 }
 #endif // SQLITE_FEEDQUERY_H
@@ -0,0 +1,106 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sqlite/itemcontent.h"
+#include "cmake-config.h"
+#include <QByteArray>
+#include <QDebug>
+#include <Syndication/Tools>
+#ifdef ZSTD_FOUND
+#include <zstd.h>
+#endif
+
+namespace SqliteStorage
+{
+// below this size the compression overhead outweighs the savings
+static constexpr int minCompressSize{128};
+
+#ifdef ZSTD_FOUND
+static constexpr int zstdLevel{3};
+
+static QByteArray zstdCompress(const QByteArray &data)
+{
+    QByteArray compressed(static_cast<int>(ZSTD_compressBound(data.size())), Qt::Uninitialized);
+    const size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.constData(), data.size(), zstdLevel);
+    if (ZSTD_isError(size)) {
+        qWarning() << "zstd compression failed:" << ZSTD_getErrorName(size);
+        return QByteArray();
+    }
+    compressed.truncate(static_cast<int>(size));
+    return compressed;
+}
+
+static QByteArray zstdDecompress(const QByteArray &data)
+{
+    const unsigned long long contentSize = ZSTD_getFrameContentSize(data.constData(), data.size());
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+        qWarning() << "Invalid zstd content";
+        return QByteArray();
+    }
+    QByteArray decompressed(static_cast<int>(contentSize), Qt::Uninitialized);
+    const size_t size = ZSTD_decompress(decompressed.data(), decompressed.size(), data.constData(), data.size());
+    if (ZSTD_isError(size)) {
+        qWarning() << "zstd decompression failed:" << ZSTD_getErrorName(size);
+        return QByteArray();
+    }
+    decompressed.truncate(static_cast<int>(size));
+    return decompressed;
+}
+#endif
+
+StoredContent compressContent(const QString &content)
+{
+    const QByteArray &utf8{content.toUtf8()};
+    if (utf8.size() >= minCompressSize) {
+#ifdef ZSTD_FOUND
+        const QByteArray &compressed{zstdCompress(utf8)};
+        const int codec{ZstdContent};
+#else
+        const QByteArray &compressed{qCompress(utf8)};
+        const int codec{ZlibContent};
+#endif
+        if (!compressed.isEmpty() && compressed.size() < utf8.size()) {
+            return {codec, compressed};
+        }
+    }
+    return {PlainContent, content};
+}
+
+QString decompressContent(const StoredContent &content)
+{
+    switch (content.codec) {
+    case PlainContent:
+        return content.data.toString();
+
+    case ZlibContent:
+        return QString::fromUtf8(qUncompress(content.data.toByteArray()));
+
+    case ZstdContent:
+#ifdef ZSTD_FOUND
+        return QString::fromUtf8(zstdDecompress(content.data.toByteArray()));
+#else
+        qWarning() << "Content is compressed with zstd, but zstd support is not available";
+        return QString();
+#endif
+
+    default:
+        qWarning() << "Unknown content codec" << content.codec;
+        return QString();
+    }
+}
+
+qint64 storedSize(const StoredContent &content)
+{
+    if (content.codec == PlainContent) {
+        return content.data.toString().toUtf8().size();
+    }
+    return content.data.toByteArray().size();
+}
+
+QString searchableText(const QString &content)
+{
+    return Syndication::htmlToPlainText(content);
+}
+}
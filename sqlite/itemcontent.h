@@ -0,0 +1,57 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SQLITE_ITEMCONTENT_H
+#define SQLITE_ITEMCONTENT_H
+#include <QString>
+#include <QVariant>
+
+namespace SqliteStorage
+{
+/**
+ * Encodings for stored article content.
+ *
+ * The value is written to the database next to the content, so existing values must never change.
+ */
+enum ContentCodec {
+    PlainContent = 0, /** < uncompressed text */
+    ZlibContent = 1, /** < UTF-8 compressed with qCompress */
+    ZstdContent = 2, /** < UTF-8 compressed with zstd */
+};
+
+/**
+ * Article content in the form it is stored in the database.
+ */
+struct StoredContent {
+    int codec{PlainContent};
+    QVariant data; /** < a QString for PlainContent, otherwise a QByteArray */
+};
+
+/**
+ * Compress content for storage.
+ *
+ * Content is compressed with zstd if it is available, otherwise with zlib.  Content that
+ * does not get smaller is stored as plain text.
+ */
+StoredContent compressContent(const QString &content);
+
+/**
+ * Restore content that was produced by compressContent.
+ *
+ * Returns an empty string if the content cannot be decoded.
+ */
+QString decompressContent(const StoredContent &content);
+
+/**
+ * The number of bytes that the content occupies in the database.
+ */
+qint64 storedSize(const StoredContent &content);
+
+/**
+ * The text of an article's content without markup, as it is indexed for search.
+ */
+QString searchableText(const QString &content);
+}
+#endif // SQLITE_ITEMCONTENT_H
@@ -9,19 +9,54 @@
 #include <QSqlQuery>
 #include <QUrl>
 #include <QVariant>
+#include <QVector>
 
 namespace SqliteStorage
 {
+/**
+ * The columns of an ItemQuery row, copied out so that they can be passed between threads.
+ */
+struct ItemRow {
+    qint64 id{0};
+    qint64 feed{0};
+    QString localId;
+    QString headline;
+    QString author;
+    QDateTime date;
+    QUrl url;
+    bool isRead{false};
+    bool isStarred{false};
+};
+
 class ItemQuery : public QSqlQuery
 {
 public:
-    ItemQuery(QSqlDatabase db, const QString &whereClause)
-        : QSqlQuery(db)
+    /**
+     * Wrap a query that was prepared from a statement returned by ItemQuery::statement.
+     */
+    explicit ItemQuery(const QSqlQuery &query)
+        : QSqlQuery(query)
     {
-        prepare(
-            "SELECT id, feed, localId, headline, author, date, url, isRead, isStarred "
-            "FROM Item WHERE "
-            + whereClause);
+    }
+
+    static QString statement(const QString &whereClause)
+    {
+        return QStringLiteral(
+                   "SELECT id, feed, localId, headline, author, date, url, isRead, isStarred "
+                   "FROM Item WHERE ")
+            + whereClause;
+    }
+
+    /**
+     * Like statement, but joined with the ItemSearch full-text index so that the clause can match
+     * against it and order by rank.
+     */
+    static QString searchStatement(const QString &whereClause)
+    {
+        return QStringLiteral(
+                   "SELECT Item.id, Item.feed, Item.localId, Item.headline, Item.author, Item.date, Item.url, Item.isRead, Item.isStarred "
+                   "FROM ItemSearch JOIN Item ON Item.id=ItemSearch.rowid WHERE ")
+            + whereClause;
     }
 
     qint64 id() const
@@ -60,6 +95,22 @@ public:
     {
         return value(8).toBool();
     }
+    ItemRow row() const
+    {
+        return {id(), feed(), localId(), headline(), author(), date(), url(), isRead(), isStarred()};
+    }
+
+    /**
+     * Read every remaining row.
+     */
+    QVector<ItemRow> rows()
+    {
+        QVector<ItemRow> result;
+        while (next()) {
+            result.append(row());
+        }
+        return result;
+    }
 };
 }
 #endif // SQLITE_ITEMQUERY_H
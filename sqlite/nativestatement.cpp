@@ -0,0 +1,99 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sqlite/nativestatement.h"
+#include <QDebug>
+#include <sqlite3.h>
+
+namespace SqliteStorage
+{
+NativeStatement::NativeStatement(sqlite3 *db, const QString &sql)
+    : m_db{db}
+{
+    const QByteArray &utf8{sql.toUtf8()};
+    if (sqlite3_prepare_v3(m_db, utf8.constData(), utf8.size(), SQLITE_PREPARE_PERSISTENT, &m_statement, nullptr) != SQLITE_OK) {
+        qWarning() << "SQL Error preparing native statement: " << lastError();
+        m_statement = nullptr;
+    }
+}
+
+NativeStatement::~NativeStatement()
+{
+    sqlite3_finalize(m_statement);
+}
+
+bool NativeStatement::isValid() const
+{
+    return m_statement != nullptr;
+}
+
+void NativeStatement::reset()
+{
+    sqlite3_reset(m_statement);
+    sqlite3_clear_bindings(m_statement);
+}
+
+int NativeStatement::parameterIndex(const char *name) const
+{
+    const int index{sqlite3_bind_parameter_index(m_statement, name)};
+    if (index == 0) {
+        qWarning() << "Native statement has no parameter" << name;
+    }
+    return index;
+}
+
+bool NativeStatement::bind(const char *name, qint64 value)
+{
+    const int index{parameterIndex(name)};
+    return index > 0 && sqlite3_bind_int64(m_statement, index, value) == SQLITE_OK;
+}
+
+bool NativeStatement::bind(const char *name, double value)
+{
+    const int index{parameterIndex(name)};
+    return index > 0 && sqlite3_bind_double(m_statement, index, value) == SQLITE_OK;
+}
+
+bool NativeStatement::bind(const char *name, const QString &value)
+{
+    const int index{parameterIndex(name)};
+    const QByteArray &utf8{value.toUtf8()};
+    return index > 0 && sqlite3_bind_text(m_statement, index, utf8.constData(), utf8.size(), SQLITE_TRANSIENT) == SQLITE_OK;
+}
+
+bool NativeStatement::step()
+{
+    const int result{sqlite3_step(m_statement)};
+    if (result == SQLITE_ROW) {
+        return true;
+    }
+    if (result != SQLITE_DONE) {
+        qWarning() << "SQL Error in native statement: " << lastError();
+    }
+    return false;
+}
+
+qint64 NativeStatement::int64(int column) const
+{
+    return sqlite3_column_int64(m_statement, column);
+}
+
+double NativeStatement::real(int column) const
+{
+    return sqlite3_column_double(m_statement, column);
+}
+
+QString NativeStatement::text(int column) const
+{
+    // the pointer is only valid until the next step, so the text is copied once, into the QString
+    const auto *data = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, column));
+    return QString::fromUtf8(data, sqlite3_column_bytes(m_statement, column));
+}
+
+QString NativeStatement::lastError() const
+{
+    return QString::fromUtf8(sqlite3_errmsg(m_db));
+}
+}
@@ -0,0 +1,62 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SQLITE_NATIVESTATEMENT_H
+#define SQLITE_NATIVESTATEMENT_H
+#include <QString>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace SqliteStorage
+{
+/**
+ * A prepared statement that is run through the SQLite C API rather than QtSql.
+ *
+ * Columns are read with their native types, and text is decoded straight from SQLite's
+ * buffer, so no QVariant is created for any value.  The statement can be reused: bind new
+ * values after reset.  It must be destroyed before its connection is closed.
+ */
+class NativeStatement
+{
+public:
+    NativeStatement(sqlite3 *db, const QString &sql);
+    ~NativeStatement();
+    NativeStatement(const NativeStatement &) = delete;
+    NativeStatement &operator=(const NativeStatement &) = delete;
+
+    bool isValid() const;
+
+    /**
+     * Rewind the statement and clear its bound values.
+     */
+    void reset();
+
+    /**
+     * Bind a value to a named parameter, such as ":id".  Returns false if the statement
+     * has no such parameter.
+     */
+    bool bind(const char *name, qint64 value);
+    bool bind(const char *name, double value);
+    bool bind(const char *name, const QString &value);
+
+    /**
+     * Advance to the next row.  Returns false when there are no more rows, or on error.
+     */
+    bool step();
+
+    qint64 int64(int column) const;
+    double real(int column) const;
+    QString text(int column) const;
+
+    QString lastError() const;
+
+private:
+    sqlite3 *m_db{nullptr};
+    sqlite3_stmt *m_statement{nullptr};
+    int parameterIndex(const char *name) const;
+};
+}
+#endif // SQLITE_NATIVESTATEMENT_H
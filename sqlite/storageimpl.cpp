@@ -7,20 +7,178 @@
 #include "articleref.h"
 #include "provisionalfeed.h"
 #include "sqlite/articleimpl.h"
+#include "sqlite/databasethread.h"
 #include "sqlite/feedimpl.h"
+#include <QDebug>
+#include <QPointer>
 #include <QTimer>
 #include <QVector>
-#include <Syndication/Person>
+#include <algorithm>
 #include <utility>
 using namespace FeedCore;
 using namespace SqliteStorage;
 
-void StorageImpl::appendArticleResults(Future<ArticleRef> *op, ItemQuery &q)
+namespace
 {
-    while (q.next()) {
-        const auto &feed = m_feedFactory.getInstance(q.feed(), this);
-        const auto &item = m_articleFactory.getInstance(q.id(), this, feed, q);
-        item->updateFromQuery(q);
+/**
+ * The rows touched by storeArticles
+ */
+struct StoredItems {
+    bool ok{false};
+    QVector<ItemRow> inserted;
+    QVector<ItemRow> updated;
+    int skipped{0}; /** < existing items whose fingerprint matched, which were not written */
+    qint64 postingInterval{0}; /** < the feed's posting interval with the new items, or 0 if the write failed */
+};
+}
+
+// enough articles to cover the pages of a few recently viewed lists
+static constexpr int retainedArticleCount{200};
+
+// long enough to gather a burst of changes, short enough that little is lost if the process is killed
+static constexpr int bufferedWriteDelay{500};
+
+template<typename T, typename Query, typename Deliver>
+Future<T> *StorageImpl::run(DatabaseThread &thread, quint64 after, Query query, Deliver deliver, quint64 *ticket)
+{
+    auto *op = new Future<T>;
+    DatabaseThread *writer{m_writer.get()};
+    const quint64 posted{thread.post([this, op, writer, after, query, deliver](FeedDatabase &db) {
+        if (after > 0) {
+            writer->waitFor(after);
+        }
+        const auto &result = query(db);
+        QMetaObject::invokeMethod(
+            this,
+            [op, deliver, result] {
+                deliver(op, result);
+                emit op->finished();
+                delete op;
+            },
+            Qt::QueuedConnection);
+    })};
+    if (ticket != nullptr) {
+        *ticket = posted;
+    }
+    return op;
+}
+
+template<typename T, typename Query, typename Deliver>
+Future<T> *StorageImpl::read(bool afterItemWrites, Query query, Deliver deliver)
+{
+    postBufferedWrites();
+    if (m_readers.empty()) {
+        return run<T>(*m_writer, 0, query, deliver);
+    }
+    m_nextReader = (m_nextReader + 1) % m_readers.size();
+    // taken after the flush above, so that the read also waits for the changes it just wrote
+    return run<T>(*m_readers[m_nextReader], afterItemWrites ? m_itemTicket : 0, query, deliver);
+}
+
+template<typename T, typename Query, typename Deliver>
+Future<T> *StorageImpl::write(Query query, Deliver deliver)
+{
+    postBufferedWrites();
+    return run<T>(*m_writer, 0, query, deliver);
+}
+
+template<typename T, typename Query, typename Deliver>
+Future<T> *StorageImpl::writeItems(Query query, Deliver deliver)
+{
+    postBufferedWrites();
+    return run<T>(*m_writer, 0, query, deliver, &m_itemTicket);
+}
+
+template<typename Query>
+Future<ArticleRef> *StorageImpl::readArticles(Query query)
+{
+    // article lists are filtered and sorted by their flags, so they wait for the writes that change them
+    return read<ArticleRef>(true, query, [this](auto *op, const QVector<ItemRow> &rows) {
+        appendArticleResults(op, rows);
+    });
+}
+
+class StorageImpl::RowSource : public ArticleRows::Source
+{
+public:
+    explicit RowSource(StorageImpl *storage)
+        : m_storage{storage}
+    {
+    }
+
+    ArticleRef article(const ArticleRows::Row &row) final
+    {
+        return m_storage.isNull() ? ArticleRef() : m_storage->rowArticle(row);
+    }
+
+    ArticleRef find(const ArticleRows::Row &row) final
+    {
+        return m_storage.isNull() ? ArticleRef() : m_storage->m_articleFactory.find(row.id);
+    }
+
+private:
+    QPointer<StorageImpl> m_storage;
+};
+
+template<typename Query>
+Future<ArticleRows> *StorageImpl::readRows(Query query)
+{
+    const std::shared_ptr<ArticleRows::Source> source{m_rowSource};
+    // the rows are assembled on the database thread, so only the delivery happens here
+    return read<ArticleRows>(
+        true,
+        [source, query](FeedDatabase &db) {
+            ArticleRows rows(source);
+            for (const ItemRow &row : query(db)) {
+                rows.append({row.id, row.feed, row.date.toSecsSinceEpoch(), row.isRead, row.isStarred, row.headline, row.author, row.url});
+            }
+            return rows;
+        },
+        [](auto *op, const ArticleRows &rows) {
+            op->setResult(rows);
+        });
+}
+
+ArticleRef StorageImpl::rowArticle(const ArticleRows::Row &row)
+{
+    const ItemRow itemRow{row.id, row.feed, {}, row.title, row.author, QDateTime::fromSecsSinceEpoch(row.date), row.url, row.isRead, row.isStarred};
+    return m_articleFactory.getInstance(row.id, this, m_feedFactory.getInstance(row.feed, this), itemRow);
+}
+
+void StorageImpl::post(const std::function<void(FeedDatabase &)> &job)
+{
+    postBufferedWrites();
+    m_itemTicket = m_writer->post(job);
+}
+
+void StorageImpl::scheduleBufferedWrites()
+{
+    // the timer is not restarted, so a steady stream of changes is still written every so often
+    if (!m_bufferTimer.isActive()) {
+        m_bufferTimer.start();
+    }
+}
+
+void StorageImpl::postBufferedWrites()
+{
+    m_bufferTimer.stop();
+    if (!m_buffer.isEmpty()) {
+        m_itemTicket = m_writer->post(m_buffer.take());
+    }
+}
+
+void StorageImpl::flush()
+{
+    postBufferedWrites();
+    m_writer->sync();
+}
+
+void StorageImpl::appendArticleResults(Future<ArticleRef> *op, const QVector<ItemRow> &rows)
+{
+    for (const auto &row : rows) {
+        const auto &feed = m_feedFactory.getInstance(row.feed, this);
+        const auto &item = m_articleFactory.getInstance(row.id, this, feed, row);
+        item->updateHeaders(row);
         op->appendResult(item);
     }
 }
@@ -28,146 +186,473 @@ void StorageImpl::appendArticleResults(Future<ArticleRef> *op, ItemQuery &q)
 void StorageImpl::onFeedRequestDelete(FeedImpl *feed)
 {
     feed->updater()->abort();
-    qint64 feedId{feed->id()};
-    m_db.deleteItemsForFeed(feedId);
-    m_db.deleteFeed(feedId);
+    const qint64 feedId{feed->id()};
+    post([feedId](FeedDatabase &db) {
+        db.deleteItemsForFeed(feedId);
+        db.deleteFeed(feedId);
+    });
     feed->deleteLater();
 }
 
+static ItemCursor itemCursor(const ArticleRef &after)
+{
+    const auto *article = qobject_cast<const ArticleImpl *>(after.get());
+    if (article == nullptr) {
+        return {};
+    }
+    return {article->date().toSecsSinceEpoch(), article->id()};
+}
+
+static ItemCursor itemCursor(const ArticleRows::Row &after)
+{
+    if (after.id == 0) {
+        return {};
+    }
+    return {after.date, after.id};
+}
+
+static QVector<ItemRow> searchPage(FeedDatabase &db, const QString &query, qint64 afterId, int limit)
+{
+    // like the memory storage, a blank query matches nothing; FTS5 would reject it as a syntax error
+    if (query.simplified().isEmpty()) {
+        return {};
+    }
+    SearchCursor cursor;
+    if (afterId != 0) {
+        const auto &position = db.selectSearchCursor(query, afterId);
+        if (!position) {
+            // the article no longer matches, so there is no way to tell where the next page starts
+            return {};
+        }
+        cursor = *position;
+    }
+    return db.searchItemRows(query, cursor, limit);
+}
+
 Future<ArticleRef> *StorageImpl::getAll()
 {
-    return Future<ArticleRef>::yield(this, [this](auto *op) {
-        ItemQuery q{m_db.selectAllItems()};
-        appendArticleResults(op, q);
-    });
+    return getAllPage({}, -1);
 }
 
 Future<ArticleRef> *StorageImpl::getUnread()
 {
-    return Future<ArticleRef>::yield(this, [this](auto *op) {
-        ItemQuery q{m_db.selectUnreadItems()};
-        appendArticleResults(op, q);
-    });
+    return getUnreadPage({}, -1);
 }
 
 FeedCore::Future<ArticleRef> *StorageImpl::getStarred()
 {
-    return Future<ArticleRef>::yield(this, [this](auto *op) {
-        ItemQuery q{m_db.selectStarredItems()};
-        appendArticleResults(op, q);
+    return getStarredPage({}, -1);
+}
+
+Future<ArticleRef> *StorageImpl::getAllPage(const ArticleRef &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readArticles([cursor, limit](FeedDatabase &db) {
+        return db.allItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRef> *StorageImpl::getUnreadPage(const ArticleRef &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readArticles([cursor, limit](FeedDatabase &db) {
+        return db.unreadItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRef> *StorageImpl::getStarredPage(const ArticleRef &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readArticles([cursor, limit](FeedDatabase &db) {
+        return db.starredItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRef> *StorageImpl::search(const QString &query, const ArticleRef &after, int limit)
+{
+    const auto *article = qobject_cast<const ArticleImpl *>(after.get());
+    const qint64 afterId{article != nullptr ? article->id() : 0};
+    return readArticles([query, afterId, limit](FeedDatabase &db) {
+        return searchPage(db, query, afterId, limit);
+    });
+}
+
+Future<ArticleRows> *StorageImpl::getAllRows(const ArticleRows::Row &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readRows([cursor, limit](FeedDatabase &db) {
+        return db.allItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRows> *StorageImpl::getUnreadRows(const ArticleRows::Row &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readRows([cursor, limit](FeedDatabase &db) {
+        return db.unreadItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRows> *StorageImpl::getStarredRows(const ArticleRows::Row &after, int limit)
+{
+    const ItemCursor cursor{itemCursor(after)};
+    return readRows([cursor, limit](FeedDatabase &db) {
+        return db.starredItemRows(cursor, limit);
+    });
+}
+
+Future<ArticleRows> *StorageImpl::searchRows(const QString &query, const ArticleRows::Row &after, int limit)
+{
+    const qint64 afterId{after.id};
+    return readRows([query, afterId, limit](FeedDatabase &db) {
+        return searchPage(db, query, afterId, limit);
+    });
+}
+
+StorageImpl::StorageImpl(const QString &filePath, const DatabaseOptions &options)
+    : m_writer{std::make_unique<DatabaseThread>(filePath, options, FeedDatabase::ReadWrite)}
+{
+    // upgrading an old database can take minutes, so this doesn't wait for it.  The read-only
+    // connections need the schema to exist before they open; until they do, reads queue behind
+    // the upgrade on the writer.
+    m_writer->post([this, filePath, options](FeedDatabase &db) {
+        const DatabaseUpgrade upgrade{db.upgrade()};
+        QMetaObject::invokeMethod(
+            this,
+            [this, filePath, options, upgrade] {
+                m_databaseUpgrade = upgrade;
+                if (options.walMode) {
+                    for (int i = 0; i < options.readConnections; ++i) {
+                        m_readers.push_back(std::make_unique<DatabaseThread>(filePath, options, FeedDatabase::ReadOnly));
+                    }
+                }
+            },
+            Qt::QueuedConnection);
     });
+    m_rowSource = std::make_shared<RowSource>(this);
+    m_articleFactory.setRetainLimit(retainedArticleCount);
+    m_bufferTimer.setSingleShot(true);
+    m_bufferTimer.setInterval(bufferedWriteDelay);
+    QObject::connect(&m_bufferTimer, &QTimer::timeout, this, &StorageImpl::postBufferedWrites);
 }
 
-StorageImpl::StorageImpl(const QString &filePath)
-    : m_db(filePath)
+StorageImpl::~StorageImpl()
 {
+    postBufferedWrites();
+    // readers may be waiting on the writer, so they have to finish first
+    m_readers.clear();
+    m_writer.reset();
 }
 
 Future<ArticleRef> *StorageImpl::getById(qint64 id)
 {
-    return Future<ArticleRef>::yield(this, [this, id](auto *op) {
-        ItemQuery q{m_db.selectItem(id)};
-        appendArticleResults(op, q);
+    return readArticles([id](FeedDatabase &db) {
+        return db.itemRows(id);
     });
 }
 
-Future<ArticleRef> *StorageImpl::getByFeed(FeedImpl *feed)
+Future<ArticleRef> *StorageImpl::getByFeed(FeedImpl *feed, const ArticleRef &after, int limit)
 {
     const qint64 feedId{feed->id()};
-    return Future<ArticleRef>::yield(this, [this, feedId](auto *op) {
-        ItemQuery q = m_db.selectItemsByFeed(feedId);
-        appendArticleResults(op, q);
+    const ItemCursor cursor{itemCursor(after)};
+    return readArticles([feedId, cursor, limit](FeedDatabase &db) {
+        return db.feedItemRows(feedId, cursor, limit);
     });
 }
 
-Future<ArticleRef> *StorageImpl::getUnreadByFeed(FeedImpl *feed)
+Future<ArticleRef> *StorageImpl::getUnreadByFeed(FeedImpl *feed, const ArticleRef &after, int limit)
 {
     const qint64 feedId = feed->id();
-    return Future<ArticleRef>::yield(this, [this, feedId](auto *op) {
-        ItemQuery q{m_db.selectUnreadItemsByFeed(feedId)};
-        appendArticleResults(op, q);
+    const ItemCursor cursor{itemCursor(after)};
+    return readArticles([feedId, cursor, limit](FeedDatabase &db) {
+        return db.unreadFeedItemRows(feedId, cursor, limit);
     });
 }
 
-Future<ArticleRef> *StorageImpl::storeArticle(FeedImpl *feed, const Syndication::ItemPtr &item)
+Future<ArticleRows> *StorageImpl::getRowsByFeed(FeedImpl *feed, const ArticleRows::Row &after, int limit)
 {
     const qint64 feedId{feed->id()};
-    return Future<ArticleRef>::yield(this, [this, item, feedId](auto *op) {
-        const auto &itemId = m_db.selectItemId(feedId, item->id());
-        const auto &authors = item->authors();
-        const auto &authorName = authors.empty() ? "" : authors[0]->name();
-        time_t date = item->dateUpdated();
-        auto content = item->content();
-        if (content.isEmpty()) {
-            content = item->description();
-        }
+    const ItemCursor cursor{itemCursor(after)};
+    return readRows([feedId, cursor, limit](FeedDatabase &db) {
+        return db.feedItemRows(feedId, cursor, limit);
+    });
+}
 
-        if (itemId) {
-            m_db.updateItemHeaders(*itemId, item->title(), authorName, item->link());
-            if (date > 0) {
-                m_db.updateItemDate(*itemId, date);
-            }
-            if (!content.isEmpty()) {
-                m_db.updateItemContent(*itemId, content);
-            }
+Future<ArticleRows> *StorageImpl::getUnreadRowsByFeed(FeedImpl *feed, const ArticleRows::Row &after, int limit)
+{
+    const qint64 feedId{feed->id()};
+    const ItemCursor cursor{itemCursor(after)};
+    return readRows([feedId, cursor, limit](FeedDatabase &db) {
+        return db.unreadFeedItemRows(feedId, cursor, limit);
+    });
+}
 
-            // TODO this  sometimes creates an unnecessary item instance
-            getById(*itemId); // push the update into any existing item instance
+static ItemRecord itemRecord(const ParsedItem &item)
+{
+    return {item.id, item.title, item.author, item.url, item.date, item.content};
+}
 
-            op->setResult();
-            return;
-        }
+static QStringList localIds(const QVector<ItemRecord> &records)
+{
+    QStringList result;
+    result.reserve(records.size());
+    for (const auto &record : records) {
+        result << record.localId;
+    }
+    return result;
+}
 
-        if (date == 0) {
-            date = QDateTime::currentSecsSinceEpoch();
+static StoredItems storeItems(FeedDatabase &db, qint64 feedId, const QVector<ItemRecord> &records)
+{
+    if (!db.transaction()) {
+        return {};
+    }
+    // rowids are allocated in increasing order, so anything above this was inserted by the upsert
+    const qint64 lastExistingId{db.selectMaxItemId()};
+    StoredItems stored;
+    QVector<ItemRecord> changed;
+    for (int i = 0; i < records.size(); i += FeedDatabase::maxBatchSize) {
+        const auto &batch = records.mid(i, FeedDatabase::maxBatchSize);
+        const auto &fingerprints = db.selectItemFingerprints(feedId, localIds(batch));
+        QVector<ItemRecord> changedBatch;
+        for (const auto &record : batch) {
+            const auto &it = fingerprints.constFind(record.localId);
+            if (it != fingerprints.constEnd() && *it == FeedDatabase::fingerprint(record)) {
+                ++stored.skipped;
+            } else {
+                changedBatch.append(record);
+            }
         }
-        const auto &newId = m_db.insertItem(feedId, item->id(), item->title(), authorName, date, item->link(), content);
-        if (!newId) {
-            op->setResult();
-            return;
+        if (!db.upsertItems(feedId, changedBatch)) {
+            db.rollback();
+            return {};
         }
-        ItemQuery result{m_db.selectItem(*newId)};
-        appendArticleResults(op, result);
-    });
+        changed += changedBatch;
+    }
+    if (!db.commit()) {
+        db.rollback();
+        return {};
+    }
+
+    for (int i = 0; i < changed.size(); i += FeedDatabase::maxBatchSize) {
+        ItemQuery result{db.selectItems(feedId, localIds(changed.mid(i, FeedDatabase::maxBatchSize)))};
+        while (result.next()) {
+            if (result.id() > lastExistingId) {
+                stored.inserted.append(result.row());
+            } else {
+                stored.updated.append(result.row());
+            }
+        }
+    }
+    stored.ok = true;
+    stored.postingInterval = db.selectPostingInterval(feedId, QDateTime::currentSecsSinceEpoch());
+    return stored;
+}
+
+Future<StoredArticles> *StorageImpl::storeArticles(FeedImpl *feed, const QVector<ParsedItem> &items)
+{
+    const qint64 feedId{feed->id()};
+    QVector<ItemRecord> records;
+    records.reserve(items.size());
+    for (const auto &item : items) {
+        records.append(itemRecord(item));
+    }
+    return writeItems<StoredArticles>(
+        [feedId, records](FeedDatabase &db) {
+            return storeItems(db, feedId, records);
+        },
+        [this, feedId](auto *op, const StoredItems &stored) {
+            StoredArticles result{stored.ok, {}, stored.updated.size(), stored.skipped};
+            for (const auto &row : stored.inserted) {
+                auto *itemFeed = m_feedFactory.getInstance(row.feed, this);
+                result.added.append(m_articleFactory.getInstance(row.id, this, itemFeed, row));
+            }
+            for (const auto &row : stored.updated) {
+                // push the update into the existing item instance
+                if (const auto &existing = m_articleFactory.find(row.id)) {
+                    existing->updateHeaders(row);
+                }
+            }
+            if (stored.postingInterval > 0) {
+                if (auto *storedFeed = m_feedFactory.find(feedId)) {
+                    storedFeed->setPostingInterval(stored.postingInterval);
+                }
+            }
+            op->setResult(result);
+        });
 }
 
 FeedCore::Future<QString> *StorageImpl::getContent(ArticleImpl *article)
 {
     qint64 id = article->id();
-    return Future<QString>::yield(this, [this, id](auto *op) {
-        op->appendResult(m_db.selectItemContent(id));
-    });
+    return read<QString>(
+        false,
+        [id](FeedDatabase &db) {
+            return decompressContent(db.selectItemContent(id));
+        },
+        [](auto *op, const QString &content) {
+            op->appendResult(content);
+        });
 }
 
 void StorageImpl::onArticleReadChanged(ArticleImpl *article)
 {
-    const qint64 itemId{article->id()};
-    const bool isRead{article->isRead()};
-    m_db.updateItemRead(itemId, isRead);
+    m_buffer.setItemRead(article->id(), article->isRead());
+    scheduleBufferedWrites();
 }
 
 void StorageImpl::onArticleStarredChanged(ArticleImpl *article)
 {
-    const qint64 itemId{article->id()};
-    const bool isStarred{article->isStarred()};
-    m_db.updateItemStarred(itemId, isStarred);
+    m_buffer.setItemStarred(article->id(), article->isStarred());
+    scheduleBufferedWrites();
 }
 
-void StorageImpl::appendFeedResults(Future<Feed *> *op, FeedQuery &q)
+using FlagChanges = std::optional<QVector<ItemFlagChange>>;
+
+// bulk updates run in a transaction, so that the list of changed items matches what was written
+static QVector<ItemFlagChange> updateInTransaction(FeedDatabase &db, const std::function<FlagChanges()> &update)
 {
-    while (q.next()) {
-        auto *ref = m_feedFactory.getInstance(q.id(), this);
-        ref->updateFromQuery(q);
+    if (!db.transaction()) {
+        return {};
+    }
+    const auto &changed = update();
+    if (!changed || !db.commit()) {
+        db.rollback();
+        return {};
+    }
+    return *changed;
+}
+
+// split an id list into batches that fit in one statement each
+static FlagChanges updateInBatches(FeedDatabase &db, FlagChanges (FeedDatabase::*update)(const QVector<qint64> &, bool), const QVector<qint64> &ids, bool value)
+{
+    QVector<ItemFlagChange> changed;
+    for (int i = 0; i < ids.size(); i += FeedDatabase::maxBatchSize) {
+        const auto &batch = (db.*update)(ids.mid(i, FeedDatabase::maxBatchSize), value);
+        if (!batch) {
+            return std::nullopt;
+        }
+        changed += *batch;
+    }
+    return changed;
+}
+
+static qint64 dateLimit(const QDateTime &upTo)
+{
+    return upTo.isValid() ? upTo.toSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+}
+
+static QVector<qint64> articleIds(const QVector<ArticleRef> &articles)
+{
+    QVector<qint64> ids;
+    ids.reserve(articles.size());
+    for (const auto &article : articles) {
+        if (const auto *articleImpl = qobject_cast<const ArticleImpl *>(article.get())) {
+            ids.append(articleImpl->id());
+        }
+    }
+    return ids;
+}
+
+Future<qint64> *StorageImpl::updateReadInBulk(const std::function<FlagChanges(FeedDatabase &)> &update, bool isRead)
+{
+    return writeItems<qint64>(
+        [update](FeedDatabase &db) {
+            return updateInTransaction(db, [&db, &update] {
+                return update(db);
+            });
+        },
+        [this, isRead](auto *op, const QVector<ItemFlagChange> &changed) {
+            // one unread count change per feed, rather than one per article
+            QHash<qint64, int> unreadDeltas;
+            for (const auto &item : changed) {
+                unreadDeltas[item.feed] += isRead ? -1 : 1;
+                if (const auto &article = m_articleFactory.find(item.id)) {
+                    article->updateRead(isRead);
+                }
+            }
+            for (auto it = unreadDeltas.constBegin(); it != unreadDeltas.constEnd(); ++it) {
+                if (auto *feed = m_feedFactory.find(it.key())) {
+                    feed->onArticlesReadChanged(it.value());
+                }
+            }
+            op->setResult(qint64(changed.size()));
+        });
+}
+
+Future<qint64> *StorageImpl::markRead(const QVector<ArticleRef> &articles, bool isRead)
+{
+    const QVector<qint64> &ids{articleIds(articles)};
+    return updateReadInBulk(
+        [ids, isRead](FeedDatabase &db) {
+            return updateInBatches(db, &FeedDatabase::updateItemsRead, ids, isRead);
+        },
+        isRead);
+}
+
+Future<qint64> *StorageImpl::markStarred(const QVector<ArticleRef> &articles, bool isStarred)
+{
+    const QVector<qint64> &ids{articleIds(articles)};
+    return writeItems<qint64>(
+        [ids, isStarred](FeedDatabase &db) {
+            return updateInTransaction(db, [&db, &ids, isStarred] {
+                return updateInBatches(db, &FeedDatabase::updateItemsStarred, ids, isStarred);
+            });
+        },
+        [this, isStarred](auto *op, const QVector<ItemFlagChange> &changed) {
+            for (const auto &item : changed) {
+                if (const auto &article = m_articleFactory.find(item.id)) {
+                    article->updateStarred(isStarred);
+                }
+            }
+            op->setResult(qint64(changed.size()));
+        });
+}
+
+Future<qint64> *StorageImpl::markFeedRead(Feed *feed, const QDateTime &upTo)
+{
+    auto *feedImpl = qobject_cast<FeedImpl *>(feed);
+    if (feedImpl == nullptr) {
+        return Storage::markFeedRead(feed, upTo);
+    }
+    const qint64 feedId{feedImpl->id()};
+    const qint64 limit{dateLimit(upTo)};
+    return updateReadInBulk(
+        [feedId, limit](FeedDatabase &db) {
+            return db.updateFeedItemsRead(feedId, limit);
+        },
+        true);
+}
+
+Future<qint64> *StorageImpl::markAllRead(const QDateTime &upTo)
+{
+    const qint64 limit{dateLimit(upTo)};
+    return updateReadInBulk(
+        [limit](FeedDatabase &db) {
+            return db.updateAllItemsRead(limit);
+        },
+        true);
+}
+
+void StorageImpl::appendFeedResults(Future<Feed *> *op, const QVector<FeedRow> &rows)
+{
+    for (const auto &row : rows) {
+        auto *ref = m_feedFactory.getInstance(row.id, this);
+        ref->updateFromRow(row);
         op->appendResult(ref);
     }
 }
 
 Future<Feed *> *StorageImpl::getFeeds()
 {
-    return Future<Feed *>::yield(this, [this](auto *op) {
-        FeedQuery q{m_db.selectAllFeeds()};
-        appendFeedResults(op, q);
-    });
+    return read<Feed *>(
+        false,
+        [](FeedDatabase &db) {
+            return db.allFeedRows();
+        },
+        [this](auto *op, const QVector<FeedRow> &rows) {
+            appendFeedResults(op, rows);
+        });
 }
 
 static qint64 packModeValue(Feed::UpdateMode mode, qint64 value)
@@ -180,6 +665,9 @@ static qint64 packModeValue(Feed::UpdateMode mode, qint64 value)
     case Feed::DisableUpdateMode:
         return -1;
 
+    case Feed::AdaptiveUpdateMode:
+        return adaptiveUpdateInterval;
+
     case Feed::OverrideUpdateMode:
         return value;
     }
@@ -202,88 +690,215 @@ Future<Feed *> *StorageImpl::storeFeed(Feed *feed)
     const QString &category = feed->category();
     const qint64 updateInterval = packFeedUpdateInterval(feed);
     const qint64 expireAge = packFeedExpireAge(feed);
-    return Future<Feed *>::yield(this, [this, url, name, category, updateInterval, expireAge](auto *op) {
-        const auto &insertId = m_db.insertFeed(url);
-        if (!insertId) {
-            op->setResult();
-            return;
-        }
-        m_db.updateFeedUpdateInterval(*insertId, updateInterval);
-        m_db.updateFeedExpireAge(*insertId, expireAge);
-        m_db.updateFeedName(*insertId, name);
-        m_db.updateFeedCategory(*insertId, category);
-        FeedQuery result{m_db.selectFeed(*insertId)};
-        appendFeedResults(op, result);
-    });
+    return write<Feed *>(
+        [url, name, category, updateInterval, expireAge](FeedDatabase &db) -> QVector<FeedRow> {
+            const auto &insertId = db.insertFeed(url);
+            if (!insertId) {
+                return {};
+            }
+            db.updateFeedUpdateInterval(*insertId, updateInterval);
+            db.updateFeedExpireAge(*insertId, expireAge);
+            db.updateFeedName(*insertId, name);
+            db.updateFeedCategory(*insertId, category);
+            return db.feedRows(*insertId);
+        },
+        [this](auto *op, const QVector<FeedRow> &rows) {
+            appendFeedResults(op, rows);
+        });
 }
 
-static void onUpdateModeChanged(FeedDatabase &db, Feed *feed, qint64 feedId)
+static void onUpdateModeChanged(WriteBuffer &buffer, Feed *feed, qint64 feedId)
 {
-    qint64 updateInterval = packFeedUpdateInterval(feed);
-    db.updateFeedUpdateInterval(feedId, updateInterval);
+    buffer.feed(feedId).updateInterval = packFeedUpdateInterval(feed);
 }
 
-static void onUpdateIntervalChanged(FeedDatabase &db, Feed *feed, qint64 feedId)
+static bool onUpdateIntervalChanged(WriteBuffer &buffer, Feed *feed, qint64 feedId)
 {
     if (feed->updateMode() != Feed::OverrideUpdateMode) {
-        return;
+        return false;
     }
-    db.updateFeedUpdateInterval(feedId, feed->updateInterval());
+    buffer.feed(feedId).updateInterval = feed->updateInterval();
+    return true;
 }
 
-static void onExpireModeChanged(FeedDatabase &db, FeedImpl *feed)
+static void onExpireModeChanged(WriteBuffer &buffer, FeedImpl *feed)
 {
-    qint64 expireAge = packFeedExpireAge(feed);
-    db.updateFeedExpireAge(feed->id(), expireAge);
+    buffer.feed(feed->id()).expireAge = packFeedExpireAge(feed);
 }
 
-static void onExpireAgeChanged(FeedDatabase &db, FeedImpl *feed)
+static bool onExpireAgeChanged(WriteBuffer &buffer, FeedImpl *feed)
 {
     if (feed->expireMode() != Feed::OverrideUpdateMode) {
-        return;
+        return false;
     }
-    db.updateFeedExpireAge(feed->id(), feed->expireAge());
+    buffer.feed(feed->id()).expireAge = feed->expireAge();
+    return true;
 }
 
 void StorageImpl::listenForChanges(FeedImpl *feed)
 {
     qint64 feedId = feed->id();
     QObject::connect(feed, &Feed::lastUpdateChanged, this, [this, feed, feedId] {
-        m_db.updateFeedLastUpdate(feedId, feed->lastUpdate());
+        m_buffer.feed(feedId).lastUpdate = feed->lastUpdate();
+        scheduleBufferedWrites();
     });
     QObject::connect(feed, &Feed::updateIntervalChanged, this, [this, feed, feedId] {
-        onUpdateIntervalChanged(m_db, feed, feedId);
+        if (onUpdateIntervalChanged(m_buffer, feed, feedId)) {
+            scheduleBufferedWrites();
+        }
     });
     QObject::connect(feed, &Feed::updateModeChanged, this, [this, feed, feedId] {
-        onUpdateModeChanged(m_db, feed, feedId);
+        onUpdateModeChanged(m_buffer, feed, feedId);
+        scheduleBufferedWrites();
     });
     QObject::connect(feed, &Feed::expireModeChanged, this, [this, feed] {
-        onExpireModeChanged(m_db, feed);
+        onExpireModeChanged(m_buffer, feed);
+        scheduleBufferedWrites();
     });
     QObject::connect(feed, &Feed::expireAgeChanged, this, [this, feed] {
-        onExpireAgeChanged(m_db, feed);
+        if (onExpireAgeChanged(m_buffer, feed)) {
+            scheduleBufferedWrites();
+        }
+    });
+    QObject::connect(feed, &Feed::nameChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).name = feed->name();
+        scheduleBufferedWrites();
+    });
+    QObject::connect(feed, &Feed::urlChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).url = feed->url();
+        scheduleBufferedWrites();
     });
-    QObject::connect(feed, &Feed::nameChanged, this, [this, feed] {
-        m_db.updateFeedName(feed->id(), feed->name());
+    QObject::connect(feed, &Feed::httpCacheChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).httpCache = feed->httpCache();
+        scheduleBufferedWrites();
     });
-    QObject::connect(feed, &Feed::urlChanged, this, [this, feed] {
-        m_db.updateFeedUrl(feed->id(), feed->url());
+    QObject::connect(feed, &Feed::failureCountChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).failureCount = feed->failureCount();
+        scheduleBufferedWrites();
     });
-    QObject::connect(feed, &Feed::categoryChanged, this, [this, feed] {
-        m_db.updateFeedCategory(feed->id(), feed->category());
+    QObject::connect(feed, &Feed::lastFailureChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).lastFailure = feed->lastFailure();
+        scheduleBufferedWrites();
     });
-    QObject::connect(feed, &Feed::linkChanged, this, [this, feed] {
-        m_db.updateFeedLink(feed->id(), feed->link().toString());
+    QObject::connect(feed, &Feed::categoryChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).category = feed->category();
+        scheduleBufferedWrites();
     });
-    QObject::connect(feed, &Feed::iconChanged, this, [this, feed] {
-        m_db.updateFeedIcon(feed->id(), feed->icon().toString());
+    QObject::connect(feed, &Feed::linkChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).link = feed->link().toString();
+        scheduleBufferedWrites();
+    });
+    QObject::connect(feed, &Feed::iconChanged, this, [this, feed, feedId] {
+        m_buffer.feed(feedId).icon = feed->icon().toString();
+        scheduleBufferedWrites();
     });
     QObject::connect(feed, &Feed::deleteRequested, this, [this, feed] {
         onFeedRequestDelete(feed);
     });
 }
 
-void StorageImpl::expire(FeedImpl *feed, const QDateTime &olderThan)
+// bounds on the work done by one maintenance write
+static constexpr int expiryBatchSize{500};
+static constexpr int vacuumBatchSize{256};
+
+struct StorageImpl::Maintenance {
+    Future<qint64> *op{nullptr};
+    QDateTime now;
+    qint64 defaultExpireAge{0};
+    qint64 deleted{0};
+};
+
+FactoryStats StorageImpl::articleCacheStats() const
+{
+    return m_articleFactory.stats();
+}
+
+const DatabaseUpgrade &StorageImpl::databaseUpgrade() const
+{
+    return m_databaseUpgrade;
+}
+
+Future<qint64> *StorageImpl::runMaintenance(qint64 defaultExpireAge)
+{
+    auto maintenance = std::make_shared<Maintenance>();
+    maintenance->op = new Future<qint64>;
+    maintenance->now = QDateTime::currentDateTime();
+    maintenance->defaultExpireAge = defaultExpireAge;
+    expireStep(maintenance);
+    return maintenance->op;
+}
+
+void StorageImpl::expireStep(const std::shared_ptr<Maintenance> &maintenance)
+{
+    const QDateTime now{maintenance->now};
+    const qint64 defaultExpireAge{maintenance->defaultExpireAge};
+    writeItems<qint64>(
+        [now, defaultExpireAge](FeedDatabase &db) -> ExpiredItems {
+            if (!db.transaction()) {
+                return {};
+            }
+            const auto &expired = db.deleteExpiredItems(now, defaultExpireAge, expiryBatchSize);
+            if (!expired || !db.commit()) {
+                db.rollback();
+                return {};
+            }
+            return *expired;
+        },
+        [this, maintenance](auto * /*unused*/, const ExpiredItems &expired) {
+            for (auto it = expired.unreadByFeed.constBegin(); it != expired.unreadByFeed.constEnd(); ++it) {
+                if (auto *feed = m_feedFactory.find(it.key())) {
+                    feed->onArticlesReadChanged(-it.value());
+                }
+            }
+            maintenance->deleted += expired.deleted;
+            if (expired.deleted >= expiryBatchSize) {
+                expireStep(maintenance);
+            } else {
+                vacuumStep(maintenance);
+            }
+        });
+}
+
+void StorageImpl::vacuumStep(const std::shared_ptr<Maintenance> &maintenance)
 {
-    m_db.deleteItemsOlderThan(feed->id(), olderThan);
+    write<qint64>(
+        [](FeedDatabase &db) {
+            const qint64 freePages{db.freePageCount()};
+            if (!db.incrementalVacuum(vacuumBatchSize)) {
+                return qint64(0);
+            }
+            return freePages - db.freePageCount();
+        },
+        [this, maintenance](auto * /*unused*/, qint64 reclaimed) {
+            if (reclaimed >= vacuumBatchSize) {
+                vacuumStep(maintenance);
+            } else {
+                finishMaintenance(maintenance);
+            }
+        });
+}
+
+void StorageImpl::finishMaintenance(const std::shared_ptr<Maintenance> &maintenance)
+{
+    write<qint64>(
+        [](FeedDatabase &db) {
+            QVector<FeedRow> rebuilt;
+            if (!db.checkUnreadCounts() && db.rebuildUnreadCounts()) {
+                rebuilt = db.allFeedRows();
+            }
+            db.optimize();
+            return rebuilt;
+        },
+        [this, maintenance](auto * /*unused*/, const QVector<FeedRow> &rebuilt) {
+            for (const auto &row : rebuilt) {
+                if (auto *feed = m_feedFactory.find(row.id)) {
+                    feed->updateFromRow(row);
+                }
+            }
+            m_articleFactory.purge();
+            auto *op = maintenance->op;
+            op->setResult(maintenance->deleted);
+            emit op->finished();
+            delete op;
+        });
 }
@@ -8,21 +8,36 @@
 #include "factory.h"
 #include "feeddatabase.h"
 #include "storage.h"
+#include "writebuffer.h"
+#include <QTimer>
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace SqliteStorage
 {
 class FeedImpl;
 class ArticleImpl;
+class DatabaseThread;
 
+/**
+ * Storage backed by an SQLite database.
+ *
+ * All queries run on dedicated database threads.  Results are delivered back to the
+ * thread that owns the StorageImpl, where the Feed and Article objects are created.
+ */
 class StorageImpl : public FeedCore::Storage
 {
     Q_OBJECT
 public:
-    explicit StorageImpl(const QString &filePath);
+    explicit StorageImpl(const QString &filePath, const DatabaseOptions &options = {});
+    ~StorageImpl();
     FeedCore::Future<FeedCore::ArticleRef> *getById(qint64 id);
-    FeedCore::Future<FeedCore::ArticleRef> *getByFeed(FeedImpl *feedId);
-    FeedCore::Future<FeedCore::ArticleRef> *getUnreadByFeed(FeedImpl *feedId);
-    FeedCore::Future<FeedCore::ArticleRef> *storeArticle(FeedImpl *feed, const Syndication::ItemPtr &item);
+    FeedCore::Future<FeedCore::ArticleRef> *getByFeed(FeedImpl *feedId, const FeedCore::ArticleRef &after = {}, int limit = -1);
+    FeedCore::Future<FeedCore::ArticleRef> *getUnreadByFeed(FeedImpl *feedId, const FeedCore::ArticleRef &after = {}, int limit = -1);
+    FeedCore::Future<FeedCore::ArticleRows> *getRowsByFeed(FeedImpl *feed, const FeedCore::ArticleRows::Row &after, int limit);
+    FeedCore::Future<FeedCore::ArticleRows> *getUnreadRowsByFeed(FeedImpl *feed, const FeedCore::ArticleRows::Row &after, int limit);
+    FeedCore::Future<FeedCore::StoredArticles> *storeArticles(FeedImpl *feed, const QVector<FeedCore::ParsedItem> &items);
     FeedCore::Future<QString> *getContent(ArticleImpl *article);
     void onArticleReadChanged(ArticleImpl *article);
     void onArticleStarredChanged(ArticleImpl *article);
@@ -30,18 +45,110 @@ public:
     FeedCore::Future<FeedCore::ArticleRef> *getAll() final;
     FeedCore::Future<FeedCore::ArticleRef> *getUnread() final;
     FeedCore::Future<FeedCore::ArticleRef> *getStarred() final;
+    FeedCore::Future<FeedCore::ArticleRef> *getAllPage(const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getUnreadPage(const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRef> *getStarredPage(const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRef> *search(const QString &query, const FeedCore::ArticleRef &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getAllRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getUnreadRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *getStarredRows(const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<FeedCore::ArticleRows> *searchRows(const QString &query, const FeedCore::ArticleRows::Row &after, int limit) final;
+    FeedCore::Future<qint64> *markRead(const QVector<FeedCore::ArticleRef> &articles, bool isRead) final;
+    FeedCore::Future<qint64> *markStarred(const QVector<FeedCore::ArticleRef> &articles, bool isStarred) final;
+    FeedCore::Future<qint64> *markFeedRead(FeedCore::Feed *feed, const QDateTime &upTo) final;
+    FeedCore::Future<qint64> *markAllRead(const QDateTime &upTo) final;
+    FeedCore::Future<qint64> *runMaintenance(qint64 defaultExpireAge) final;
+    void flush() final;
     FeedCore::Future<FeedCore::Feed *> *getFeeds() final;
     FeedCore::Future<FeedCore::Feed *> *storeFeed(FeedCore::Feed *feed) final;
     void listenForChanges(FeedImpl *feed);
-    void expire(FeedImpl *feed, const QDateTime &olderThan);
+
+    /**
+     * Counters for the cache of article instances, for diagnostics.
+     */
+    FeedCore::FactoryStats articleCacheStats() const;
+
+    /**
+     * What opening the database did, such as the size it saved when an old schema was
+     * upgraded.  This is empty until the upgrade has finished.
+     */
+    const DatabaseUpgrade &databaseUpgrade() const;
 
 private:
-    FeedDatabase m_db;
+    std::unique_ptr<DatabaseThread> m_writer;
+    std::vector<std::unique_ptr<DatabaseThread>> m_readers;
+    size_t m_nextReader{0};
+    DatabaseUpgrade m_databaseUpgrade;
     FeedCore::ObjectFactory<qint64, FeedImpl> m_feedFactory;
     FeedCore::SharedFactory<qint64, ArticleImpl> m_articleFactory;
-    void appendFeedResults(FeedCore::Future<FeedCore::Feed *> *op, FeedQuery &q);
-    void appendArticleResults(FeedCore::Future<FeedCore::ArticleRef> *op, ItemQuery &q);
+
+    /**
+     * Flag toggles and feed property changes wait here briefly, so that bursts of them
+     * become one transaction.  The buffer is written before any other query is queued, so
+     * writes always see the buffered changes.
+     */
+    WriteBuffer m_buffer;
+    QTimer m_bufferTimer;
+    quint64 m_itemTicket{0}; /** < the writer ticket of the last write that changed items, including buffer flushes */
+    void scheduleBufferedWrites();
+    void postBufferedWrites();
+
+    /**
+     * Run /query/ on a database thread, then pass its result to /deliver/ on this object's thread
+     * before the returned future finishes.  The job's ticket is stored in /ticket/ if it is given.
+     */
+    template<typename T, typename Query, typename Deliver>
+    FeedCore::Future<T> *run(DatabaseThread &thread, quint64 after, Query query, Deliver deliver, quint64 *ticket = nullptr);
+
+    /**
+     * Run /query/ on a read connection, where it sees the last committed snapshot.  If
+     * /afterItemWrites/ is set, it first waits for every write that changed items and was
+     * queued before it; other reads don't wait for queued writes.
+     */
+    template<typename T, typename Query, typename Deliver>
+    FeedCore::Future<T> *read(bool afterItemWrites, Query query, Deliver deliver);
+    template<typename T, typename Query, typename Deliver>
+    FeedCore::Future<T> *write(Query query, Deliver deliver);
+
+    /**
+     * Like write, for writes that add, remove or change items.  Article reads wait for these.
+     */
+    template<typename T, typename Query, typename Deliver>
+    FeedCore::Future<T> *writeItems(Query query, Deliver deliver);
+    template<typename Query>
+    FeedCore::Future<FeedCore::ArticleRef> *readArticles(Query query);
+
+    /**
+     * Like readArticles, but the rows are returned without creating the articles.
+     */
+    template<typename Query>
+    FeedCore::Future<FeedCore::ArticleRows> *readRows(Query query);
+    class RowSource;
+    std::shared_ptr<RowSource> m_rowSource;
+    FeedCore::ArticleRef rowArticle(const FeedCore::ArticleRows::Row &row);
+
+    /**
+     * Queue a write that does not return a result.  Article reads wait for it.
+     */
+    void post(const std::function<void(FeedDatabase &)> &job);
+
+    void appendFeedResults(FeedCore::Future<FeedCore::Feed *> *op, const QVector<FeedRow> &rows);
+    void appendArticleResults(FeedCore::Future<FeedCore::ArticleRef> *op, const QVector<ItemRow> &rows);
+
+    /**
+     * Run a bulk read status update, then apply it to the loaded articles and feeds.
+     */
+    FeedCore::Future<qint64> *updateReadInBulk(const std::function<std::optional<QVector<ItemFlagChange>>(FeedDatabase &)> &update, bool isRead);
     void onFeedRequestDelete(FeedImpl *feed);
+
+    /**
+     * The maintenance steps each run as a separate write, so that other writes are not
+     * held up for long.  Each step queues the next one when its result is delivered.
+     */
+    struct Maintenance;
+    void expireStep(const std::shared_ptr<Maintenance> &maintenance);
+    void vacuumStep(const std::shared_ptr<Maintenance> &maintenance);
+    void finishMaintenance(const std::shared_ptr<Maintenance> &maintenance);
 };
 }
 #endif // SQLITE_STORAGEIMPL_H
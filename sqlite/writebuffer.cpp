@@ -0,0 +1,89 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sqlite/writebuffer.h"
+#include <utility>
+
+using namespace SqliteStorage;
+
+void WriteBuffer::setItemRead(qint64 id, bool isRead)
+{
+    m_read.insert(id, isRead);
+}
+
+void WriteBuffer::setItemStarred(qint64 id, bool isStarred)
+{
+    m_starred.insert(id, isStarred);
+}
+
+WriteBuffer::FeedChanges &WriteBuffer::feed(qint64 feedId)
+{
+    return m_feeds[feedId];
+}
+
+bool WriteBuffer::isEmpty() const
+{
+    return m_read.isEmpty() && m_starred.isEmpty() && m_feeds.isEmpty();
+}
+
+static void writeFeedChanges(FeedDatabase &db, qint64 feedId, const WriteBuffer::FeedChanges &changes)
+{
+    if (changes.name) {
+        db.updateFeedName(feedId, *changes.name);
+    }
+    if (changes.url) {
+        db.updateFeedUrl(feedId, *changes.url);
+    }
+    if (changes.category) {
+        db.updateFeedCategory(feedId, *changes.category);
+    }
+    if (changes.link) {
+        db.updateFeedLink(feedId, *changes.link);
+    }
+    if (changes.icon) {
+        db.updateFeedIcon(feedId, *changes.icon);
+    }
+    if (changes.updateInterval) {
+        db.updateFeedUpdateInterval(feedId, *changes.updateInterval);
+    }
+    if (changes.lastUpdate) {
+        db.updateFeedLastUpdate(feedId, *changes.lastUpdate);
+    }
+    if (changes.expireAge) {
+        db.updateFeedExpireAge(feedId, *changes.expireAge);
+    }
+    if (changes.httpCache) {
+        db.updateFeedHttpCache(feedId, changes.httpCache->etag, changes.httpCache->lastModified, changes.httpCache->expires);
+    }
+    if (changes.failureCount) {
+        db.updateFeedFailureCount(feedId, *changes.failureCount);
+    }
+    if (changes.lastFailure) {
+        db.updateFeedLastFailure(feedId, *changes.lastFailure);
+    }
+}
+
+DatabaseThread::Job WriteBuffer::take()
+{
+    const QHash<qint64, bool> read{std::exchange(m_read, {})};
+    const QHash<qint64, bool> starred{std::exchange(m_starred, {})};
+    const QHash<qint64, FeedChanges> feeds{std::exchange(m_feeds, {})};
+    return [read, starred, feeds](FeedDatabase &db) {
+        // if the transaction can't start, each update still commits on its own
+        const bool inTransaction{db.transaction()};
+        for (auto it = read.constBegin(); it != read.constEnd(); ++it) {
+            db.updateItemRead(it.key(), it.value());
+        }
+        for (auto it = starred.constBegin(); it != starred.constEnd(); ++it) {
+            db.updateItemStarred(it.key(), it.value());
+        }
+        for (auto it = feeds.constBegin(); it != feeds.constEnd(); ++it) {
+            writeFeedChanges(db, it.key(), it.value());
+        }
+        if (inTransaction && !db.commit()) {
+            db.rollback();
+        }
+    };
+}
@@ -0,0 +1,59 @@
+/**
+ * SPDX-FileCopyrightText: 2021 Connor Carney <hello@connorcarney.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SQLITE_WRITEBUFFER_H
+#define SQLITE_WRITEBUFFER_H
+#include "feed.h"
+#include "sqlite/databasethread.h"
+#include <QDateTime>
+#include <QHash>
+#include <QUrl>
+#include <optional>
+
+namespace SqliteStorage
+{
+/**
+ * Collects single-row updates so that they can be written together.
+ *
+ * Changing the same column of the same row again replaces the earlier value, so each
+ * column is written at most once however often it changed.
+ */
+class WriteBuffer
+{
+public:
+    /**
+     * The columns of one feed that have changed since the last write.
+     */
+    struct FeedChanges {
+        std::optional<QString> name;
+        std::optional<QUrl> url;
+        std::optional<QString> category;
+        std::optional<QString> link;
+        std::optional<QString> icon;
+        std::optional<qint64> updateInterval;
+        std::optional<QDateTime> lastUpdate;
+        std::optional<qint64> expireAge;
+        std::optional<FeedCore::Feed::HttpCache> httpCache;
+        std::optional<int> failureCount;
+        std::optional<QDateTime> lastFailure;
+    };
+
+    void setItemRead(qint64 id, bool isRead);
+    void setItemStarred(qint64 id, bool isStarred);
+    FeedChanges &feed(qint64 feedId);
+    bool isEmpty() const;
+
+    /**
+     * Empty the buffer, and return a job that writes its contents in one transaction.
+     */
+    DatabaseThread::Job take();
+
+private:
+    QHash<qint64, bool> m_read;
+    QHash<qint64, bool> m_starred;
+    QHash<qint64, FeedChanges> m_feeds;
+};
+}
+#endif // SQLITE_WRITEBUFFER_H
@@ -5,6 +5,7 @@
 
 #include "application.h"
 #include "cmake-config.h"
+#include <QCommandLineParser>
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
@@ -23,11 +24,13 @@
 #include "context.h"
 #include "feedlistmodel.h"
 #include "iconprovider.h"
+#include "memorystorage/storageimpl.h"
 #include "networkaccessmanagerfactory.h"
 #include "notificationcontroller.h"
 #include "platformhelper.h"
 #include "provisionalfeed.h"
 #include "qmlarticleref.h"
+#include "searchfeed.h"
 #include "settings.h"
 #include "sqlite/storageimpl.h"
 
@@ -52,10 +55,36 @@ static QString filePath(QString const &fileName)
     return appDataDir.filePath(fileName);
 }
 
-static FeedCore::Context *createContext(QObject *parent = nullptr)
+static SqliteStorage::DatabaseOptions databaseOptions(const Settings &settings)
 {
+    SqliteStorage::DatabaseOptions options;
+    options.walMode = settings.walMode();
+    options.readConnections = settings.readConnections();
+    options.synchronous = settings.synchronous();
+    options.cacheSize = settings.cacheSize();
+    options.mmapSize = settings.mmapSize();
+    options.busyTimeout = settings.busyTimeout();
+    options.nativeReads = settings.nativeReads();
+    return options;
+}
+
+static bool ephemeralRequested(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    const QCommandLineOption ephemeral("ephemeral", "Keep feeds and articles in memory only, and discard them on exit.");
+    parser.addOption(ephemeral);
+    // other options are handled elsewhere, so unknown options are not an error here
+    parser.parse(arguments);
+    return parser.isSet(ephemeral);
+}
+
+static FeedCore::Context *createContext(const Settings &settings, bool ephemeral, QObject *parent = nullptr)
+{
+    if (ephemeral) {
+        return new FeedCore::Context(new MemoryStorage::StorageImpl, parent);
+    }
     QString dbPath = filePath("feeds.db");
-    auto *fm = new SqliteStorage::StorageImpl(dbPath); // ownership passes to context
+    auto *fm = new SqliteStorage::StorageImpl(dbPath, databaseOptions(settings)); // ownership passes to context
     return new FeedCore::Context(fm, parent);
 }
 
@@ -64,6 +93,7 @@ static void registerQmlTypes()
     qmlRegisterType<FeedListModel>("com.rocksandpaper.syndic", 1, 0, "FeedListModel");
     qmlRegisterType<ArticleListModel>("com.rocksandpaper.syndic", 1, 0, "ArticleListModel");
     qmlRegisterType<FeedCore::ProvisionalFeed>("com.rocksandpaper.syndic", 1, 0, "ProvisionalFeed");
+    qmlRegisterType<FeedCore::SearchFeed>("com.rocksandpaper.syndic", 1, 0, "SearchFeed");
     qmlRegisterType<ContentModel>("com.rocksandpaper.syndic", 1, 0, "ContentModel");
     qmlRegisterType<ContentImageItem>("com.rocksandpaper.syndic", 1, 0, "ContentImage");
     qmlRegisterUncreatableType<FeedCore::Feed::Updater>("com.rocksandpaper.syndic", 1, 0, "Updater", "abstract base class");
@@ -71,6 +101,7 @@ static void registerQmlTypes()
     qmlRegisterUncreatableType<FeedCore::Feed>("com.rocksandpaper.syndic", 1, 0, "Feed", "obtained from cpp model");
     qmlRegisterUncreatableType<FeedCore::Article>("com.rocksandpaper.syndic", 1, 0, "Article", "obtained from cpp model");
     qmlRegisterUncreatableType<QmlArticleRef>("com.rocksandpaper.syndic", 1, 0, "QmlFeedRef", "obtained from cpp model");
+    qmlRegisterUncreatableType<FeedCore::AdaptiveUpdateStats>("com.rocksandpaper.syndic", 1, 0, "AdaptiveUpdateStats", "obtained from context");
     qmlRegisterUncreatableType<PlatformHelper>("com.rocksandpaper.syndic", 1, 0, "PlatformHelper", "global object");
     qmlRegisterUncreatableType<ContentBlock>("com.rocksandpaper.syndic", 1, 0, "ContentBlock", "obtained from contentmodel");
     qmlRegisterUncreatableType<ImageBlock>("com.rocksandpaper.syndic", 1, 0, "ImageBlock", "obtained from contentmodel");
@@ -133,7 +164,9 @@ Application::Application(int &argc, char **argv)
     loadEmbeddedFonts();
 #endif
 
-    d->context = createContext(this);
+    d->context = createContext(d->settings, ephemeralRequested(arguments()), this);
+    // storage holds back small writes for a moment, so save them before the event loop stops
+    QObject::connect(this, &QCoreApplication::aboutToQuit, d->context, &FeedCore::Context::flush);
     bindContextPropertiesToSettings();
 }
 
@@ -223,6 +256,10 @@ void Application::bindContextPropertiesToSettings()
     syncDefaultUpdateInterval();
     QObject::connect(settings(), &Settings::updateIntervalChanged, this, &Application::syncDefaultUpdateInterval);
 
+    syncAdaptiveIntervalLimits();
+    QObject::connect(settings(), &Settings::minAdaptiveIntervalChanged, this, &Application::syncAdaptiveIntervalLimits);
+    QObject::connect(settings(), &Settings::maxAdaptiveIntervalChanged, this, &Application::syncAdaptiveIntervalLimits);
+
     syncAutomaticUpdates();
     QObject::connect(settings(), &Settings::automaticUpdatesChanged, this, &Application::syncAutomaticUpdates);
 
@@ -245,6 +282,12 @@ void Application::syncDefaultUpdateInterval()
     d->context->setDefaultUpdateInterval(d->settings.updateInterval());
 }
 
+void Application::syncAdaptiveIntervalLimits()
+{
+    d->context->setMinAdaptiveInterval(d->settings.minAdaptiveInterval());
+    d->context->setMaxAdaptiveInterval(d->settings.maxAdaptiveInterval());
+}
+
 void Application::syncExpireAge()
 {
     d->context->setExpireAge(d->settings.expireItems() ? d->settings.expireAge() : 0);
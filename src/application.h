@@ -44,6 +44,7 @@ private:
     void bindContextPropertiesToSettings();
     void syncAutomaticUpdates();
     void syncDefaultUpdateInterval();
+    void syncAdaptiveIntervalLimits();
     void syncExpireAge();
     void startNotifications();
 };
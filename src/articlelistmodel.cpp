@@ -7,18 +7,40 @@
 #include "articleref.h"
 #include "feed.h"
 #include "qmlarticleref.h"
+#include <QSet>
 #include <algorithm>
 
 using namespace FeedCore;
 
+static constexpr int pageSize{100};
+
 struct ArticleListModel::PrivData {
     Feed *feed{};
-    QList<QmlArticleRef> items;
+    ArticleRows items;
     bool unreadFilter{false};
     LoadStatus status{LoadStatus::Idle};
     bool active{false};
+    ArticleRows::Row cursor; /** < last row of the most recent page */
+    bool hasMore{false};
+    bool fetching{false};
+    int generation{0}; /** < incremented on refresh so that stale pages are discarded */
+    QDateTime loaded; /** < when the list was last refreshed */
+    QSet<qint64> watched; /** < rows whose article is being watched */
+    QVector<QMetaObject::Connection> connections;
+
+    void reset(const ArticleRows &rows = {});
 };
 
+void ArticleListModel::PrivData::reset(const ArticleRows &rows)
+{
+    for (const auto &connection : qAsConst(connections)) {
+        QObject::disconnect(connection);
+    }
+    connections.clear();
+    watched.clear();
+    items = rows;
+}
+
 ArticleListModel::ArticleListModel(QObject *parent)
     : QAbstractListModel(parent)
     , d{std::make_unique<PrivData>()}
@@ -38,7 +60,7 @@ void ArticleListModel::setUnreadFilter(bool unreadFilter)
             if (unreadFilter) {
                 removeRead();
             } else {
-                refreshMerge();
+                refresh();
             }
         }
         emit unreadFilterChanged();
@@ -53,26 +75,75 @@ LoadStatus ArticleListModel::status()
 void ArticleListModel::refresh()
 {
     setStatus(LoadStatus::Loading);
-    auto *q = getItems();
-    QObject::connect(q, &BaseFuture::finished, this, [this, q] {
-        onRefreshFinished(q);
+    const int generation{++d->generation};
+    d->fetching = true;
+    d->loaded = QDateTime::currentDateTime();
+    auto *q = getPage({});
+    QObject::connect(q, &BaseFuture::finished, this, [this, q, generation] {
+        if (generation == d->generation) {
+            onRefreshFinished(q);
+        }
+    });
+}
+
+bool ArticleListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && d->hasMore && !d->fetching;
+}
+
+void ArticleListModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    const int generation{d->generation};
+    d->fetching = true;
+    auto *q = getPage(d->cursor);
+    QObject::connect(q, &BaseFuture::finished, this, [this, q, generation] {
+        if (generation == d->generation) {
+            onFetchMoreFinished(q);
+        }
     });
 }
 
 void ArticleListModel::markAllRead()
 {
-    const auto &items = d->items;
-    for (const auto &item : items) {
-        item->setRead(true);
+    if (d->feed == nullptr) {
+        return;
     }
-    removeRead();
+    // this includes the pages that have not been loaded yet, but not the articles that
+    // arrived after the list was loaded, which the user has not seen
+    qint64 upTo{d->loaded.isValid() ? d->loaded.toSecsSinceEpoch() : QDateTime::currentSecsSinceEpoch()};
+    if (!d->items.isEmpty()) {
+        // a feed can date its articles in the future
+        upTo = std::max(upTo, d->items.date(0));
+    }
+    auto *q = d->feed->markAllRead(QDateTime::fromSecsSinceEpoch(upTo));
+    const int generation{d->generation};
+    QObject::connect(q, &BaseFuture::finished, this, [this, generation, upTo] {
+        // rows without an article were not updated by the storage
+        if (generation == d->generation) {
+            setAllRead(upTo);
+        }
+        removeRead();
+    });
 }
 
-ArticleListModel::~ArticleListModel() = default;
+ArticleListModel::~ArticleListModel()
+{
+    d->reset();
+}
 
 QHash<int, QByteArray> ArticleListModel::roleNames() const
 {
-    return {{Qt::UserRole, "ref"}};
+    return {
+        {RefRole, "ref"},
+        {TitleRole, "title"},
+        {AuthorRole, "author"},
+        {DateRole, "date"},
+        {ReadRole, "isRead"},
+        {StarredRole, "isStarred"},
+    };
 }
 
 void ArticleListModel::classBegin()
@@ -90,35 +161,103 @@ void ArticleListModel::componentComplete()
     });
 }
 
-void ArticleListModel::onRefreshFinished(Future<ArticleRef> *sender)
+static ArticleRows firstResult(Future<ArticleRows> *sender)
 {
+    const auto &result = sender->result();
+    return result.isEmpty() ? ArticleRows() : result.first();
+}
+
+void ArticleListModel::onRefreshFinished(Future<ArticleRows> *sender)
+{
+    const auto &rows = firstResult(sender);
     beginResetModel();
-    d->items = {};
-    for (const ArticleRef &i : sender->result()) {
-        d->items.append(QmlArticleRef(i));
-    }
+    d->reset(rows);
+    d->cursor = rows.isEmpty() ? ArticleRows::Row() : rows.row(rows.size() - 1);
+    d->hasMore = rows.size() >= pageSize;
+    d->fetching = false;
     endResetModel();
+    watchExisting(0, d->items.size() - 1);
     setStatusFromUpstream();
 }
 
-static bool compareDatesDescending(const ArticleRef &l, const ArticleRef &r)
+int ArticleListModel::indexForDate(qint64 date) const
 {
-    return l->date() > r->date();
+    // rows are newest first, so this finds the first row that is not newer than /date/
+    int low = 0;
+    int high = d->items.size();
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (d->items.date(mid) > date) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
 }
 
-static int indexForItem(const QList<QmlArticleRef> &list, const ArticleRef &item)
+int ArticleListModel::indexOfRow(qint64 id, qint64 date) const
 {
-    auto it = std::lower_bound(list.constBegin(), list.constEnd(), item, compareDatesDescending);
-    return it - list.constBegin();
+    // only rows with the same date need to be compared
+    for (int i = indexForDate(date); i < d->items.size() && d->items.date(i) == date; ++i) {
+        if (d->items.id(i) == id) {
+            return i;
+        }
+    }
+    return -1;
 }
 
-void ArticleListModel::onMergeFinished(Future<ArticleRef> *sender)
+void ArticleListModel::onFetchMoreFinished(Future<ArticleRows> *sender)
 {
+    auto page = firstResult(sender);
+    d->fetching = false;
+    d->hasMore = page.size() >= pageSize;
+    if (page.isEmpty()) {
+        return;
+    }
+    const ArticleRows::Row previousCursor{d->cursor};
+    d->cursor = page.row(page.size() - 1);
+
+    // articles added while the list was open may already be in the list; they are the only
+    // rows with local ids, and the page's copies of them must already exist
     auto &items = d->items;
-    QSet<Article *> knownItems(items.constBegin(), items.constEnd());
-    for (const auto &item : sender->result()) {
-        if (!knownItems.contains(item.get())) {
-            insertAndNotify(indexForItem(d->items, item), item);
+    QSet<Article *> addedItems;
+    for (int i = 0; i < items.size(); ++i) {
+        if (items.id(i) < 0) {
+            addedItems.insert(items.find(i).get());
+        }
+    }
+    if (!addedItems.isEmpty()) {
+        for (int i = page.size() - 1; i >= 0; --i) {
+            const auto &article = page.find(i);
+            if (!article.isNull() && addedItems.contains(article.get())) {
+                page.remove(i);
+            }
+        }
+    }
+    if (page.isEmpty()) {
+        return;
+    }
+
+    // pages that follow straight on from the previous one are appended in the order the feed
+    // returned them, which need not be by date
+    if (items.isEmpty() || items.id(items.size() - 1) == previousCursor.id || page.date(0) <= items.date(items.size() - 1)) {
+        const int first{items.size()};
+        beginInsertRows(QModelIndex(), first, first + page.size() - 1);
+        items.append(page);
+        endInsertRows();
+        watchExisting(first, items.size() - 1);
+    } else {
+        for (int i = 0; i < page.size(); ++i) {
+            const int index = indexForDate(page.date(i));
+            beginInsertRows(QModelIndex(), index, index);
+            if (page.id(i) < 0) {
+                items.insert(index, page.find(i));
+            } else {
+                items.insert(index, page.row(i));
+            }
+            endInsertRows();
+            watchExisting(index, index);
         }
     }
 }
@@ -126,7 +265,7 @@ void ArticleListModel::onMergeFinished(Future<ArticleRef> *sender)
 void ArticleListModel::onItemAdded(ArticleRef const &item)
 {
     if (!d->unreadFilter || !item->isRead()) {
-        insertAndNotify(indexForItem(d->items, item), item);
+        insertAndNotify(indexForDate(item->date().toSecsSinceEpoch()), item);
     }
 }
 
@@ -136,16 +275,42 @@ void ArticleListModel::removeRead()
         return;
     }
     auto &items = d->items;
-    for (int i = 0; i < items.size(); ++i) {
-        if (items.at(i)->isRead()) {
-            beginRemoveRows(QModelIndex(), i, i);
-            items.removeAt(i);
-            endRemoveRows();
-            --i;
+    const auto isRead = [&items](int i) {
+        const auto &article = items.find(i);
+        return article.isNull() ? items.isRead(i) : article->isRead();
+    };
+    // remove runs of read rows from the end, so that the indexes of earlier runs stay valid
+    int end = items.size();
+    while (end > 0) {
+        if (!isRead(end - 1)) {
+            --end;
+            continue;
         }
+        int begin = end - 1;
+        while (begin > 0 && isRead(begin - 1)) {
+            --begin;
+        }
+        beginRemoveRows(QModelIndex(), begin, end - 1);
+        items.remove(begin, end - begin);
+        endRemoveRows();
+        end = begin;
     }
 }
 
+void ArticleListModel::setAllRead(qint64 upTo)
+{
+    auto &items = d->items;
+    // rows are newest first, so the rows that were marked are at the end
+    const int first{indexForDate(upTo)};
+    if (first >= items.size()) {
+        return;
+    }
+    for (int i = first; i < items.size(); ++i) {
+        items.setRead(i, true);
+    }
+    emit dataChanged(index(first), index(items.size() - 1), {ReadRole});
+}
+
 void ArticleListModel::setStatus(LoadStatus status)
 {
     if (status != d->status) {
@@ -157,16 +322,9 @@ void ArticleListModel::setStatus(LoadStatus status)
 void ArticleListModel::insertAndNotify(int index, const ArticleRef &item)
 {
     beginInsertRows(QModelIndex(), index, index);
-    d->items.insert(index, QmlArticleRef(item));
+    d->items.insert(index, item);
     endInsertRows();
-}
-
-void ArticleListModel::refreshMerge()
-{
-    auto *q = getItems();
-    QObject::connect(q, &BaseFuture::finished, this, [this, q] {
-        onMergeFinished(q);
-    });
+    watch(index, item);
 }
 
 int ArticleListModel::rowCount(const QModelIndex &parent) const
@@ -178,19 +336,82 @@ int ArticleListModel::rowCount(const QModelIndex &parent) const
     return d->items.size();
 }
 
+void ArticleListModel::watch(int index, const ArticleRef &article)
+{
+    const qint64 id{d->items.id(index)};
+    if (article.isNull() || d->watched.contains(id)) {
+        return;
+    }
+    d->watched.insert(id);
+    // rows never change their date, so it finds the row again even if the article's does
+    const qint64 date{d->items.date(index)};
+    auto *item = article.get();
+    const auto onChanged = [this, id, date, item] {
+        onArticleFlagsChanged(id, date, item);
+    };
+    d->connections.append(QObject::connect(item, &Article::readStatusChanged, this, onChanged));
+    d->connections.append(QObject::connect(item, &Article::starredChanged, this, onChanged));
+}
+
+void ArticleListModel::watchExisting(int first, int last)
+{
+    for (int i = first; i <= last; ++i) {
+        watch(i, d->items.find(i));
+    }
+}
+
+QVariant ArticleListModel::articleRef(int row)
+{
+    if (row < 0 || row >= d->items.size()) {
+        return QVariant();
+    }
+    const auto &article = d->items.article(row);
+    watch(row, article);
+    return QVariant::fromValue(QmlArticleRef(article));
+}
+
+void ArticleListModel::onArticleFlagsChanged(qint64 id, qint64 date, Article *article)
+{
+    const int row = indexOfRow(id, date);
+    if (row < 0) {
+        return;
+    }
+    d->items.setRead(row, article->isRead());
+    d->items.setStarred(row, article->isStarred());
+    emit dataChanged(index(row), index(row), {ReadRole, StarredRole});
+}
+
 QVariant ArticleListModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid()) {
         return QVariant();
     }
 
-    int indexRow = index.row();
+    const int indexRow = index.row();
+    const auto &items = d->items;
 
-    if (role == Qt::UserRole) {
-        return QVariant::fromValue(QmlArticleRef(d->items[indexRow]));
+    switch (role) {
+    case RefRole:
+        // articleRef() also keeps the row's flags current
+        return QVariant::fromValue(QmlArticleRef(items.article(indexRow)));
+    case TitleRole:
+        return items.title(indexRow);
+    case AuthorRole:
+        return items.author(indexRow);
+    case DateRole:
+        return QDateTime::fromSecsSinceEpoch(items.date(indexRow));
+    case ReadRole:
+    case StarredRole: {
+        // an article that is already loaded may have changed since the row was read
+        const auto &article = items.find(indexRow);
+        if (!article.isNull()) {
+            return role == ReadRole ? article->isRead() : article->isStarred();
+        }
+        return role == ReadRole ? items.isRead(indexRow) : items.isStarred(indexRow);
+    }
+    default:
+        return QVariant();
     }
-
-    return QVariant();
 }
 
 Feed *ArticleListModel::feed() const
@@ -204,7 +425,7 @@ void ArticleListModel::setFeed(Feed *feed)
         d->feed = feed;
         if (d->active) {
             beginResetModel();
-            d->items = {};
+            d->reset();
             endResetModel();
             refresh();
         }
@@ -218,12 +439,12 @@ void ArticleListModel::requestUpdate()
     removeRead();
 }
 
-Future<ArticleRef> *ArticleListModel::getItems()
+Future<ArticleRows> *ArticleListModel::getPage(const ArticleRows::Row &after)
 {
     if (d->feed == nullptr) {
-        return Future<ArticleRef>::yield(this, [](auto /*unused*/) {});
+        return Future<ArticleRows>::yield(this, [](auto /*unused*/) {});
     }
-    return d->feed->getArticles(unreadFilter());
+    return d->feed->getArticleRows(unreadFilter(), after, pageSize);
 }
 
 void ArticleListModel::setStatusFromUpstream()
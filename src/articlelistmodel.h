@@ -6,6 +6,7 @@
 #ifndef UNREADITEMMODEL_H
 #define UNREADITEMMODEL_H
 #include "articleref.h"
+#include "articlerows.h"
 #include "feed.h"
 #include "future.h"
 #include <QModelIndex>
@@ -21,6 +22,11 @@ class Context;
  *
  * The model is tied to a single feed.  To display a combined list of feeds,
  * the model can be populated from an AllItemsFeed.
+ *
+ * Articles are loaded a page at a time; views request further pages through
+ * canFetchMore() and fetchMore() as they scroll.  The model keeps rows rather than
+ * articles, and serves the headline roles from them; an Article is only created when
+ * articleRef() or the ref role of its row is read.
  */
 class ArticleListModel : public QAbstractListModel, public QQmlParserStatus
 {
@@ -47,6 +53,16 @@ class ArticleListModel : public QAbstractListModel, public QQmlParserStatus
     Q_PROPERTY(FeedCore::Feed *feed READ feed WRITE setFeed NOTIFY feedChanged);
 
 public:
+    enum Roles {
+        RefRole = Qt::UserRole,
+        TitleRole,
+        AuthorRole,
+        DateRole,
+        ReadRole,
+        StarredRole,
+    };
+    Q_ENUM(Roles)
+
     explicit ArticleListModel(QObject *parent = nullptr);
     ~ArticleListModel();
 
@@ -56,8 +72,9 @@ public:
     Q_INVOKABLE void requestUpdate();
 
     /**
-     * Marks all of the items displayed in the list as read and removes
-     * them from the list if necessary.
+     * Marks every article in the feed as read and removes them from the
+     * list if necessary.  Articles that arrived after the list was loaded,
+     * and are newer than anything in it, are left unread.
      */
     Q_INVOKABLE void markAllRead();
 
@@ -73,11 +90,19 @@ public:
     FeedCore::LoadStatus status();
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const final;
+    bool canFetchMore(const QModelIndex &parent) const final;
+    void fetchMore(const QModelIndex &parent) final;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const final;
     QHash<int, QByteArray> roleNames() const override;
     void classBegin() override;
     void componentComplete() override;
 
+    /**
+     * The article for /row/, wrapped for QML.  Unlike the ref role, this keeps the
+     * row's flags in step with the article from then on.
+     */
+    Q_INVOKABLE QVariant articleRef(int row);
+
 signals:
     void feedChanged();
     void unreadFilterChanged();
@@ -86,15 +111,32 @@ signals:
 private:
     struct PrivData;
     std::unique_ptr<PrivData> d;
-    FeedCore::Future<FeedCore::ArticleRef> *getItems();
+    FeedCore::Future<FeedCore::ArticleRows> *getPage(const FeedCore::ArticleRows::Row &after);
     void setStatusFromUpstream();
     void setStatus(FeedCore::LoadStatus status);
     void refresh();
     void onItemAdded(const FeedCore::ArticleRef &item);
     void insertAndNotify(int index, const FeedCore::ArticleRef &item);
-    void refreshMerge();
-    void onRefreshFinished(FeedCore::Future<FeedCore::ArticleRef> *sender);
-    void onMergeFinished(FeedCore::Future<FeedCore::ArticleRef> *sender);
+    void onRefreshFinished(FeedCore::Future<FeedCore::ArticleRows> *sender);
+    void onFetchMoreFinished(FeedCore::Future<FeedCore::ArticleRows> *sender);
     void onStatusChanged();
+    int indexForDate(qint64 date) const;
+
+    /**
+     * The index of the row with /id/ and /date/, or -1.
+     */
+    int indexOfRow(qint64 id, qint64 date) const;
+
+    /**
+     * Keep the flags of the row at /index/ in step with its article.
+     */
+    void watch(int index, const FeedCore::ArticleRef &article);
+
+    /**
+     * Watch the rows from /first/ to /last/ whose articles already exist.
+     */
+    void watchExisting(int first, int last);
+    void onArticleFlagsChanged(qint64 id, qint64 date, FeedCore::Article *article);
+    void setAllRead(qint64 upTo);
 };
 #endif // UNREADITEMMODEL_H
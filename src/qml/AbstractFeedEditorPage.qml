@@ -103,6 +103,18 @@ Kirigami.ScrollablePage {
                 }
             }
 
+            RadioButton {
+                id: updateIntervalAdaptive
+                ButtonGroup.group: updateIntervalGroup
+                text: qsTr("As often as the feed posts")
+                checked: provisionalFeed.updateMode === Feed.AdaptiveUpdateMode
+                onToggled: {
+                    if (checked) {
+                        provisionalFeed.updateMode = Feed.AdaptiveUpdateMode
+                    }
+                }
+            }
+
             RadioButton {
                 id: updateIntervalDisable
                 ButtonGroup.group: updateIntervalGroup
@@ -59,7 +59,7 @@ Kirigami.ScrollablePage {
 
         delegate: Kirigami.AbstractListItem {
             width: articleList.width
-            text: ref.article.headline
+            text: model.title
             padding: 10
 
             // if we don't override this then AbstractListItem sets the height to 0 when the ListView is hidden,
@@ -67,7 +67,8 @@ Kirigami.ScrollablePage {
             height: implicitHeight
 
             contentItem: ArticleListEntry { }
-            property var data: ref
+            // reading the ref creates the article, so only do it when the item is opened
+            function articleRef() { return root.model.articleRef(model.index) }
             onClicked: {
                 if (articleList.currentIndex !== model.index) {
                     articleList.currentIndex = model.index
@@ -146,7 +147,7 @@ Kirigami.ScrollablePage {
             suspendAnimations();
         }
         if (articleList.currentItem) {
-            const data = articleList.currentItem.data
+            const data = articleList.currentItem.articleRef()
             root.pageRow.push("qrc:/qml/ArticlePage.qml", {item: data, nextItem: nextItem, previousItem: previousItem})
             data.article.isRead = true
         } else if (model && automaticOpen) {
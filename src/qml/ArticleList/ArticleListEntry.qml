@@ -18,14 +18,14 @@ ColumnLayout {
     Label {
         id: headlineText
         Layout.fillWidth: parent
-        text: ref.article.title
+        text: model.title
         maximumLineCount: 2
         horizontalAlignment: Text.AlignLeft
         verticalAlignment: Text.AlignVCenter
         elide: Text.ElideRight
         wrapMode: Text.WordWrap
         font {
-            weight: ref.article.isRead ? Font.ExtraLight : Font.Bold
+            weight: model.isRead ? Font.ExtraLight : Font.Bold
             pointSize: Kirigami.Theme.defaultFont.pointSize
         }
         color: textColor
@@ -36,7 +36,7 @@ ColumnLayout {
         id: details
         Label {
             Layout.fillWidth: true
-            text: ref.article.author
+            text: model.author
             elide: Text.ElideRight
             horizontalAlignment: Text.AlignLeft
             verticalAlignment: Text.AlignVCenter
@@ -52,7 +52,7 @@ ColumnLayout {
 
         Label {
             Layout.alignment: Qt.AlignRight
-            text: Qt.formatDate(ref.article.date)
+            text: Qt.formatDate(model.date)
             elide: Text.ElideRight
             horizontalAlignment: Text.AlignRight
             verticalAlignment: Text.AlignVCenter
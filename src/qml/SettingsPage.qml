@@ -56,6 +56,51 @@ Kirigami.ScrollablePage {
             }
         }
 
+        RowLayout {
+            Kirigami.FormData.label: qsTr("Adaptive updates:")
+            Label {
+                text: qsTr("Between")
+            }
+            SpinBox {
+                id: minAdaptiveInterval
+                value: globalSettings.minAdaptiveInterval / 60
+                from: 1
+                to: 24 * 60
+                textFromValue: (value, locale)=>qsTr("%n minute(s)", "", value)
+                valueFromText: (text, locale)=>+text.replace(/[^\d]/g, "")
+                Binding {
+                    target: globalSettings
+                    property: "minAdaptiveInterval"
+                    value: minAdaptiveInterval.value * 60
+                }
+            }
+            Label {
+                text: qsTr("and")
+            }
+            SpinBox {
+                id: maxAdaptiveInterval
+                value: globalSettings.maxAdaptiveInterval / 3600
+                from: 1
+                to: 7 * 24
+                textFromValue: (value, locale)=>qsTr("%n hour(s)", "", value)
+                valueFromText: (text, locale)=>+text.replace(/[^\d]/g, "")
+                Binding {
+                    target: globalSettings
+                    property: "maxAdaptiveInterval"
+                    value: maxAdaptiveInterval.value * 3600
+                }
+            }
+        }
+
+        Label {
+            // read when the page opens; the rates only change as feeds post
+            readonly property var stats: feedContext.adaptiveUpdateStats()
+            visible: stats.feeds > 0
+            text: qsTr("%n adaptive feed(s): %1 updates per day instead of %2", "", stats.feeds)
+                .arg(Math.round(stats.adaptiveFetchesPerDay))
+                .arg(Math.round(stats.fixedFetchesPerDay))
+        }
+
         CheckBox {
             id: runInBackground
             text: qsTr("Run in background")
@@ -7,7 +7,8 @@ import QtQuick 2.12
 import QtQuick.Controls 2.12
 import QtQuick.Layouts 1.12
 import QtQuick.Window 2.15
-import org.kde.kirigami 2.7 as Kirigami
+import org.kde.kirigami 2.8 as Kirigami
+import com.rocksandpaper.syndic 1.0
 
 Kirigami.ApplicationWindow {
     id: root
@@ -59,6 +60,18 @@ Kirigami.ApplicationWindow {
             spacing: 0
             Layout.fillWidth: true
 
+            Kirigami.SearchField {
+                id: searchField
+                Layout.fillWidth: true
+                Layout.bottomMargin: Kirigami.Units.smallSpacing
+                onAccepted: {
+                    if (text.length > 0) {
+                        pushSearch(text);
+                        drawer.drawerOpen = !drawer.modal
+                    }
+                }
+            }
+
             FeedList {
                 id: feedList
                 Layout.fillHeight: true
@@ -137,6 +150,12 @@ Kirigami.ApplicationWindow {
         ]
     }
 
+    SearchFeed {
+        id: searchFeed
+        context: feedContext
+        name: qsTr("Search: %1").arg(query)
+    }
+
     QtObject {
         id: priv
         property real itemListProportion:  0.38
@@ -217,6 +236,13 @@ Kirigami.ApplicationWindow {
                            feed: feed})
     }
 
+    function pushSearch(query) {
+        feedList.currentIndex = -1
+        feedList.currentlySelectedFeed = null
+        searchFeed.query = query
+        pushFeed(searchFeed)
+    }
+
     function pushUtilityPage(pageUrl, pageProps) {
         feedList.currentIndex = -1
         feedList.currentlySelectedFeed = null
@@ -0,0 +1,141 @@
+#include "xmlfeedparser.h"
+#include <QDir>
+#include <QFile>
+#include <QtTest>
+#include <Syndication/DocumentSource>
+#include <Syndication/Feed>
+#include <Syndication/Global>
+#include <Syndication/Item>
+
+// set this to a directory of downloaded feeds to benchmark those instead of the generated ones
+static constexpr const char *corpusVariable = "SYNDIC_FEED_CORPUS";
+static constexpr int generatedFeedCount{20};
+static constexpr int generatedItemCount{500};
+
+static QByteArray generatedFeed(int index)
+{
+    // full-content items, which is what makes large feeds large
+    QString body;
+    for (int i = 0; i < 40; ++i) {
+        body += QStringLiteral("<p>Paragraph %1 of the article body, with <a href=\"https://example.com/\">a link</a>.</p>").arg(i);
+    }
+    body = body.toHtmlEscaped();
+    QString document{QStringLiteral("<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>Feed %1</title>"
+                                    "<link>https://example.com/%1/</link>")
+                         .arg(index)};
+    for (int i = 0; i < generatedItemCount; ++i) {
+        document += QStringLiteral("<item><guid>https://example.com/%1/%2</guid><title>Headline %2</title>"
+                                   "<link>https://example.com/%1/%2</link><pubDate>Sat, 01 May 2021 12:00:00 GMT</pubDate>"
+                                   "<description>%3</description></item>")
+                        .arg(index)
+                        .arg(i)
+                        .arg(body);
+    }
+    document += QStringLiteral("</channel></rss>");
+    return document.toUtf8();
+}
+
+/**
+ * The peak resident set size since the last call, in kB, or -1 where that is not available.
+ */
+static qint64 peakRss()
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    qint64 peak{-1};
+    const auto &lines = status.readAll().split('\n');
+    for (const auto &line : lines) {
+        if (line.startsWith("VmHWM:")) {
+            peak = line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    // writing 5 resets the high water mark to the current RSS
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly)) {
+        clearRefs.write("5");
+    }
+    return peak;
+}
+
+class benchFeedParser : public QObject
+{
+    Q_OBJECT
+    QVector<QByteArray> m_corpus;
+    qint64 m_corpusSize{0};
+
+    template<typename Parse>
+    void measure(const char *parser, Parse parse)
+    {
+        peakRss();
+        int items{0};
+        for (const auto &document : qAsConst(m_corpus)) {
+            items += parse(document);
+        }
+        qInfo("%s: %d items from %lld bytes, peak RSS %lld kB", parser, items, m_corpusSize, peakRss());
+        QBENCHMARK {
+            for (const auto &document : qAsConst(m_corpus)) {
+                parse(document);
+            }
+        }
+    }
+
+private slots:
+    void initTestCase()
+    {
+        const QString &corpusPath{qEnvironmentVariable(corpusVariable)};
+        if (!corpusPath.isEmpty()) {
+            const auto &files = QDir(corpusPath).entryInfoList(QDir::Files);
+            for (const auto &file : files) {
+                QFile feed(file.filePath());
+                if (feed.open(QIODevice::ReadOnly)) {
+                    m_corpus << feed.readAll();
+                }
+            }
+        } else {
+            for (int i = 0; i < generatedFeedCount; ++i) {
+                m_corpus << generatedFeed(i);
+            }
+        }
+        QVERIFY(!m_corpus.isEmpty());
+        for (const auto &document : qAsConst(m_corpus)) {
+            m_corpusSize += document.size();
+        }
+    }
+
+    void benchXmlFeedParser()
+    {
+        measure("XmlFeedParser", [](const QByteArray &document) {
+            FeedCore::XmlFeedParser parser(document);
+            int count{0};
+            parser.parse([&count](FeedCore::ParsedItem &&) {
+                ++count;
+            });
+            return count;
+        });
+    }
+
+    void benchSyndication()
+    {
+        measure("Syndication", [](const QByteArray &document) {
+            const auto &feed = Syndication::parse(Syndication::DocumentSource(document, QStringLiteral("about:blank")));
+            if (!feed) {
+                return 0;
+            }
+            // reading the fields is part of the cost, since the DOM is only walked on access
+            int count{0};
+            const auto &items = feed->items();
+            for (const auto &item : items) {
+                item->title();
+                item->content();
+                ++count;
+            }
+            return count;
+        });
+    }
+};
+
+QTEST_MAIN(benchFeedParser)
+
+#include "tst_benchfeedparser.moc"
@@ -0,0 +1,115 @@
+#include "sqlite/feeddatabase.h"
+#include "sqlite/itemquery.h"
+#include <QtTest>
+
+static constexpr const char *benchDbName = "benchSelectAllItems.db";
+static constexpr int feedCount{50};
+static constexpr int itemCount{100000};
+
+class benchSelectAllItems : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QFile(benchDbName).remove();
+        SqliteStorage::FeedDatabase feedDb(benchDbName);
+
+        // paragraphs of varying text, so that the content does not compress to nothing
+        QString content;
+        for (int i = 0; i < 400; ++i) {
+            content += QStringLiteral("<p>Paragraph %1 of the article body.</p>").arg(i * 7919 % 10007);
+        }
+
+        QVERIFY(feedDb.transaction());
+        QVector<qint64> feeds;
+        for (int i = 0; i < feedCount; ++i) {
+            const auto &feedId = feedDb.insertFeed(QUrl(QStringLiteral("https://example.com/%1.xml").arg(i)));
+            QVERIFY(feedId);
+            feeds << *feedId;
+        }
+        // consecutive items go to different feeds, so that every page of the list mixes them
+        QVector<QVector<SqliteStorage::ItemRecord>> batches(feedCount);
+        for (int i = 0; i < itemCount; ++i) {
+            auto &batch = batches[i % feedCount];
+            batch.append({QString::number(i),
+                          QStringLiteral("Headline %1").arg(i),
+                          "author",
+                          QUrl(QStringLiteral("https://example.com/item/%1").arg(i)),
+                          1600000000 + i * 60,
+                          QString::number(i) + content});
+            if (batch.size() == SqliteStorage::FeedDatabase::maxBatchSize) {
+                QVERIFY(feedDb.upsertItems(feeds[i % feedCount], batch));
+                batch.clear();
+            }
+        }
+        for (int i = 0; i < feedCount; ++i) {
+            if (!batches[i].isEmpty()) {
+                QVERIFY(feedDb.upsertItems(feeds[i], batches[i]));
+            }
+        }
+        QVERIFY(feedDb.commit());
+    }
+
+    void cleanupTestCase()
+    {
+        QFile(benchDbName).remove();
+    }
+
+    void benchSelectAll()
+    {
+        SqliteStorage::FeedDatabase feedDb(benchDbName);
+        int count{0};
+        QBENCHMARK {
+            count = 0;
+            auto q = feedDb.selectAllItems();
+            while (q.next()) {
+                ++count;
+            }
+        }
+        QCOMPARE(count, itemCount);
+    }
+
+    void benchSelectFirstPage()
+    {
+        SqliteStorage::FeedDatabase feedDb(benchDbName);
+        int count{0};
+        QBENCHMARK {
+            count = 0;
+            auto q = feedDb.selectAllItems({}, 100);
+            while (q.next()) {
+                ++count;
+            }
+        }
+        QCOMPARE(count, 100);
+    }
+
+    void benchReadRows_data()
+    {
+        QTest::addColumn<bool>("nativeReads");
+        QTest::newRow("qtsql") << false;
+        QTest::newRow("native") << true;
+    }
+
+    // copies every row out, as the storage does; divide by itemCount for the cost per row
+    void benchReadRows()
+    {
+        QFETCH(bool, nativeReads);
+        SqliteStorage::DatabaseOptions options;
+        options.nativeReads = nativeReads;
+        SqliteStorage::FeedDatabase feedDb(benchDbName, options);
+        if (feedDb.nativeReads() != nativeReads) {
+            QSKIP("native reads are not available");
+        }
+        int count{0};
+        QBENCHMARK {
+            count = feedDb.allItemRows().size();
+        }
+        QCOMPARE(count, itemCount);
+    }
+};
+
+QTEST_MAIN(benchSelectAllItems)
+
+#include "tst_benchselectallitems.moc"
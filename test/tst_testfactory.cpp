@@ -0,0 +1,63 @@
+#include "factory.h"
+#include <QtTest>
+using namespace FeedCore;
+
+class Instance
+{
+public:
+    explicit Instance(int key)
+        : key(key)
+    {
+    }
+    int key;
+};
+
+class testFactory : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testOneInstancePerKey()
+    {
+        SharedFactory<int, Instance> factory;
+        const auto &first = factory.getInstance(1);
+        QCOMPARE(factory.getInstance(1), first);
+        QCOMPARE(factory.find(1), first);
+        QVERIFY(factory.find(2).isNull());
+        const FactoryStats &stats{factory.stats()};
+        QCOMPARE(stats.live, 1);
+        QCOMPARE(stats.hits, quint64(1));
+        QCOMPARE(stats.misses, quint64(1));
+    }
+
+    void testDeadEntriesPurged()
+    {
+        SharedFactory<int, Instance> factory;
+        for (int i = 0; i < 10000; ++i) {
+            factory.getInstance(i);
+        }
+        const FactoryStats &stats{factory.stats()};
+        QCOMPARE(stats.live, 0);
+        QVERIFY(stats.dead < 1000);
+        factory.purge();
+        QCOMPARE(factory.stats().dead, 0);
+    }
+
+    void testRecentInstancesRetained()
+    {
+        SharedFactory<int, Instance> factory;
+        factory.setRetainLimit(2);
+        factory.getInstance(1);
+        factory.getInstance(2);
+        factory.getInstance(1);
+        factory.getInstance(3);
+        QVERIFY(!factory.find(1).isNull());
+        QVERIFY(factory.find(2).isNull());
+        QVERIFY(!factory.find(3).isNull());
+        QCOMPARE(factory.stats().retained, 2);
+    }
+};
+
+QTEST_MAIN(testFactory)
+
+#include "tst_testfactory.moc"
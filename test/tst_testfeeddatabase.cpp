@@ -0,0 +1,646 @@
+#include "sqlite/feeddatabase.h"
+#include "sqlite/feedquery.h"
+#include "sqlite/itemquery.h"
+#include "sqlite/writebuffer.h"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtTest>
+#include <functional>
+
+static constexpr const char *testDbName = "testFeedDatabase.db";
+static constexpr const char *testConnectionName = "testFeedDatabase";
+
+static QString testContent()
+{
+    return QStringLiteral("<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</p>").repeated(20);
+}
+
+class testFeedDatabase : public QObject
+{
+    Q_OBJECT
+
+    QSqlDatabase db()
+    {
+        return QSqlDatabase::database(testConnectionName);
+    }
+
+    QStringList queryPlan(const QString &statement)
+    {
+        QSqlQuery q(db());
+        q.prepare("EXPLAIN QUERY PLAN " + statement);
+        for (const auto &placeholder : {":feed", ":date", ":id", ":limit"}) {
+            if (statement.contains(placeholder)) {
+                q.bindValue(placeholder, 1);
+            }
+        }
+        if (!q.exec()) {
+            qWarning() << q.lastError().text();
+            return {};
+        }
+        QStringList plan;
+        while (q.next()) {
+            plan << q.value(3).toString();
+        }
+        return plan;
+    }
+
+    int unreadCount(SqliteStorage::FeedDatabase &feedDb, qint64 feedId)
+    {
+        SqliteStorage::FeedQuery q{feedDb.selectFeed(feedId)};
+        const int count{q.next() ? q.unreadCount() : -1};
+        q.finish();
+        return count;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QFile(testDbName).remove();
+
+        // start from a version 1 database so that the migrations are exercised
+        {
+            auto database = QSqlDatabase::addDatabase("QSQLITE", testConnectionName);
+            database.setDatabaseName(testDbName);
+            QVERIFY(database.open());
+            QSqlQuery q(database);
+            QVERIFY(q.exec("CREATE TABLE Feed(id INTEGER PRIMARY KEY, displayName TEXT, category TEXT, url TEXT NOT NULL, "
+                           "link TEXT, icon TEXT, updateInterval INTEGER, lastUpdate INTEGER, expireAge INTEGER);"));
+            QVERIFY(q.exec("CREATE TABLE Item(id INTEGER PRIMARY KEY, feed INTEGER REFERENCES Feed, localId TEXT NOT NULL, "
+                           "headline TEXT, author TEXT, date INTEGER, url TEXT, feedContent TEXT, isRead INTEGER, "
+                           "isStarred INTEGER, UNIQUE(feed,localId));"));
+            QVERIFY(q.exec("INSERT INTO Feed (id, displayName, url) VALUES (1, 'feed', 'about:blank');"));
+            q.prepare("INSERT INTO Item (feed, localId, headline, date, feedContent, isRead, isStarred) VALUES (1, 'item', 'headline', 1, :content, 0, 0);");
+            q.bindValue(":content", testContent());
+            QVERIFY(q.exec());
+            QVERIFY(q.exec("PRAGMA user_version = 1;"));
+        }
+
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        QVERIFY(feedDb.selectItem(1, "item").next());
+        const auto &upgrade = feedDb.upgrade();
+        QCOMPARE(upgrade.fromVersion, 1);
+        QVERIFY(upgrade.vacuumed);
+        QVERIFY(upgrade.sizeAfter > 0);
+
+        // a current database is left as it is
+        SqliteStorage::FeedDatabase reopened(testDbName);
+        QVERIFY(!reopened.upgrade().vacuumed);
+    }
+
+    void cleanupTestCase()
+    {
+        db().close();
+        QSqlDatabase::removeDatabase(testConnectionName);
+        QFile(testDbName).remove();
+    }
+
+    void testMigratedVersion()
+    {
+        QSqlQuery q("PRAGMA user_version", db());
+        QVERIFY(q.next());
+        QVERIFY(q.value(0).toInt() >= 2);
+    }
+
+    void testContentCompression()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+
+        // migrated from version 1
+        auto migrated = feedDb.selectItemContent(1);
+        QVERIFY(migrated.codec != SqliteStorage::PlainContent);
+        QVERIFY(SqliteStorage::storedSize(migrated) < testContent().size());
+        QCOMPARE(SqliteStorage::decompressContent(migrated), testContent());
+
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(feedDb.upsertItems(*feedId, {{"long", "headline", "author", QUrl("about:blank"), 1, testContent()}, {"short", "headline", "author", QUrl("about:blank"), 1, "short"}}));
+        auto q = feedDb.selectItemsByFeed(*feedId);
+        QHash<QString, qint64> ids;
+        while (q.next()) {
+            ids.insert(q.localId(), q.id());
+        }
+        QCOMPARE(SqliteStorage::decompressContent(feedDb.selectItemContent(ids["long"])), testContent());
+        auto shortContent = feedDb.selectItemContent(ids["short"]);
+        QCOMPARE(shortContent.codec, int(SqliteStorage::PlainContent));
+        QCOMPARE(SqliteStorage::decompressContent(shortContent), QStringLiteral("short"));
+
+        // updates without content keep the stored content
+        QVERIFY(feedDb.upsertItems(*feedId, {{"long", "new headline", "author", QUrl("about:blank"), 1, {}}}));
+        QCOMPARE(SqliteStorage::decompressContent(feedDb.selectItemContent(ids["long"])), testContent());
+
+        // content is deleted along with its item
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+        QCOMPARE(feedDb.selectItemContent(ids["long"]).data, QVariant());
+        QSqlQuery orphans("SELECT COUNT(*) FROM ItemContent WHERE itemId NOT IN (SELECT id FROM Item)", db());
+        QVERIFY(orphans.next());
+        QCOMPARE(orphans.value(0).toInt(), 0);
+    }
+
+    void testContentTable()
+    {
+        // list scans must not have to skip over the content
+        QSqlQuery q("SELECT name FROM pragma_table_info('Item')", db());
+        QStringList columns;
+        while (q.next()) {
+            columns << q.value(0).toString();
+        }
+        QVERIFY(columns.contains("headline"));
+        QVERIFY(!columns.contains("feedContent"));
+        QVERIFY(!columns.contains("contentCodec"));
+    }
+
+    void testSearch()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+
+        // indexed by the migration
+        auto migrated = feedDb.searchItems("lorem IPSUM");
+        QVERIFY(migrated.next());
+        QCOMPARE(migrated.localId(), QStringLiteral("item"));
+        migrated.finish();
+
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(feedDb.upsertItems(*feedId,
+                                   {{"1", "Rocks and paper", "author", QUrl("about:blank"), 1, "<p>scissors</p>"},
+                                    {"2", "Paper planes", "author", QUrl("about:blank"), 2, "<p>paper <b>paper</b> paper</p>"},
+                                    {"3", "Café \"quotes\"", "author", QUrl("about:blank"), 3, {}}}));
+        auto localIds = [&](SqliteStorage::ItemQuery q) {
+            QStringList result;
+            while (q.next()) {
+                result << q.localId();
+            }
+            return result;
+        };
+        QCOMPARE(localIds(feedDb.searchItems("paper")), QStringList({"2", "1"}));
+        QCOMPARE(localIds(feedDb.searchItems("pap sciss")), QStringList({"1"}));
+        QCOMPARE(localIds(feedDb.searchItems("cafe \"quotes")), QStringList({"3"}));
+        QCOMPARE(localIds(feedDb.searchItems("<b>")), QStringList());
+
+        // one page at a time
+        QCOMPARE(localIds(feedDb.searchItems("paper", {}, 1)), QStringList({"2"}));
+        auto ids = [&](const QString &localId) {
+            auto q = feedDb.selectItem(*feedId, localId);
+            const qint64 id{q.next() ? q.id() : 0};
+            q.finish();
+            return id;
+        };
+        const auto &cursor = feedDb.selectSearchCursor("paper", ids("2"));
+        QVERIFY(cursor);
+        QCOMPARE(localIds(feedDb.searchItems("paper", *cursor, 1)), QStringList({"1"}));
+        QVERIFY(!feedDb.selectSearchCursor("scissors", ids("2")));
+
+        // the index follows updates and deletes
+        QVERIFY(feedDb.upsertItems(*feedId, {{"1", "Rocks", "author", QUrl("about:blank"), 1, "<p>stone</p>"}}));
+        QCOMPARE(localIds(feedDb.searchItems("paper")), QStringList({"2"}));
+        QCOMPARE(localIds(feedDb.searchItems("stone")), QStringList({"1"}));
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+        QCOMPARE(localIds(feedDb.searchItems("paper")), QStringList());
+    }
+
+    void testFingerprints()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+
+        // items from before the migration have no fingerprint
+        QVERIFY(feedDb.selectItemFingerprints(1, {"item"}).isEmpty());
+
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        const SqliteStorage::ItemRecord item{"1", "headline", "author", QUrl("about:blank"), 1, "content"};
+        QVERIFY(feedDb.upsertItems(*feedId, {item}));
+        const auto &fingerprints = feedDb.selectItemFingerprints(*feedId, {"1", "2"});
+        QCOMPARE(fingerprints.size(), 1);
+        QCOMPARE(fingerprints["1"], SqliteStorage::FeedDatabase::fingerprint(item));
+
+        // every field contributes to the fingerprint
+        auto changed = [&](const std::function<void(SqliteStorage::ItemRecord &)> &change) {
+            auto record = item;
+            change(record);
+            return SqliteStorage::FeedDatabase::fingerprint(record) != fingerprints["1"];
+        };
+        QVERIFY(changed([](auto &r) {
+            r.title = "headline2";
+        }));
+        QVERIFY(changed([](auto &r) {
+            r.author = "someone";
+        }));
+        QVERIFY(changed([](auto &r) {
+            r.url = QUrl("about:home");
+        }));
+        QVERIFY(changed([](auto &r) {
+            r.date = 2;
+        }));
+        QVERIFY(changed([](auto &r) {
+            r.content = "content2";
+        }));
+        QVERIFY(changed([](auto &r) {
+            r.title = "headlineauthor";
+            r.author = "";
+        }));
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testUnreadCounts()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        QCOMPARE(unreadCount(feedDb, 1), 1);
+
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QCOMPARE(unreadCount(feedDb, *feedId), 0);
+
+        QVector<SqliteStorage::ItemRecord> items;
+        for (int i = 0; i < 5; ++i) {
+            items.append({QString::number(i), "headline", "author", QUrl("about:blank"), 100 + i, {}});
+        }
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        QCOMPARE(unreadCount(feedDb, *feedId), 5);
+
+        // items are listed newest first, so this leaves the three oldest items unread
+        auto q = feedDb.selectItemsByFeed(*feedId);
+        QVector<qint64> ids;
+        while (q.next()) {
+            ids << q.id();
+        }
+        feedDb.updateItemRead(ids[0], true);
+        feedDb.updateItemRead(ids[1], true);
+        feedDb.updateItemRead(ids[1], true);
+        feedDb.updateItemRead(ids[2], false);
+        QCOMPARE(unreadCount(feedDb, *feedId), 3);
+
+        QSqlQuery deleteOldest(db());
+        QVERIFY(deleteOldest.exec(QStringLiteral("DELETE FROM Item WHERE feed=%1 AND date<102").arg(*feedId)));
+        QCOMPARE(unreadCount(feedDb, *feedId), 1);
+        feedDb.updateItemRead(ids[0], false);
+        QCOMPARE(unreadCount(feedDb, *feedId), 2);
+        QVERIFY(feedDb.checkUnreadCounts());
+
+        QSqlQuery corrupt(db());
+        QVERIFY(corrupt.exec("UPDATE FeedUnreadCount SET unreadCount=42"));
+        QVERIFY(!feedDb.checkUnreadCounts());
+        QVERIFY(feedDb.rebuildUnreadCounts());
+        QVERIFY(feedDb.checkUnreadCounts());
+        QCOMPARE(unreadCount(feedDb, 1), 1);
+        QCOMPARE(unreadCount(feedDb, *feedId), 2);
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+        QVERIFY(feedDb.checkUnreadCounts());
+    }
+
+    void testBulkUpdates()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVector<SqliteStorage::ItemRecord> items;
+        for (int i = 0; i < 10; ++i) {
+            items.append({QString::number(i), "headline", "author", QUrl("about:blank"), 100 + i, {}});
+        }
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        auto q = feedDb.selectItemsByFeed(*feedId);
+        QVector<qint64> ids;
+        while (q.next()) {
+            ids.prepend(q.id());
+        }
+
+        // only the items whose flag changes are reported
+        feedDb.updateItemRead(ids[0], true);
+        auto changed = feedDb.updateItemsRead({ids[0], ids[1], ids[2]}, true);
+        QVERIFY(changed);
+        QCOMPARE(changed->size(), 2);
+        QCOMPARE(changed->at(0).feed, *feedId);
+        QCOMPARE(unreadCount(feedDb, *feedId), 7);
+
+        changed = feedDb.updateFeedItemsRead(*feedId, 105);
+        QVERIFY(changed);
+        QCOMPARE(changed->size(), 3);
+        QCOMPARE(unreadCount(feedDb, *feedId), 4);
+
+        changed = feedDb.updateAllItemsRead(std::numeric_limits<qint64>::max());
+        QVERIFY(changed);
+        QCOMPARE(changed->size(), 5);
+        QCOMPARE(unreadCount(feedDb, *feedId), 0);
+        QCOMPARE(unreadCount(feedDb, 1), 0);
+
+        changed = feedDb.updateItemsStarred(ids, true);
+        QVERIFY(changed);
+        QCOMPARE(changed->size(), 10);
+        changed = feedDb.updateItemsStarred(ids, true);
+        QVERIFY(changed);
+        QCOMPARE(changed->size(), 0);
+        QVERIFY(feedDb.checkUnreadCounts());
+
+        feedDb.updateItemRead(1, false);
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testWriteBuffer()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(feedDb.upsertItems(*feedId, {{"0", "headline", "author", QUrl("about:blank"), 100, {}}}));
+        auto q = feedDb.selectItemsByFeed(*feedId);
+        QVERIFY(q.next());
+        const qint64 itemId{q.id()};
+        q.finish();
+
+        // only the last change to each column is written
+        SqliteStorage::WriteBuffer buffer;
+        buffer.setItemRead(itemId, true);
+        buffer.setItemRead(itemId, false);
+        buffer.setItemRead(itemId, true);
+        buffer.setItemStarred(itemId, true);
+        buffer.feed(*feedId).name = "first";
+        buffer.feed(*feedId).name = "second";
+        buffer.feed(*feedId).category = "category";
+        QVERIFY(!buffer.isEmpty());
+        const auto &job = buffer.take();
+        QVERIFY(buffer.isEmpty());
+        job(feedDb);
+
+        QCOMPARE(unreadCount(feedDb, *feedId), 0);
+        QVERIFY(feedDb.checkUnreadCounts());
+        SqliteStorage::FeedQuery feed{feedDb.selectFeed(*feedId)};
+        QVERIFY(feed.next());
+        QCOMPARE(feed.displayName(), QStringLiteral("second"));
+        QCOMPARE(feed.category(), QStringLiteral("category"));
+        feed.finish();
+        const auto &rows = feedDb.itemRows(itemId);
+        QCOMPARE(rows.size(), 1);
+        QVERIFY(rows[0].isRead);
+        QVERIFY(rows[0].isStarred);
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testFailures()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QCOMPARE(feedDb.feedRows(*feedId)[0].failureCount, 0);
+        QVERIFY(!feedDb.feedRows(*feedId)[0].lastFailure.isValid());
+
+        const auto &lastFailure = QDateTime::fromSecsSinceEpoch(QDateTime::currentSecsSinceEpoch() - 60);
+        SqliteStorage::WriteBuffer buffer;
+        buffer.feed(*feedId).failureCount = 3;
+        buffer.feed(*feedId).lastFailure = lastFailure;
+        buffer.take()(feedDb);
+        const auto &rows = feedDb.feedRows(*feedId);
+        QCOMPARE(rows.size(), 1);
+        QCOMPARE(rows[0].failureCount, 3);
+        QCOMPARE(rows[0].lastFailure, lastFailure);
+
+        feedDb.updateFeedFailureCount(*feedId, 0);
+        feedDb.updateFeedLastFailure(*feedId, {});
+        QCOMPARE(feedDb.feedRows(*feedId)[0].failureCount, 0);
+        QVERIFY(!feedDb.feedRows(*feedId)[0].lastFailure.isValid());
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testNestedStatements()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(feedDb.upsertItems(*feedId, {{"0", "first", "", QUrl(), 200, {}}, {"1", "second", "", QUrl(), 100, {}}}));
+
+        // the outer query is still being read when the same statement is used again
+        auto outer = feedDb.selectItemsByFeed(*feedId);
+        QVERIFY(outer.next());
+        QCOMPARE(outer.headline(), QStringLiteral("first"));
+        const auto misses = feedDb.statementCacheStats().misses;
+        auto inner = feedDb.selectItemsByFeed(*feedId);
+        QCOMPARE(feedDb.statementCacheStats().misses, misses + 1);
+        QStringList innerHeadlines;
+        while (inner.next()) {
+            innerHeadlines << inner.headline();
+        }
+        QCOMPARE(innerHeadlines, QStringList({"first", "second"}));
+        QVERIFY(outer.next());
+        QCOMPARE(outer.headline(), QStringLiteral("second"));
+        QVERIFY(!outer.next());
+
+        // once both are done, the statement is reused
+        const auto hits = feedDb.statementCacheStats().hits;
+        auto again = feedDb.selectItemsByFeed(*feedId);
+        QCOMPARE(feedDb.statementCacheStats().hits, hits + 1);
+        again.finish();
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testStatementCacheBounded()
+    {
+        using SqliteStorage::FeedDatabase;
+        FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        const int batches{FeedDatabase::maxCachedStatements + 10};
+        QVector<SqliteStorage::ItemRecord> items;
+        for (int i = 0; i < batches; ++i) {
+            items.append({QString::number(i), "headline", "author", QUrl("about:blank"), 100 + i, {}});
+        }
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        QVector<qint64> ids;
+        auto q = feedDb.selectItemsByFeed(*feedId);
+        while (q.next()) {
+            ids.append(q.id());
+        }
+        QCOMPARE(ids.size(), batches);
+
+        // every batch size prepares its own statement
+        for (int size = 1; size <= batches; ++size) {
+            QVERIFY(feedDb.updateItemsRead(ids.mid(0, size), true));
+        }
+        const auto &stats = feedDb.statementCacheStats();
+        QVERIFY(stats.evictions >= 10);
+        QVERIFY(stats.misses - stats.evictions <= FeedDatabase::maxCachedStatements);
+
+        // the select and update that were used last are still cached
+        const auto hits = stats.hits;
+        const auto misses = stats.misses;
+        QVERIFY(feedDb.updateItemsRead(ids, false));
+        QCOMPARE(feedDb.statementCacheStats().hits, hits + 2);
+        QCOMPARE(feedDb.statementCacheStats().misses, misses);
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testHttpCache()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(feedDb.feedRows(*feedId)[0].etag.isEmpty());
+        QVERIFY(!feedDb.feedRows(*feedId)[0].cacheExpires.isValid());
+
+        const auto &expires = QDateTime::fromSecsSinceEpoch(QDateTime::currentSecsSinceEpoch() + 60);
+        feedDb.updateFeedHttpCache(*feedId, "\"v1\"", "Tue, 01 Jun 2021 00:00:00 GMT", expires);
+        const auto &rows = feedDb.feedRows(*feedId);
+        QCOMPARE(rows.size(), 1);
+        QCOMPARE(rows[0].etag, QStringLiteral("\"v1\""));
+        QCOMPARE(rows[0].lastModified, QStringLiteral("Tue, 01 Jun 2021 00:00:00 GMT"));
+        QCOMPARE(rows[0].cacheExpires, expires);
+
+        feedDb.updateFeedHttpCache(*feedId, {}, {}, {});
+        QVERIFY(feedDb.feedRows(*feedId)[0].lastModified.isEmpty());
+        QVERIFY(!feedDb.feedRows(*feedId)[0].cacheExpires.isValid());
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testPostingInterval()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QCOMPARE(feedDb.feedRows(*feedId)[0].postingInterval, SqliteStorage::FeedDatabase::postingWindow);
+
+        const qint64 now{QDateTime::currentSecsSinceEpoch()};
+        const qint64 day{24 * 60 * 60};
+        QVector<SqliteStorage::ItemRecord> items;
+        for (int i = 1; i <= 4; ++i) {
+            items.append({QString::number(i), "headline", "author", QUrl("about:blank"), time_t(now - i * day), {}});
+        }
+        // too old to count
+        items.append({"old", "headline", "author", QUrl("about:blank"), time_t(now - SqliteStorage::FeedDatabase::postingWindow - day), {}});
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        QCOMPARE(feedDb.selectPostingInterval(*feedId, now), day);
+        QCOMPARE(feedDb.selectPostingIntervals(now).value(*feedId), day);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testExpiry()
+    {
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("about:blank"));
+        const auto &keptFeedId = feedDb.insertFeed(QUrl("about:blank"));
+        QVERIFY(feedId);
+        QVERIFY(keptFeedId);
+        feedDb.updateFeedExpireAge(*feedId, 50);
+        feedDb.updateFeedExpireAge(*keptFeedId, -1);
+        QVector<SqliteStorage::ItemRecord> items;
+        for (int i = 0; i < 10; ++i) {
+            items.append({QString::number(i), "headline", "author", QUrl("about:blank"), 100 + i, {}});
+        }
+        QVERIFY(feedDb.upsertItems(*feedId, items));
+        QVERIFY(feedDb.upsertItems(*keptFeedId, items));
+        auto starred = feedDb.selectItem(*feedId, "0");
+        QVERIFY(starred.next());
+        feedDb.updateItemStarred(starred.id(), true);
+        auto read = feedDb.selectItem(*feedId, "1");
+        QVERIFY(read.next());
+        feedDb.updateItemRead(read.id(), true);
+
+        // the items dated before 105 expire, except the starred one; the default age of 0 disables expiry
+        const QDateTime now{QDateTime::fromSecsSinceEpoch(155)};
+        auto expired = feedDb.deleteExpiredItems(now, 0, 3);
+        QVERIFY(expired);
+        QCOMPARE(expired->deleted, 3);
+        int unreadDeleted{expired->unreadByFeed.value(*feedId)};
+        expired = feedDb.deleteExpiredItems(now, 0, 3);
+        QVERIFY(expired);
+        QCOMPARE(expired->deleted, 1);
+        unreadDeleted += expired->unreadByFeed.value(*feedId);
+        QCOMPARE(unreadDeleted, 3);
+        QVERIFY(!expired->unreadByFeed.contains(*keptFeedId));
+
+        QCOMPARE(unreadCount(feedDb, *feedId), 6);
+        QCOMPARE(unreadCount(feedDb, *keptFeedId), 10);
+        QVERIFY(feedDb.checkUnreadCounts());
+        QVERIFY(feedDb.incrementalVacuum(10));
+        QVERIFY(feedDb.optimize());
+
+        for (const qint64 id : {*feedId, *keptFeedId}) {
+            feedDb.deleteItemsForFeed(id);
+            feedDb.deleteFeed(id);
+        }
+    }
+
+    void testNativeReads()
+    {
+        SqliteStorage::DatabaseOptions options;
+        options.nativeReads = true;
+        SqliteStorage::FeedDatabase nativeDb(testDbName, options);
+        if (!nativeDb.nativeReads()) {
+            QSKIP("native reads are not available");
+        }
+        SqliteStorage::FeedDatabase feedDb(testDbName);
+        const auto &feedId = feedDb.insertFeed(QUrl("https://example.com/feed.xml"));
+        QVERIFY(feedId);
+        feedDb.updateFeedName(*feedId, QStringLiteral("Caf\u00e9 news"));
+        QVERIFY(feedDb.upsertItems(*feedId,
+                                   {{"1", QStringLiteral("Caf\u00e9"), "author", QUrl("https://example.com/1"), 101, testContent()},
+                                    {"2", "headline", {}, QUrl(), 102, {}}}));
+
+        const auto &items = nativeDb.allItemRows();
+        const auto &expectedItems = feedDb.allItemRows();
+        QVERIFY(!items.isEmpty());
+        QCOMPARE(items.size(), expectedItems.size());
+        for (int i = 0; i < items.size(); ++i) {
+            QCOMPARE(items[i].id, expectedItems[i].id);
+            QCOMPARE(items[i].feed, expectedItems[i].feed);
+            QCOMPARE(items[i].localId, expectedItems[i].localId);
+            QCOMPARE(items[i].headline, expectedItems[i].headline);
+            QCOMPARE(items[i].author, expectedItems[i].author);
+            QCOMPARE(items[i].date, expectedItems[i].date);
+            QCOMPARE(items[i].url, expectedItems[i].url);
+            QCOMPARE(items[i].isRead, expectedItems[i].isRead);
+            QCOMPARE(items[i].isStarred, expectedItems[i].isStarred);
+        }
+        QCOMPARE(nativeDb.feedItemRows(*feedId, {}, 1).size(), 1);
+        QCOMPARE(nativeDb.searchItemRows(QStringLiteral("cafe")).size(), 1);
+
+        const auto &feeds = nativeDb.feedRows(*feedId);
+        QCOMPARE(feeds.size(), 1);
+        QCOMPARE(feeds[0].displayName, QStringLiteral("Caf\u00e9 news"));
+        QCOMPARE(feeds[0].url, QUrl("https://example.com/feed.xml"));
+        QCOMPARE(feeds[0].unreadCount, 2);
+
+        feedDb.deleteItemsForFeed(*feedId);
+        feedDb.deleteFeed(*feedId);
+    }
+
+    void testQueryPlan_data()
+    {
+        QTest::addColumn<QString>("whereClause");
+        QTest::addColumn<QString>("index");
+
+        // these mirror the queries in FeedDatabase
+        const QString page{"(date, id) < (:date, :id) ORDER BY date DESC, id DESC LIMIT :limit"};
+        QTest::newRow("all") << page << "Item_date";
+        QTest::newRow("unread") << "isRead=0 AND " + page << "Item_isRead_date";
+        QTest::newRow("starred") << "isStarred=1 AND " + page << "Item_starred_date";
+        QTest::newRow("feed") << "feed=:feed AND " + page << "Item_feed_date";
+        QTest::newRow("feed unread") << "feed=:feed AND isRead=0 AND " + page << "Item_feed_isRead_date";
+    }
+
+    void testQueryPlan()
+    {
+        QFETCH(QString, whereClause);
+        QFETCH(QString, index);
+
+        const QStringList &plan{queryPlan(SqliteStorage::ItemQuery::statement(whereClause))};
+        QVERIFY(!plan.isEmpty());
+        const QString &details{plan.join('\n')};
+        QVERIFY2(details.contains("USING INDEX " + index), qPrintable(details));
+        QVERIFY2(!details.contains("TEMP B-TREE"), qPrintable(details));
+    }
+};
+
+QTEST_MAIN(testFeedDatabase)
+
+#include "tst_testfeeddatabase.moc"
@@ -0,0 +1,142 @@
+#include "feedparser.h"
+#include <QSignalSpy>
+#include <QThread>
+#include <QtTest>
+
+static FeedCore::ParsedFeed parse(const QByteArray &data, const QUrl &url)
+{
+    // the future is deleted once it finishes, so take the result from inside the signal
+    auto *future = FeedCore::parseFeed(data, url);
+    FeedCore::ParsedFeed result;
+    QThread *deliveredOn{nullptr};
+    QObject::connect(future, &FeedCore::BaseFuture::finished, [future, &result, &deliveredOn] {
+        result = future->result().first();
+        deliveredOn = QThread::currentThread();
+    });
+    QSignalSpy finished(future, &FeedCore::BaseFuture::finished);
+    if (!finished.wait()) {
+        return {};
+    }
+    return deliveredOn == QThread::currentThread() ? result : FeedCore::ParsedFeed();
+}
+
+class testFeedParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testParse()
+    {
+        const QByteArray document{
+            "<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>test</title>"
+            "<item><guid>a</guid><title>first</title></item>"
+            "<item><guid>b</guid><title>second</title></item>"
+            "</channel></rss>"};
+        const auto &parsed = parse(document, QUrl("https://example.com/feed.xml"));
+        QVERIFY(parsed.isFeed);
+        QCOMPARE(parsed.title, QStringLiteral("test"));
+        QCOMPARE(parsed.items.size(), 2);
+        QCOMPARE(parsed.items[1].title, QStringLiteral("second"));
+        QVERIFY(parsed.parseTime >= 0);
+    }
+
+    void testRss()
+    {
+        const QByteArray document{
+            "<?xml version=\"1.0\"?><rss version=\"2.0\" xmlns:content=\"http://purl.org/rss/1.0/modules/content/\">"
+            "<channel><title>test &amp; more</title><link>https://example.com/</link>"
+            "<image><url>https://example.com/icon.png</url></image>"
+            "<item><guid isPermaLink=\"false\">a</guid><title>1 &lt; 2</title><link>https://example.com/a</link>"
+            "<author>someone@example.com (Some One)</author><pubDate>Sat, 01 May 2021 12:00:00 GMT</pubDate>"
+            "<description>summary</description><content:encoded><![CDATA[<p>full text</p>]]></content:encoded></item>"
+            "<item><guid>b</guid><title>second</title><description>only a summary</description></item>"
+            "</channel></rss>"};
+        const auto &parsed = FeedCore::parseDocument(document, QUrl("https://example.com/feed.xml"));
+        QVERIFY(parsed.isFeed);
+        QVERIFY(parsed.streamed);
+        QCOMPARE(parsed.title, QStringLiteral("test &amp; more"));
+        QCOMPARE(parsed.link, QUrl("https://example.com/"));
+        QCOMPARE(parsed.icon, QUrl("https://example.com/icon.png"));
+        QCOMPARE(parsed.items.size(), 2);
+        const auto &item = parsed.items[0];
+        QCOMPARE(item.id, QStringLiteral("a"));
+        QCOMPARE(item.title, QStringLiteral("1 &lt; 2"));
+        QCOMPARE(item.url, QUrl("https://example.com/a"));
+        QCOMPARE(item.author, QStringLiteral("Some One"));
+        QCOMPARE(item.date, time_t(1619870400));
+        QCOMPARE(item.content, QStringLiteral("<p>full text</p>"));
+        QCOMPARE(parsed.items[1].content, QStringLiteral("only a summary"));
+        QCOMPARE(parsed.items[1].date, time_t(0));
+    }
+
+    void testAtom()
+    {
+        const QByteArray document{
+            "<?xml version=\"1.0\"?><feed xmlns=\"http://www.w3.org/2005/Atom\"><title>test</title>"
+            "<link rel=\"self\" href=\"https://example.com/atom.xml\"/><link href=\"https://example.com/\"/>"
+            "<entry><id>urn:a</id><title type=\"html\">&lt;b&gt;bold&lt;/b&gt;</title>"
+            "<link rel=\"alternate\" href=\"https://example.com/a\"/><author><name>Some One</name></author>"
+            "<published>2021-04-01T00:00:00Z</published><updated>2021-05-01T12:00:00Z</updated>"
+            "<summary>summary</summary><content type=\"text\">a &lt; b</content></entry>"
+            "</feed>"};
+        const auto &parsed = FeedCore::parseDocument(document, QUrl("https://example.com/atom.xml"));
+        QVERIFY(parsed.streamed);
+        QCOMPARE(parsed.link, QUrl("https://example.com/"));
+        QCOMPARE(parsed.items.size(), 1);
+        const auto &item = parsed.items[0];
+        QCOMPARE(item.id, QStringLiteral("urn:a"));
+        QCOMPARE(item.title, QStringLiteral("<b>bold</b>"));
+        QCOMPARE(item.url, QUrl("https://example.com/a"));
+        QCOMPARE(item.author, QStringLiteral("Some One"));
+        QCOMPARE(item.date, time_t(1619870400));
+        QCOMPARE(item.content, QStringLiteral("a &lt; b"));
+    }
+
+    void testRdf()
+    {
+        const QByteArray document{
+            "<?xml version=\"1.0\"?><rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\" "
+            "xmlns=\"http://purl.org/rss/1.0/\" xmlns:dc=\"http://purl.org/dc/elements/1.1/\">"
+            "<channel rdf:about=\"https://example.com/\"><title>test</title><link>https://example.com/</link></channel>"
+            "<item rdf:about=\"https://example.com/a\"><title>first</title><link>https://example.com/a</link>"
+            "<dc:creator>Some One</dc:creator><dc:date>2021-05-01T12:00:00Z</dc:date></item>"
+            "</rdf:RDF>"};
+        const auto &parsed = FeedCore::parseDocument(document, QUrl("https://example.com/index.rdf"));
+        QVERIFY(parsed.streamed);
+        QCOMPARE(parsed.title, QStringLiteral("test"));
+        QCOMPARE(parsed.items.size(), 1);
+        QCOMPARE(parsed.items[0].id, QStringLiteral("https://example.com/a"));
+        QCOMPARE(parsed.items[0].author, QStringLiteral("Some One"));
+        QCOMPARE(parsed.items[0].date, time_t(1619870400));
+    }
+
+    void testFallback()
+    {
+        // Syndication makes up ids for items without one, so those documents are left to it
+        const QByteArray document{
+            "<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>test</title>"
+            "<item><guid>a</guid><title>first</title></item>"
+            "<item><title>second</title></item>"
+            "</channel></rss>"};
+        const auto &parsed = FeedCore::parseDocument(document, QUrl("https://example.com/feed.xml"));
+        QVERIFY(parsed.isFeed);
+        QVERIFY(!parsed.streamed);
+        QCOMPARE(parsed.items.size(), 2);
+        QCOMPARE(parsed.items[0].id, QStringLiteral("a"));
+        QVERIFY(!parsed.items[1].id.isEmpty());
+    }
+
+    void testDiscovery()
+    {
+        const QByteArray page{
+            "<html><head><link rel=\"stylesheet\" href=\"style.css\">"
+            "<link rel=\"alternate\" type=\"application/atom+xml\" href=\"/atom.xml\"></head></html>"};
+        const auto &parsed = parse(page, QUrl("https://example.com/blog/"));
+        QVERIFY(!parsed.isFeed);
+        QCOMPARE(parsed.discoveredUrl, QUrl("https://example.com/atom.xml"));
+    }
+};
+
+QTEST_MAIN(testFeedParser)
+
+#include "tst_testfeedparser.moc"
@@ -0,0 +1,165 @@
+#include "articleref.h"
+#include "feedparser.h"
+#include "future.h"
+#include "memorystorage/feedimpl.h"
+#include "memorystorage/storageimpl.h"
+#include "provisionalfeed.h"
+#include <QSignalSpy>
+#include <QtTest>
+
+static constexpr const qint64 day{24 * 60 * 60};
+
+static QByteArray testDocument(const QString &title, const QDateTime &newest)
+{
+    QString document{"<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>test</title>"};
+    for (int i = 0; i < 3; ++i) {
+        document += QStringLiteral("<item><guid>item%1</guid><title>%2 %1</title><description>body of item %1</description>"
+                                   "<pubDate>%3</pubDate></item>")
+                        .arg(i)
+                        .arg(title, newest.addSecs(-i * day).toString(Qt::RFC2822Date));
+    }
+    document += "</channel></rss>";
+    return document.toUtf8();
+}
+
+static QVector<FeedCore::ParsedItem> testItems(const QString &title, const QDateTime &newest)
+{
+    return FeedCore::parseDocument(testDocument(title, newest), QUrl("about:blank")).items;
+}
+
+template<typename T>
+static QVector<T> results(FeedCore::Future<T> *future)
+{
+    // the future is deleted as soon as it finishes, so take the result from inside the signal
+    QVector<T> result;
+    QObject::connect(future, &FeedCore::BaseFuture::finished, [future, &result] {
+        result = future->result();
+    });
+    QSignalSpy finished(future, &FeedCore::BaseFuture::finished);
+    finished.wait();
+    return result;
+}
+
+class testMemoryStorage : public QObject
+{
+    Q_OBJECT
+
+    MemoryStorage::StorageImpl *m_storage{nullptr};
+    MemoryStorage::FeedImpl *m_feed{nullptr};
+    QDateTime m_newest;
+
+    QStringList headlines(FeedCore::Future<FeedCore::ArticleRef> *future)
+    {
+        QStringList headlines;
+        for (const auto &article : results(future)) {
+            headlines << article->title();
+        }
+        return headlines;
+    }
+
+private slots:
+    void init()
+    {
+        m_storage = new MemoryStorage::StorageImpl;
+        m_newest = QDateTime::currentDateTimeUtc().addSecs(-60);
+        m_newest.setTime(QTime(m_newest.time().hour(), m_newest.time().minute()));
+        FeedCore::ProvisionalFeed testFeed;
+        testFeed.setName("test");
+        const auto &feeds = results(m_storage->storeFeed(&testFeed));
+        QCOMPARE(feeds.size(), 1);
+        m_feed = qobject_cast<MemoryStorage::FeedImpl *>(feeds[0]);
+        QVERIFY(m_feed != nullptr);
+        QCOMPARE(results(m_storage->storeArticles(m_feed, testItems("headline", m_newest))).first().added.size(), 3);
+    }
+
+    void cleanup()
+    {
+        delete m_storage;
+        m_storage = nullptr;
+        m_feed = nullptr;
+    }
+
+    void testNewestFirst()
+    {
+        QCOMPARE(headlines(m_storage->getAll()), QStringList({"headline 0", "headline 1", "headline 2"}));
+    }
+
+    void testPaging()
+    {
+        const auto &first = results(m_storage->getAllPage({}, 2));
+        QCOMPARE(first.size(), 2);
+        QCOMPARE(headlines(m_storage->getAllPage(first.last(), 2)), QStringList({"headline 2"}));
+    }
+
+    void testPostingInterval()
+    {
+        // three items a day apart, the newest a minute old
+        const qint64 expected{(2 * day + 60) / 3};
+        QVERIFY(qAbs(m_feed->postingInterval() - expected) < 60);
+    }
+
+    void testUpdateKeepsArticles()
+    {
+        const auto &before = results(m_storage->getAll());
+        const auto &stored = results(m_storage->storeArticles(m_feed, testItems("changed", m_newest)));
+        QCOMPARE(stored.first().added.size(), 0);
+        QCOMPARE(stored.first().updated, 3);
+        QCOMPARE(headlines(m_storage->getAll()), QStringList({"changed 0", "changed 1", "changed 2"}));
+        QCOMPARE(before[0]->title(), QStringLiteral("changed 0"));
+    }
+
+    void testSearch()
+    {
+        QCOMPARE(headlines(m_storage->search("BODY item 1", {}, -1)), QStringList({"headline 1"}));
+        QCOMPARE(headlines(m_storage->search("", {}, -1)), QStringList());
+    }
+
+    void testMarkRead()
+    {
+        const auto &articles = results(m_storage->getAll());
+        QCOMPARE(results(m_storage->markRead({articles[1]}, true)), QVector<qint64>({1}));
+        QVERIFY(articles[1]->isRead());
+        QCOMPARE(headlines(m_storage->getUnread()), QStringList({"headline 0", "headline 2"}));
+        QCOMPARE(results(m_storage->markFeedRead(m_feed, {})), QVector<qint64>({2}));
+        QCOMPARE(headlines(m_storage->getUnread()), QStringList());
+    }
+
+    void testMarkAllReadUpTo()
+    {
+        // the newest article arrived after the list was loaded, so it stays unread
+        QCOMPARE(results(m_feed->markAllRead(m_newest.addSecs(-1))), QVector<qint64>({2}));
+        QCOMPARE(headlines(m_storage->getUnread()), QStringList({"headline 0"}));
+        QCOMPARE(results(m_feed->markAllRead({})), QVector<qint64>({1}));
+        QCOMPARE(headlines(m_storage->getUnread()), QStringList());
+    }
+
+    void testRows()
+    {
+        const auto &first = results(m_storage->getAllRows({}, 2));
+        QCOMPARE(first.size(), 1);
+        const auto &rows = first[0];
+        QCOMPARE(rows.size(), 2);
+        QCOMPARE(rows.title(0), QStringLiteral("headline 0"));
+        QVERIFY(rows.find(1).isNull());
+        const auto &article = rows.article(1);
+        QCOMPARE(article->title(), QStringLiteral("headline 1"));
+        QCOMPARE(rows.find(1).get(), article.get());
+
+        const auto &next = results(m_storage->getAllRows(rows.row(1), 2));
+        QCOMPARE(next.size(), 1);
+        QCOMPARE(next[0].size(), 1);
+        QCOMPARE(next[0].title(0), QStringLiteral("headline 2"));
+    }
+
+    void testMaintenance()
+    {
+        const auto &articles = results(m_storage->getAll());
+        articles[2]->setStarred(true);
+        QCOMPARE(results(m_storage->runMaintenance(day / 2)), QVector<qint64>({1}));
+        QCOMPARE(headlines(m_storage->getAll()), QStringList({"headline 0", "headline 2"}));
+    }
+};
+
+QTEST_MAIN(testMemoryStorage)
+
+#include "tst_testmemorystorage.moc"
@@ -0,0 +1,327 @@
+#include "context.h"
+#include "future.h"
+#include "provisionalfeed.h"
+#include "searchfeed.h"
+#include "sqlite/feeddatabase.h"
+#include "sqlite/feedimpl.h"
+#include "sqlite/storageimpl.h"
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QtTest>
+#include <atomic>
+
+static constexpr const char *testDbName = "testStorageImpl.db";
+static constexpr const char *testConnectionName = "testStorageImpl";
+
+static SqliteStorage::DatabaseOptions testOptions()
+{
+    SqliteStorage::DatabaseOptions options;
+    options.walMode = true;
+    return options;
+}
+
+template<typename T>
+static QVector<T> results(FeedCore::Future<T> *future)
+{
+    // the future is deleted as soon as it finishes, so take the result from inside the signal
+    QVector<T> result;
+    QObject::connect(future, &FeedCore::BaseFuture::finished, [future, &result] {
+        result = future->result();
+    });
+    QSignalSpy finished(future, &FeedCore::BaseFuture::finished);
+    finished.wait();
+    return result;
+}
+
+static FeedCore::ParsedItem testItem(const QString &id, const QString &title, const QString &content)
+{
+    FeedCore::ParsedItem item;
+    item.id = id;
+    item.title = title;
+    item.content = content;
+    item.date = QDateTime::currentSecsSinceEpoch();
+    return item;
+}
+
+/**
+ * Counts the warnings logged while it exists, from any thread.
+ */
+class WarningCounter
+{
+public:
+    WarningCounter()
+    {
+        s_count = 0;
+        s_previous = qInstallMessageHandler(&WarningCounter::handle);
+    }
+
+    ~WarningCounter()
+    {
+        qInstallMessageHandler(s_previous);
+    }
+
+    int count() const
+    {
+        return s_count;
+    }
+
+private:
+    static inline std::atomic<int> s_count{0};
+    static inline QtMessageHandler s_previous{nullptr};
+
+    static void handle(QtMsgType type, const QMessageLogContext &context, const QString &message)
+    {
+        if (type == QtWarningMsg) {
+            ++s_count;
+        }
+        if (s_previous != nullptr) {
+            s_previous(type, context, message);
+        }
+    }
+};
+
+static QStringList headlines(const QVector<FeedCore::ArticleRef> &articles)
+{
+    QStringList headlines;
+    for (const auto &article : articles) {
+        headlines << article->title();
+    }
+    return headlines;
+}
+
+class testStorageImpl : public QObject
+{
+    Q_OBJECT
+
+    FeedCore::Context *m_context{nullptr};
+    SqliteStorage::StorageImpl *m_storage{nullptr};
+    SqliteStorage::FeedImpl *m_feed{nullptr};
+
+    static void removeDatabase()
+    {
+        for (const char *suffix : {"", "-wal", "-shm"}) {
+            QFile(testDbName + QString::fromLatin1(suffix)).remove();
+        }
+    }
+
+private slots:
+    void init()
+    {
+        removeDatabase();
+        m_storage = new SqliteStorage::StorageImpl(testDbName, testOptions());
+        m_context = new FeedCore::Context(m_storage); // takes ownership of the storage
+        FeedCore::ProvisionalFeed testFeed;
+        testFeed.setName(QStringLiteral("test"));
+        const auto &feeds = results(m_storage->storeFeed(&testFeed));
+        QCOMPARE(feeds.size(), 1);
+        m_feed = qobject_cast<SqliteStorage::FeedImpl *>(feeds.first());
+        QVERIFY(m_feed != nullptr);
+    }
+
+    void cleanup()
+    {
+        delete m_context;
+        m_context = nullptr;
+        m_storage = nullptr;
+        m_feed = nullptr;
+        removeDatabase();
+    }
+
+    void testReadsAfterQueuedWrites()
+    {
+        QVERIFY(results(m_storage->storeArticles(m_feed, {testItem("a", "First", "first"), testItem("b", "Second", "second")})).first().ok);
+
+        // another connection holds the write lock, so the storage's next write waits for it
+        SqliteStorage::FeedDatabase blocker(testDbName, testOptions());
+        QVERIFY(blocker.transaction());
+        QVERIFY(blocker.updateAllItemsRead(0));
+
+        bool written{false};
+        auto *write = m_storage->markAllRead(QDateTime::currentDateTime());
+        QObject::connect(write, &FeedCore::BaseFuture::finished, this, [&written] {
+            written = true;
+        });
+        // article lists wait for the write, but reads that don't depend on it go ahead
+        bool unreadDone{false};
+        QVector<FeedCore::ArticleRef> unread;
+        auto *unreadArticles = m_storage->getUnread();
+        QObject::connect(unreadArticles, &FeedCore::BaseFuture::finished, this, [unreadArticles, &unread, &unreadDone] {
+            unread = unreadArticles->result();
+            unreadDone = true;
+        });
+        bool feedsDone{false};
+        auto *feeds = m_storage->getFeeds();
+        QObject::connect(feeds, &FeedCore::BaseFuture::finished, this, [&feedsDone] {
+            feedsDone = true;
+        });
+
+        QTRY_VERIFY(feedsDone);
+        QVERIFY(!written);
+        QVERIFY(!unreadDone);
+        QVERIFY(blocker.commit());
+        QTRY_VERIFY(written);
+        QTRY_VERIFY(unreadDone);
+        QVERIFY(unread.isEmpty());
+    }
+
+    void testReadsAfterBufferedWrites()
+    {
+        QVERIFY(results(m_storage->storeArticles(m_feed, {testItem("a", "First", "first")})).first().ok);
+        const auto &articles = results(m_storage->getUnread());
+        QCOMPARE(articles.size(), 1);
+
+        // the flag change is held in the write buffer, and the read that follows has to flush it
+        articles.first()->setRead(true);
+        QVERIFY(results(m_storage->getUnread()).isEmpty());
+        const auto &rows = results(m_storage->getUnreadRows({}, -1));
+        QCOMPARE(rows.size(), 1);
+        QVERIFY(rows.first().isEmpty());
+    }
+
+    void testFailuresKeptAcrossRestart()
+    {
+        const auto &lastFailure = QDateTime::fromSecsSinceEpoch(QDateTime::currentSecsSinceEpoch() - 60);
+        m_feed->setLastFailure(lastFailure);
+        m_feed->setFailureCount(3);
+        const qint64 feedId{m_feed->id()};
+        // the storage writes the buffered changes when it is deleted
+        delete m_context;
+
+        m_storage = new SqliteStorage::StorageImpl(testDbName, testOptions());
+        m_context = new FeedCore::Context(m_storage);
+        const auto &feeds = results(m_storage->getFeeds());
+        QCOMPARE(feeds.size(), 1);
+        m_feed = qobject_cast<SqliteStorage::FeedImpl *>(feeds.first());
+        QVERIFY(m_feed != nullptr);
+        QCOMPARE(m_feed->id(), feedId);
+        QCOMPARE(m_feed->failureCount(), 3);
+        QCOMPARE(m_feed->lastFailure(), lastFailure);
+    }
+
+    void testUnchangedItemsSkipped()
+    {
+        const QVector<FeedCore::ParsedItem> items{testItem("a", "First", "first"), testItem("b", "Second", "second")};
+        const auto &first = results(m_storage->storeArticles(m_feed, items));
+        QCOMPARE(first.size(), 1);
+        QCOMPARE(first.first().added.size(), 2);
+        QCOMPARE(first.first().skipped, 0);
+
+        // edit a stored row behind the storage's back; if the item is written again, the edit is lost
+        {
+            auto db = QSqlDatabase::addDatabase("QSQLITE", testConnectionName);
+            db.setDatabaseName(testDbName);
+            QVERIFY(db.open());
+            QVERIFY(QSqlQuery(db).exec("UPDATE Item SET headline='edited' WHERE localId='a';"));
+        }
+        const auto &second = results(m_storage->storeArticles(m_feed, items));
+        QCOMPARE(second.size(), 1);
+        QVERIFY(second.first().ok);
+        QVERIFY(second.first().added.isEmpty());
+        QCOMPARE(second.first().updated, 0);
+        QCOMPARE(second.first().skipped, 2);
+        {
+            QSqlQuery q(QSqlDatabase::database(testConnectionName));
+            QVERIFY(q.exec("SELECT headline FROM Item WHERE localId='a';"));
+            QVERIFY(q.next());
+            QCOMPARE(q.value(0).toString(), QStringLiteral("edited"));
+        }
+        QSqlDatabase::removeDatabase(testConnectionName);
+
+        // a changed item is written
+        auto changed = items;
+        changed[1].title = QStringLiteral("Second, corrected");
+        const auto &third = results(m_storage->storeArticles(m_feed, changed));
+        QCOMPARE(third.first().updated, 1);
+        QCOMPARE(third.first().skipped, 1);
+    }
+
+    void testArticleCache()
+    {
+        const QVector<FeedCore::ParsedItem> items{testItem("a", "First", "first"), testItem("b", "Second", "second")};
+        QCOMPARE(results(m_storage->storeArticles(m_feed, items)).first().added.size(), 2);
+        const auto &stored = m_storage->articleCacheStats();
+        QCOMPARE(stored.misses, quint64(2));
+        QCOMPARE(stored.retained, 2);
+
+        // the articles are still cached, so reading them again reuses the instances
+        QCOMPARE(results(m_storage->getAll()).size(), 2);
+        const auto &read = m_storage->articleCacheStats();
+        QCOMPARE(read.misses, quint64(2));
+        QCOMPARE(read.hits, stored.hits + 2);
+
+        QCOMPARE(results(m_storage->runMaintenance(0)), QVector<qint64>({0}));
+        QCOMPARE(m_storage->articleCacheStats().live, 2);
+    }
+
+    void testSearchRanking()
+    {
+        const QVector<FeedCore::ParsedItem> items{
+            testItem("weather", "Weather", "A mild storm may pass later, in a long paragraph about many other things entirely."),
+            testItem("storm", "Storm warning", "The storm is coming; storm shelters are open until the storm passes."),
+            testItem("garden", "Garden", "Nothing about the weather here."),
+        };
+        QVERIFY(results(m_storage->storeArticles(m_feed, items)).first().ok);
+        QCOMPARE(headlines(results(m_storage->search("storm", {}, -1))), QStringList({"Storm warning", "Weather"}));
+        // the words are matched as prefixes, and every word has to match
+        QCOMPARE(headlines(results(m_storage->search("stor warn", {}, -1))), QStringList({"Storm warning"}));
+        QCOMPARE(headlines(results(m_storage->search("storm garden", {}, -1))), QStringList());
+    }
+
+    void testSearchEmptyQuery()
+    {
+        QVERIFY(results(m_storage->storeArticles(m_feed, {testItem("storm", "Storm warning", "storm")})).first().ok);
+        // a blank query is answered without asking FTS5, which would fail with an SQL error
+        WarningCounter warnings;
+        QCOMPARE(results(m_storage->search(QString(), {}, -1)).size(), 0);
+        const auto &rows = results(m_storage->searchRows(QStringLiteral("  "), {}, -1));
+        QCOMPARE(rows.size(), 1);
+        QVERIFY(rows.first().isEmpty());
+        QCOMPARE(warnings.count(), 0);
+    }
+
+    void testSearchFeedPaging()
+    {
+        QVector<FeedCore::ParsedItem> items;
+        for (int i = 0; i < 5; ++i) {
+            // more mentions rank higher, so the expected order is known
+            items << testItem(QString::number(i), QStringLiteral("Storm %1").arg(i), QStringLiteral("storm ").repeated(i + 1));
+        }
+        QVERIFY(results(m_storage->storeArticles(m_feed, items)).first().ok);
+        FeedCore::SearchFeed feed(m_context, QStringLiteral("search"));
+        feed.setQuery(QStringLiteral("storm"));
+        const QStringList expected{"Storm 4", "Storm 3", "Storm 2", "Storm 1", "Storm 0"};
+
+        QStringList paged;
+        FeedCore::ArticleRef after;
+        for (int page = 0; page < 3; ++page) {
+            const auto &articles = results(feed.getArticlePage(false, after, 2));
+            paged += headlines(articles);
+            if (articles.isEmpty()) {
+                break;
+            }
+            after = articles.last();
+        }
+        QCOMPARE(paged, expected);
+
+        QStringList pagedRows;
+        FeedCore::ArticleRows::Row afterRow;
+        for (int page = 0; page < 3; ++page) {
+            const auto &result = results(feed.getArticleRows(false, afterRow, 2));
+            QCOMPARE(result.size(), 1);
+            const auto &rows = result.first();
+            if (rows.isEmpty()) {
+                break;
+            }
+            for (int i = 0; i < rows.size(); ++i) {
+                pagedRows << rows.title(i);
+            }
+            afterRow = rows.row(rows.size() - 1);
+        }
+        QCOMPARE(pagedRows, expected);
+    }
+};
+
+QTEST_MAIN(testStorageImpl)
+
+#include "tst_teststorageimpl.moc"
@@ -6,7 +6,11 @@
 #include <QSignalSpy>
 #include <QtTest>
 
+#ifdef TEST_NATIVE_READS
+static constexpr const char *testDbName = "testStoreAndRetrieveFeedNative.db";
+#else
 static constexpr const char *testDbName = "testStoreAndRetrieveFeed.db";
+#endif
 static constexpr const char *testFeedName = "testName";
 static constexpr const char *testUrl = "about:blank";
 static constexpr const int testContextUpdateInterval = 1206;
@@ -14,6 +18,15 @@ static constexpr const int testFeedUpdateInterval = 20;
 static constexpr const int testContextExpireAge = 1532;
 static constexpr const int testFeedExpireAge = 611;
 
+static SqliteStorage::DatabaseOptions testOptions()
+{
+    SqliteStorage::DatabaseOptions options;
+#ifdef TEST_NATIVE_READS
+    options.nativeReads = true;
+#endif
+    return options;
+}
+
 class testStoreAndRetrieveFeed : public QObject
 {
     Q_OBJECT
@@ -24,7 +37,7 @@ class testStoreAndRetrieveFeed : public QObject
     void refreshContext()
     {
         delete m_context;
-        m_context = new FeedCore::Context(new SqliteStorage::StorageImpl(testDbName));
+        m_context = new FeedCore::Context(new SqliteStorage::StorageImpl(testDbName, testOptions()));
         m_context->setDefaultUpdateInterval(testContextUpdateInterval);
         m_context->setExpireAge(testContextExpireAge);
         QSignalSpy waitForFeeds(m_context, &FeedCore::Context::feedListPopulated);
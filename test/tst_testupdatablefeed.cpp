@@ -0,0 +1,203 @@
+#include "future.h"
+#include "updatablefeed.h"
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+
+static constexpr qint64 day{24 * 60 * 60};
+static const QByteArray testDocument{"<?xml version=\"1.0\"?><rss version=\"2.0\"><channel><title>test</title>"
+                                     "<item><guid>item</guid><title>headline</title></item></channel></rss>"};
+
+static QByteArray response(const QByteArray &status, const QByteArray &headers, const QByteArray &body = {})
+{
+    return "HTTP/1.1 " + status + "\r\nConnection: close\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n" + headers + "\r\n" + body;
+}
+
+/**
+ * Answers every request with the same response, and keeps the requests it was sent.
+ */
+class TestServer : public QTcpServer
+{
+public:
+    QByteArray response;
+    QVector<QByteArray> requests;
+
+    TestServer()
+    {
+        listen(QHostAddress::LocalHost);
+        QObject::connect(this, &QTcpServer::newConnection, this, [this] {
+            auto *socket = nextPendingConnection();
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+                const QByteArray &request{socket->property("request").toByteArray() + socket->readAll()};
+                socket->setProperty("request", request);
+                if (request.contains("\r\n\r\n")) {
+                    requests << request;
+                    socket->write(response);
+                    socket->disconnectFromHost();
+                }
+            });
+        });
+    }
+
+    QUrl url() const
+    {
+        return QUrl(QStringLiteral("http://127.0.0.1:%1/feed").arg(serverPort()));
+    }
+};
+
+class TestFeed : public FeedCore::UpdatableFeed
+{
+public:
+    bool storeSucceeds{true};
+    int storeCount{0};
+
+    TestFeed()
+        : UpdatableFeed(nullptr)
+    {
+    }
+
+    FeedCore::Future<FeedCore::ArticleRef> *getArticles(bool /*unreadFilter*/) override
+    {
+        Q_UNREACHABLE();
+    }
+
+private:
+    FeedCore::Future<FeedCore::StoredArticles> *updateSourceArticles(const QVector<FeedCore::ParsedItem> & /*articles*/) override
+    {
+        ++storeCount;
+        const bool ok{storeSucceeds};
+        return FeedCore::Future<FeedCore::StoredArticles>::yield(this, [ok](auto *op) {
+            op->setResult(FeedCore::StoredArticles{ok, {}});
+        });
+    }
+};
+
+class testUpdatableFeed : public QObject
+{
+    Q_OBJECT
+
+    static void update(TestFeed &feed)
+    {
+        feed.updater()->start();
+        QTRY_VERIFY(feed.status() != FeedCore::Feed::Updating);
+    }
+
+    static void setEtag(TestFeed &feed, const QString &etag)
+    {
+        FeedCore::Feed::HttpCache cache;
+        cache.etag = etag;
+        feed.setHttpCache(cache);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        // keep the responses out of the user's network cache
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void testCacheExpiry_data()
+    {
+        QTest::addColumn<QByteArray>("cacheControl");
+        QTest::addColumn<qint64>("age");
+        QTest::newRow("none") << QByteArray() << qint64(-1);
+        QTest::newRow("max-age") << QByteArray("public, max-age=600") << qint64(600);
+        QTest::newRow("quoted max-age") << QByteArray("max-age=\"600\"") << qint64(600);
+        QTest::newRow("upper case") << QByteArray("Max-Age=600") << qint64(600);
+        QTest::newRow("clamped to a day") << QByteArray("max-age=31536000") << day;
+        QTest::newRow("zero") << QByteArray("max-age=0") << qint64(-1);
+        QTest::newRow("no-cache") << QByteArray("no-cache, max-age=600") << qint64(-1);
+        QTest::newRow("no-store") << QByteArray("max-age=600,no-store") << qint64(-1);
+        QTest::newRow("s-maxage only") << QByteArray("s-maxage=600") << qint64(-1);
+    }
+
+    void testCacheExpiry()
+    {
+        QFETCH(QByteArray, cacheControl);
+        QFETCH(qint64, age);
+        const QDateTime now{QDateTime::currentDateTime()};
+        const QDateTime &expiry{FeedCore::UpdatableFeed::cacheExpiry(cacheControl, now)};
+        if (age < 0) {
+            QVERIFY(!expiry.isValid());
+        } else {
+            QCOMPARE(expiry, now.addSecs(age));
+        }
+    }
+
+    void testFreshResponseSkipsFetch()
+    {
+        TestServer server;
+        TestFeed feed;
+        feed.setUrl(server.url());
+        FeedCore::Feed::HttpCache cache;
+        cache.etag = QStringLiteral("\"a\"");
+        cache.expires = QDateTime::currentDateTime().addSecs(60 * 60);
+        feed.setHttpCache(cache);
+        update(feed);
+        QCOMPARE(feed.status(), FeedCore::Feed::Idle);
+        QCOMPARE(server.requests.size(), 0);
+        QCOMPARE(feed.storeCount, 0);
+    }
+
+    void testNotModified()
+    {
+        TestServer server;
+        server.response = response("304 Not Modified", "ETag: \"b\"\r\nCache-Control: max-age=60\r\n");
+        TestFeed feed;
+        feed.setUrl(server.url());
+        setEtag(feed, QStringLiteral("\"a\""));
+        update(feed);
+        QCOMPARE(feed.status(), FeedCore::Feed::Idle);
+        QCOMPARE(server.requests.size(), 1);
+        QVERIFY(server.requests.first().toLower().contains("if-none-match: \"a\""));
+        QCOMPARE(feed.storeCount, 0);
+        QCOMPARE(feed.httpCache().etag, QStringLiteral("\"b\""));
+        QVERIFY(feed.httpCache().expires.isValid());
+    }
+
+    void testValidatorsKeptAfterStore()
+    {
+        TestServer server;
+        server.response = response("200 OK", "ETag: \"b\"\r\nContent-Type: application/rss+xml\r\n", testDocument);
+        TestFeed feed;
+        feed.setUrl(server.url());
+        setEtag(feed, QStringLiteral("\"a\""));
+        update(feed);
+        QCOMPARE(feed.status(), FeedCore::Feed::Idle);
+        QCOMPARE(feed.storeCount, 1);
+        QCOMPARE(feed.httpCache().etag, QStringLiteral("\"b\""));
+    }
+
+    void testValidatorsDroppedWhenStoreFails()
+    {
+        TestServer server;
+        server.response = response("200 OK", "ETag: \"b\"\r\nContent-Type: application/rss+xml\r\n", testDocument);
+        TestFeed feed;
+        feed.storeSucceeds = false;
+        feed.setUrl(server.url());
+        setEtag(feed, QStringLiteral("\"a\""));
+        update(feed);
+        QCOMPARE(feed.status(), FeedCore::Feed::Error);
+        QCOMPARE(feed.storeCount, 1);
+        QCOMPARE(feed.httpCache().etag, QStringLiteral("\"a\""));
+    }
+
+    void testValidatorsDroppedWhenParseFails()
+    {
+        TestServer server;
+        server.response = response("200 OK", "ETag: \"b\"\r\nContent-Type: text/plain\r\n", "not a feed");
+        TestFeed feed;
+        feed.setUrl(server.url());
+        setEtag(feed, QStringLiteral("\"a\""));
+        update(feed);
+        QCOMPARE(feed.status(), FeedCore::Feed::Error);
+        QCOMPARE(feed.storeCount, 0);
+        QCOMPARE(feed.httpCache().etag, QStringLiteral("\"a\""));
+    }
+};
+
+QTEST_MAIN(testUpdatableFeed)
+
+#include "tst_testupdatablefeed.moc"
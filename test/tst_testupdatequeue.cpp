@@ -0,0 +1,142 @@
+#include "feed.h"
+#include "updatequeue.h"
+#include <QCoreApplication>
+#include <QSignalSpy>
+#include <QtTest>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class MockFeed : public FeedCore::Feed
+{
+public:
+    class Updater : public FeedCore::Feed::Updater
+    {
+    public:
+        int m_call_count{0};
+        void run() override
+        {
+            m_call_count++;
+        }
+        using Feed::Updater::finish;
+        using Feed::Updater::Updater;
+    };
+    Updater m_updater;
+
+    Feed::Updater *updater() override
+    {
+        return &m_updater;
+    }
+
+    FeedCore::Future<FeedCore::ArticleRef> *getArticles(bool /*unreadFilter*/) override
+    {
+        Q_UNREACHABLE();
+    }
+
+    explicit MockFeed(const QUrl &url)
+        : m_updater(this, this)
+    {
+        setUrl(url);
+    }
+};
+
+class testUpdateQueue : public QObject
+{
+    Q_OBJECT
+    FeedCore::UpdateQueue *queue{nullptr};
+    std::vector<std::unique_ptr<MockFeed>> feeds;
+
+    MockFeed *addFeed(const QString &url)
+    {
+        feeds.push_back(std::make_unique<MockFeed>(QUrl(url)));
+        return feeds.back().get();
+    }
+
+    int updating() const
+    {
+        return std::count_if(feeds.begin(), feeds.end(), [](const auto &feed) {
+            return feed->status() == FeedCore::Feed::Updating;
+        });
+    }
+
+private slots:
+    void init()
+    {
+        queue = new FeedCore::UpdateQueue();
+        queue->setMaxActive(2);
+        queue->setMaxActivePerHost(1);
+    }
+
+    void cleanup()
+    {
+        delete queue;
+        feeds.clear();
+    }
+
+    void testGlobalLimit()
+    {
+        const auto &timestamp = QDateTime::currentDateTime();
+        for (int i = 0; i < 4; ++i) {
+            queue->enqueue(addFeed(QStringLiteral("https://host%1.example/feed").arg(i)), timestamp);
+        }
+        QCOMPARE(updating(), 2);
+        QCOMPARE(queue->stats().queued, 2);
+
+        feeds[0]->m_updater.finish();
+        QTRY_COMPARE(updating(), 2);
+        QCOMPARE(feeds[2]->status(), FeedCore::Feed::Updating);
+        QCOMPARE(queue->stats().queued, 1);
+        QCOMPARE(queue->stats().started, quint64(3));
+    }
+
+    void testHostLimit()
+    {
+        const auto &timestamp = QDateTime::currentDateTime();
+        auto *first = addFeed("https://example.com/a");
+        auto *second = addFeed("https://EXAMPLE.com/b");
+        auto *other = addFeed("https://example.org/c");
+        queue->enqueue(first, timestamp);
+        queue->enqueue(second, timestamp);
+        queue->enqueue(other, timestamp);
+        QCOMPARE(first->status(), FeedCore::Feed::Updating);
+        QCOMPARE(second->status(), FeedCore::Feed::Idle);
+        QCOMPARE(other->status(), FeedCore::Feed::Updating);
+
+        first->m_updater.finish();
+        QTRY_COMPARE(second->status(), FeedCore::Feed::Updating);
+    }
+
+    void testOrder()
+    {
+        const auto &timestamp = QDateTime::currentDateTime();
+        auto *blocker = addFeed("https://blocker.example/feed");
+        queue->setMaxActive(1);
+        queue->enqueue(blocker, timestamp);
+
+        auto *late = addFeed("https://late.example/feed");
+        auto *early = addFeed("https://early.example/feed");
+        auto *requested = addFeed("https://requested.example/feed");
+        queue->enqueue(late, timestamp, FeedCore::UpdateQueue::Scheduled, timestamp.addSecs(-10));
+        queue->enqueue(early, timestamp, FeedCore::UpdateQueue::Scheduled, timestamp.addSecs(-20));
+        queue->enqueue(requested, timestamp, FeedCore::UpdateQueue::Requested);
+        // queuing again keeps the feed's place
+        queue->enqueue(late, timestamp, FeedCore::UpdateQueue::Scheduled, timestamp);
+        QCOMPARE(queue->stats().queued, 3);
+
+        for (auto *next : {requested, early, late}) {
+            FeedCore::Feed *active{blocker};
+            for (const auto &feed : feeds) {
+                if (feed->status() == FeedCore::Feed::Updating) {
+                    active = feed.get();
+                }
+            }
+            static_cast<MockFeed *>(active)->m_updater.finish();
+            QTRY_COMPARE(next->status(), FeedCore::Feed::Updating);
+        }
+        QCOMPARE(late->m_updater.m_call_count, 1);
+    }
+};
+
+QTEST_MAIN(testUpdateQueue)
+
+#include "tst_testupdatequeue.moc"
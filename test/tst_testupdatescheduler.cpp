@@ -1,8 +1,10 @@
 #include "feed.h"
 #include "scheduler.h"
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QSignalSpy>
 #include <QtTest>
+#include <algorithm>
 
 class MockFeed : public FeedCore::Feed
 {
@@ -211,6 +213,29 @@ private slots:
         QVERIFY(feed.m_updater.m_call_count == 2);
     }
 
+    void testFailingFeedBacksOff()
+    {
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        MockFeed feed;
+        feed.setLastUpdate(timestamp.addSecs(-10));
+        feed.setUpdateInterval(1);
+        feed.setFailureCount(4);
+        scheduler->schedule(&feed);
+        scheduler->start(1);
+        QVERIFY(feed.status() == FeedCore::Feed::Updating);
+        feed.m_updater.setError("error");
+        QCOMPARE(feed.failureCount(), 5);
+
+        // the fifth failure in a row waits 16 to 32 times the update interval
+        QSignalSpy waitForStatusChange(&feed, &FeedCore::Feed::statusChanged);
+        QVERIFY(!waitForStatusChange.wait(2000));
+        QVERIFY(feed.status() == FeedCore::Feed::Error);
+
+        feed.m_updater.start();
+        feed.m_updater.finish();
+        QCOMPARE(feed.failureCount(), 0);
+    }
+
     void testErrorFeedUpdatesWhenErrorsCleared()
     {
         const QDateTime timestamp = QDateTime::currentDateTime();
@@ -224,11 +249,138 @@ private slots:
         feed.m_updater.setError("error");
         QVERIFY(feed.status() == FeedCore::Feed::Error);
 
+        // recovery is staggered, so the retry is not immediate
         scheduler->clearErrors();
-        QVERIFY(feed.status() == FeedCore::Feed::Updating);
+        QTRY_VERIFY(feed.status() == FeedCore::Feed::Updating);
         QVERIFY(feed.m_updater.m_call_count == 2);
     }
 
+    void testBackoffKeptAcrossRestart()
+    {
+        // a feed that last succeeded weeks ago, but last failed just now
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        MockFeed feed;
+        feed.setLastUpdate(timestamp.addDays(-30));
+        feed.setLastFailure(timestamp.addSecs(-1));
+        feed.setFailureCount(10);
+        feed.setUpdateInterval(60);
+        scheduler->schedule(&feed);
+        scheduler->start(1);
+        QVERIFY(feed.status() == FeedCore::Feed::Idle);
+        QSignalSpy waitForStatusChange(&feed, &FeedCore::Feed::statusChanged);
+        QVERIFY(!waitForStatusChange.wait(500));
+
+        // once the backoff has passed it is retried
+        feed.setLastFailure(timestamp.addDays(-2));
+        scheduler->unschedule(&feed);
+        scheduler->schedule(&feed);
+        QVERIFY(feed.status() == FeedCore::Feed::Updating);
+    }
+
+    void testLongIntervalBackoff()
+    {
+        // shifting this interval by the failure count overflows
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        MockFeed feed;
+        feed.setLastUpdate(timestamp.addSecs(-10));
+        feed.setLastFailure(timestamp.addSecs(-10));
+        feed.setFailureCount(30);
+        feed.setUpdateInterval(qint64(200) * 24 * 60 * 60);
+        scheduler->schedule(&feed);
+        scheduler->start(1);
+        QSignalSpy waitForStatusChange(&feed, &FeedCore::Feed::statusChanged);
+        QVERIFY(!waitForStatusChange.wait(500));
+        QVERIFY(feed.status() == FeedCore::Feed::Idle);
+    }
+
+    void testClearErrorsSpreadsRetries()
+    {
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        constexpr int feedCount{8};
+        QElapsedTimer elapsed;
+        QVector<qint64> retried;
+        MockFeed feeds[feedCount];
+        for (int i = 0; i < feedCount; ++i) {
+            // separate hosts, so that the update queue doesn't spread them out itself
+            feeds[i].setUrl(QUrl(QStringLiteral("https://feed%1.example.com/").arg(i)));
+            feeds[i].setLastUpdate(timestamp.addSecs(-7200));
+            feeds[i].setUpdateInterval(3600);
+            scheduler->schedule(&feeds[i]);
+            QVERIFY(feeds[i].status() == FeedCore::Feed::Updating);
+            feeds[i].m_updater.setError("error");
+            QObject::connect(&feeds[i], &FeedCore::Feed::statusChanged, this, [&feeds, &retried, &elapsed, i] {
+                if (feeds[i].status() == FeedCore::Feed::Updating) {
+                    retried << elapsed.elapsed();
+                }
+            });
+        }
+        scheduler->start(1);
+        elapsed.start();
+        scheduler->clearErrors();
+
+        // eight feeds are spread over two seconds
+        QTRY_COMPARE_WITH_TIMEOUT(retried.size(), feedCount, 5000);
+        const auto &[first, last] = std::minmax_element(retried.constBegin(), retried.constEnd());
+        QVERIFY(*last - *first >= 250);
+        QVERIFY(*last <= 2500);
+    }
+
+    void testFeedsUpdatedInDeadlineOrder()
+    {
+        const QDateTime timestamp = QDateTime::currentDateTime();
+        MockFeed feeds[4];
+        const int intervals[] = {3, 1, 2, 1};
+        for (int i = 0; i < 4; ++i) {
+            feeds[i].setLastUpdate(timestamp);
+            feeds[i].setUpdateInterval(intervals[i]);
+            scheduler->schedule(&feeds[i], timestamp);
+        }
+        scheduler->unschedule(&feeds[3]);
+        scheduler->start(1);
+
+        QTRY_VERIFY(feeds[1].status() == FeedCore::Feed::Updating);
+        QVERIFY(feeds[0].status() == FeedCore::Feed::Idle);
+        QVERIFY(feeds[2].status() == FeedCore::Feed::Idle);
+        QTRY_VERIFY(feeds[2].status() == FeedCore::Feed::Updating);
+        QVERIFY(feeds[0].status() == FeedCore::Feed::Idle);
+        QTRY_VERIFY(feeds[0].status() == FeedCore::Feed::Updating);
+        QVERIFY(feeds[3].status() == FeedCore::Feed::Idle);
+        for (auto &feed : feeds) {
+            QVERIFY(feed.m_updater.m_call_count <= 1);
+        }
+    }
+
+    void testAdaptiveUpdateInterval()
+    {
+        scheduler->setAdaptiveIntervalLimits(1, 3600);
+        MockFeed feed;
+        feed.setUpdateMode(FeedCore::Feed::AdaptiveUpdateMode);
+        feed.setUpdateInterval(600);
+        QCOMPARE(scheduler->updateInterval(&feed), qint64(600));
+
+        feed.setPostingInterval(2 * 1000);
+        QCOMPARE(scheduler->updateInterval(&feed), qint64(1000));
+        feed.setPostingInterval(1);
+        QCOMPARE(scheduler->updateInterval(&feed), qint64(1));
+        feed.setPostingInterval(24 * 3600);
+        QCOMPARE(scheduler->updateInterval(&feed), qint64(3600));
+
+        feed.setLastUpdate(QDateTime::currentDateTime());
+        scheduler->schedule(&feed);
+        const auto &stats = scheduler->adaptiveStats();
+        QCOMPARE(stats.feeds, 1);
+        QCOMPARE(stats.fixedFetchesPerDay, 144.0);
+        QCOMPARE(stats.adaptiveFetchesPerDay, 24.0);
+        QCOMPARE(stats.savedFetchesPerDay(), 120.0);
+
+        // a feed that posts more often is rescheduled when the estimate changes
+        feed.setPostingInterval(2);
+        scheduler->start(1);
+        QSignalSpy waitForStatusChange(&feed, &FeedCore::Feed::statusChanged);
+        QVERIFY(waitForStatusChange.wait());
+        QVERIFY(feed.status() == FeedCore::Feed::Updating);
+    }
+
     void testFeedsWithSameUpdateIntervalAreUpdatedTogether()
     {
         const QDateTime timestamp = QDateTime::currentDateTime();